@@ -12,7 +12,9 @@
 #include "core/ProofSet.hpp"
 #include "core/ProofSetMarin.hpp"
 #include "math/Carry.hpp"
+#include "math/PrimeSieve.hpp"
 #include "util/GmpUtils.hpp"
+#include "util/BitPack.hpp"
 #include "io/WorktodoParser.hpp"
 #include "io/WorktodoManager.hpp"
 #include "io/CurlClient.hpp"
@@ -45,6 +47,8 @@
 #include <sstream>
 #include <tuple>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include <fstream>
 #include <memory>
 #include <optional>
@@ -53,6 +57,7 @@
 #include <gmp.h>
 #include <cstddef>
 #include <deque>
+#include <algorithm>
 #include <filesystem>
 #include <set>
 
@@ -164,27 +169,8 @@ inline void restart_self(int argc, char* argv[]) {
 
 
 static inline std::vector<uint32_t> pack_words_from_eng_digits(const engine::digit& d, uint32_t E) {
-    const size_t totalWords = (E + 31) / 32;
-    std::vector<uint32_t> out(totalWords, 0u);
-
-    uint64_t acc = 0;
-    int acc_bits = 0;
-    size_t o = 0;
-
-    const size_t n = d.get_size();
-    for (size_t i = 0; i < n; ++i) {
-        uint32_t w = uint32_t(d.width(i));
-        uint32_t v = d.val(i);
-        if (w < 32) v &= uint32_t((uint64_t(1) << w) - 1);
-        acc |= (uint64_t)v << acc_bits;
-        acc_bits += int(w);
-        while (acc_bits >= 32 && o < totalWords) {
-            out[o++] = uint32_t(acc & 0xFFFFFFFFu);
-            acc >>= 32;
-            acc_bits -= 32;
-        }
-    }
-    if (o < totalWords) out[o++] = uint32_t(acc & 0xFFFFFFFFu);
+    std::vector<uint32_t> out((E + 31) / 32);
+    util::packDigits(d.data(), d.get_size(), out.data(), out.size());
     return out;
 }
 
@@ -250,41 +236,41 @@ inline mpz_class buildE(uint64_t B1) {
     using clock = std::chrono::steady_clock;
     auto t0 = clock::now(), last = t0;
 
-    std::vector<uint8_t> sieve((B1 >> 1) + 1, 1);
-    std::vector<uint64_t> primes;
-    primes.reserve(B1 ? B1 / std::log(double(B1)) : 1);
-    for (uint64_t i = 3; i <= B1; i += 2) {
-        if (sieve[i >> 1]) {
-            primes.push_back(i);
-            if (uint64_t ii = uint64_t(i) * i; ii <= B1)
-                for (uint64_t j = ii; j <= B1; j += (i << 1))
-                    sieve[j >> 1] = 0;
-        }
-    }
-
-    size_t total = primes.size();
-    std::atomic<size_t> next{0}, done{0};
+    // Odd primes are handed to the workers in chunks by a shared sieve, so that
+    // the list of primes up to B1 is never stored.
+    math::PrimeSieve primes(3, B1);
+    std::mutex primesMutex;
+    std::atomic<uint64_t> reached{0};
     unsigned th = std::thread::hardware_concurrency();
     if (!th) th = 4;
+    std::atomic<unsigned> running{th};
     std::vector<mpz_class> part(th, 1);
     std::vector<std::thread> workers;
 
     for (unsigned t = 0; t < th; ++t)
         workers.emplace_back([&, t] {
-            while (true) {
-                size_t idx = next.fetch_add(1);
-                if (idx >= total) break;
-                uint64_t p = primes[idx];
-                mpz_class pw;
-                mpz_set_ui(pw.get_mpz_t(), static_cast<unsigned long>(p));
-                unsigned long lim1 = static_cast<unsigned long>(B1 / p);
-                mpz_class limit(lim1);
-                //while (pw <= limit) pw *= mpz_class(p);
-                while (pw <= limit) pw *= mpz_class(static_cast<unsigned long>(p));
-                part[t] *= pw;
-                done.fetch_add(1, std::memory_order_relaxed);
-                if (interrupted) return;
+            std::vector<uint64_t> chunk;
+            chunk.reserve(4096);
+            while (!interrupted) {
+                chunk.clear();
+                {
+                    std::lock_guard<std::mutex> lock(primesMutex);
+                    for (uint64_t q; chunk.size() < 4096 && (q = primes.next()) != 0; ) chunk.push_back(q);
+                    if (!chunk.empty()) reached.store(chunk.back(), std::memory_order_relaxed);
+                }
+                if (chunk.empty()) break;
+                for (const uint64_t p : chunk) {
+                    mpz_class pw;
+                    mpz_set_ui(pw.get_mpz_t(), static_cast<unsigned long>(p));
+                    unsigned long lim1 = static_cast<unsigned long>(B1 / p);
+                    mpz_class limit(lim1);
+                    //while (pw <= limit) pw *= mpz_class(p);
+                    while (pw <= limit) pw *= mpz_class(static_cast<unsigned long>(p));
+                    part[t] *= pw;
+                    if (interrupted) break;
+                }
             }
+            running.fetch_sub(1);
         });
 
     mpz_class E = 1;
@@ -296,10 +282,10 @@ inline mpz_class buildE(uint64_t B1) {
     E *= pw2;
 
     std::cout << "Building E:   0%  ETA  --:--:--" << std::flush;
-    while (done.load() < total && !interrupted) {
+    while (running.load() > 0 && !interrupted) {
         auto now = clock::now();
         if (now - last >= std::chrono::milliseconds(500)) {
-            double prog = double(done.load()) / total;
+            double prog = double(reached.load(std::memory_order_relaxed)) / double(B1);
             double eta = prog ? std::chrono::duration<double>(now - t0).count() * (1.0 - prog) / prog : 0.0;
             long sec = long(eta + 0.5);
             int h = int(sec / 3600), m = int((sec % 3600) / 60), s = int(sec % 60);
@@ -595,38 +581,40 @@ static inline bool write_prime95_s1_from_bytes(const std::string& outPath, uint3
     return (bool)out;
 }
 
+// A completed P-1 stage 1 of 2^p - 1 in the layout of write_prime95_s1_from_bytes:
+// B1 and the little-endian bytes of the residue, if the checksum matches.
+static inline bool read_prime95_s1(const std::string& path, uint32_t& p, uint64_t& B1, std::vector<uint8_t>& data){
+    std::ifstream in(path, std::ios::binary);
+    if(!in) return false;
+    auto get = [&](auto& v){ return (bool)in.read(reinterpret_cast<char*>(&v), sizeof(v)); };
+    uint32_t magic=0, version=0, n=0, chk=0; int32_t b=0, c=0, state=0, one=0, words=0;
+    double k=0, pct=0; char stage[12]={}; uint64_t B_done=0, interim_B=0;
+    if(!get(magic) || !get(version) || !get(k) || !get(b) || !get(n) || !get(c)) return false;
+    if(magic != 830093643u || k != 1.0 || b != 2 || c != -1) return false;
+    if(!in.read(stage, sizeof(stage)) || stage[0] != 'S' || stage[1] != '1') return false;
+    if(!get(pct) || !get(chk) || !get(state) || !get(B_done) || !get(interim_B) || !get(one) || !get(words)) return false;
+    if(state != 5 || one != 1 || words <= 0 || B_done == 0) return false;
+    data.resize(size_t(words) * 4);
+    if(!in.read(reinterpret_cast<char*>(data.data()), (std::streamsize)data.size())) return false;
+    // B_done and interim_B are both summed, checksum_prime95_s1 takes them equal
+    if(chk != (uint32_t)(checksum_prime95_s1(B_done, data) - B_done + interim_B)) return false;
+    p = n; B1 = B_done;
+    return true;
+}
 
-static inline mpz_class compute_X_with_dots(engine* eng, engine::Reg reg, const mpz_class& Mp) {
-    using namespace std::chrono;
-
-    std::atomic<bool> done{false};
-    std::thread ticker([&]{
-        const char* msg = "Constructing and reducing large integer ";
-        std::cout << msg << std::flush;
-        size_t dots = 0, wrap = 60;
-        while (!done.load(std::memory_order_relaxed)) {
-            std::cout << '.' << std::flush;
-            if (++dots % wrap == 0) std::cout << '\n' << msg << std::flush;
-            std::this_thread::sleep_for(milliseconds(300));
-        }
-        std::cout << " done.\n";
-    });
 
-    mpz_class X(0);
+// Residue of reg as an integer mod Mp. The digits are packed on several threads and
+// imported at once, so this is cheap even at 100M+ exponents.
+static inline mpz_class compute_X(engine* eng, engine::Reg reg, const mpz_class& Mp) {
+    mpz_class X;
     mpz_t tmp; mpz_init(tmp);
     eng->get_mpz(tmp, reg);
-    mpz_set(X.get_mpz_t(), tmp);
+    mpz_swap(X.get_mpz_t(), tmp);
     mpz_clear(tmp);
-
-    X %= Mp;
-
-    done.store(true, std::memory_order_relaxed);
-    ticker.join();
+    if (X >= Mp) X %= Mp;
     return X;
 }
 
-
-
 static inline mpz_class product_tree_range_u64(const std::vector<uint64_t>& v, size_t lo, size_t hi, size_t leaf, int par) {
     size_t n = hi - lo;
     if (n == 0) return mpz_class(1);
@@ -671,25 +659,20 @@ static inline size_t product_prefix_fit_u64(const std::vector<uint64_t>& v, size
     }
 }
 
-inline mpz_class buildE2(uint64_t B1, uint64_t startPrime, uint64_t maxBits, uint64_t& nextStart, bool includeTwo) {
+// With stop set, buildE2 runs on a background thread: it is silent and returns as soon as
+// *stop is set, the partial result is then to be discarded.
+// With fromB1 > 0, E is the increment from fromB1 to B1: a prime q <= fromB1 only brings its
+// power of B1 divided by its power of fromB1, which is 1 once q^2 > B1.
+inline mpz_class buildE2(uint64_t B1, uint64_t startPrime, uint64_t maxBits, uint64_t& nextStart, bool includeTwo,
+                         const std::atomic<bool>* stop = nullptr, uint64_t fromB1 = 0) {
     using clock = std::chrono::steady_clock;
     auto t0 = clock::now(), last = t0;
+    const bool verbose = (stop == nullptr);
+    auto stopped = [&] { return verbose ? interrupted.load() : stop->load(std::memory_order_relaxed); };
     nextStart = 0;
     if (B1 < 3) return includeTwo ? mpz_class(2) : mpz_class(1);
 
-    uint64_t s = startPrime < 3 ? 3 : (startPrime | 1ULL);
-    uint64_t R = (uint64_t)std::sqrt((long double)B1);
-    if ((R & 1ULL) == 0) R -= 1;
-
-    std::vector<uint8_t> base((R >> 1) + 1, 1);
-    for (uint64_t i = 3; i * i <= R; i += 2)
-        if (base[i >> 1])
-            for (uint64_t j = i * i; j <= R; j += (i << 1))
-                base[j >> 1] = 0;
-
-    std::vector<uint64_t> small_primes;
-    for (uint64_t i = 3; i <= R; i += 2)
-        if (base[i >> 1]) small_primes.push_back(i);
+    const uint64_t s = startPrime < 3 ? 3 : startPrime;
 
     mpz_class E = 1;
     std::vector<uint64_t> batch;
@@ -697,118 +680,90 @@ inline mpz_class buildE2(uint64_t B1, uint64_t startPrime, uint64_t maxBits, uin
     batch.reserve(1u << 16);
     batch_primes.reserve(1u << 16);
 
-    if (includeTwo) {
-        uint64_t pw2 = 2;
-        while (pw2 <= B1 / 2) pw2 <<= 1;
-        batch.push_back(pw2);
+    // q^e <= B1 < q^(e+1), divided by the power already in the state
+    auto power = [B1, fromB1](uint64_t q) {
+        uint64_t pw = q;
+        while (pw <= B1 / q) pw *= q;
+        if (q <= fromB1) {
+            uint64_t done = q;
+            while (done <= fromB1 / q) done *= q;
+            pw /= done;
+        }
+        return pw;
+    };
+
+    if (includeTwo && power(2) > 1) {
+        batch.push_back(power(2));
         batch_primes.push_back(2);
     }
 
-    const uint64_t span = 1ULL << 24;
-    if ((s & 1ULL) == 0) s += 1;
-    uint64_t totalOdd = (B1 >= s) ? (((B1 - s) >> 1) + 1) : 0;
-    std::cout << "Building E-chunk:   0%  ETA  --:--:--" << std::flush;
+    const uint64_t totalSpan = (B1 >= s) ? (B1 - s + 1) : 0;
+    if (verbose) std::cout << "Building E-chunk:   0%  ETA  --:--:--" << std::flush;
 
     auto flush_batch = [&](bool final_segment)->bool{
         if (batch.empty()) return true;
         size_t leaf = 16;
         int par = (int)std::thread::hardware_concurrency(); if (par <= 0) par = 2;
+        if (!verbose && par > 2) --par;     // leave a core to the thread driving the device
         mpz_class Pfit;
         size_t used = product_prefix_fit_u64(batch, 0, batch.size(), E, maxBits, Pfit, leaf, par);
         E *= Pfit;
         if (used < batch.size() && mpz_cmp_ui(E.get_mpz_t(), 1) != 0) { nextStart = batch_primes[used]; return false; }
         batch.clear();
         batch_primes.clear();
-        if (final_segment && nextStart == 0) std::cout << "\rBuilding E-chunk: 100%  ETA  00:00:00\n";
+        if (verbose && final_segment && nextStart == 0) std::cout << "\rBuilding E-chunk: 100%  ETA  00:00:00\n";
         return true;
     };
 
-    uint64_t low = s;
-    while (low <= B1 && !interrupted) {
-        uint64_t high = low + span - 1;
-        if (high > B1) high = B1;
-        if ((high & 1ULL) == 0) high -= 1;
-        if (high < low) break;
-
-        size_t len = size_t(((high - low) >> 1) + 1);
-        std::vector<uint8_t> seg(len, 1);
-
-        for (uint64_t q : small_primes) {
-            uint64_t q2 = q * q;
-            uint64_t start = (q2 > low) ? q2 : ((low + q - 1) / q) * q;
-            if ((start & 1ULL) == 0) start += q;
-            if (start < low) start += q;
-            for (uint64_t j = start; j <= high; j += (q << 1)) {
-                size_t idx = size_t((j - low) >> 1);
-                seg[idx] = 0;
-            }
+    // An increment sieves the primes whose power grows, then the primes of (fromB1, B1]
+    uint64_t smallEnd = 0;
+    if (fromB1 != 0) {
+        uint64_t r = static_cast<uint64_t>(std::sqrt(static_cast<double>(B1)));
+        while (r * r > B1) --r;
+        while ((r + 1) * (r + 1) <= B1) ++r;
+        smallEnd = std::min(fromB1, r);
+    }
+    const uint64_t tailStart = std::max(s, fromB1 + 1);
+    std::optional<math::PrimeSieve> primes;
+    bool inTail = (s > smallEnd);
+    if (inTail) primes.emplace(tailStart, B1); else primes.emplace(s, smallEnd);
+    for (uint64_t p; !stopped(); ) {
+        if ((p = primes->next()) == 0) {
+            if (inTail || tailStart > B1) break;
+            inTail = true;
+            primes.emplace(tailStart, B1);
+            continue;
         }
+        const uint64_t pw = power(p);
+        if (pw == 1) continue;
+        batch.push_back(pw);
+        batch_primes.push_back(p);
 
-        for (uint64_t n = low; n <= high; n += 2) {
-            if (!seg[size_t((n - low) >> 1)]) {
-                auto now = clock::now();
-                if (now - last >= std::chrono::milliseconds(500)) {
-                    uint64_t progressedOdd = ((n >= s) ? (((n - s) >> 1) + 1) : 0);
-                    double prog = totalOdd ? (double)progressedOdd / (double)totalOdd : 1.0;
-                    double eta = prog ? std::chrono::duration<double>(now - t0).count() * (1.0 - prog) / prog : 0.0;
-                    long sec = long(eta + 0.5);
-                    int h = int(sec / 3600), m = int((sec % 3600) / 60), ss = int(sec % 60);
-                    std::cout << "\rBuilding E-chunk: " << std::setw(3) << int(prog * 100)
-                              << "%  ETA "
-                              << std::setw(2) << std::setfill('0') << h << ':'
-                              << std::setw(2) << m << ':'
-                              << std::setw(2) << ss << std::setfill(' ')
-                              << std::flush;
-                    last = now;
-                }
-                continue;
-            }
-            uint64_t p = n;
-            uint64_t pw = p;
-            while (pw <= B1 / p) pw *= p;
-            batch.push_back(pw);
-            batch_primes.push_back(p);
-
-            if (batch.size() >= (1u << 16)) {
-                if (!flush_batch(false)) goto done;
-            }
-
-            auto now = clock::now();
-            if (now - last >= std::chrono::milliseconds(500)) {
-                uint64_t progressedOdd = ((n >= s) ? (((n - s) >> 1) + 1) : 0);
-                double prog = totalOdd ? (double)progressedOdd / (double)totalOdd : 1.0;
-                double eta = prog ? std::chrono::duration<double>(now - t0).count() * (1.0 - prog) / prog : 0.0;
-                long sec = long(eta + 0.5);
-                int h = int(sec / 3600), m = int((sec % 3600) / 60), ss = int(sec % 60);
-                std::cout << "\rBuilding E-chunk: " << std::setw(3) << int(prog * 100)
-                          << "%  ETA "
-                          << std::setw(2) << std::setfill('0') << h << ':'
-                          << std::setw(2) << m << ':'
-                          << std::setw(2) << ss << std::setfill(' ')
-                          << std::flush;
-                last = now;
-            }
-            if (interrupted) break;
+        if (batch.size() >= (1u << 16)) {
+            if (!flush_batch(false)) goto done;
         }
 
-        if (!flush_batch(false)) goto done;
-
-        low = high + 2;
         auto now = clock::now();
-        uint64_t progressedOdd = ((low > s) ? (((std::min(low - 2, B1) - s) >> 1) + 1) : 0);
-        double prog = totalOdd ? (double)progressedOdd / (double)totalOdd : 1.0;
-        double eta = prog ? std::chrono::duration<double>(now - t0).count() * (1.0 - prog) / prog : 0.0;
-        long sec = long(eta + 0.5);
-        int h = int(sec / 3600), m = int((sec % 3600) / 60), ss = int(sec % 60);
-        std::cout << "\rBuilding E-chunk: " << std::setw(3) << int(prog * 100)
-                  << "%  ETA "
-                  << std::setw(2) << std::setfill('0') << h << ':'
-                  << std::setw(2) << m << ':'
-                  << std::setw(2) << ss << std::setfill(' ')
-                  << std::flush;
+        if (verbose && now - last >= std::chrono::milliseconds(500)) {
+            double prog = totalSpan ? (double)(p - s + 1) / (double)totalSpan : 1.0;
+            double eta = prog ? std::chrono::duration<double>(now - t0).count() * (1.0 - prog) / prog : 0.0;
+            long sec = long(eta + 0.5);
+            int h = int(sec / 3600), m = int((sec % 3600) / 60), ss = int(sec % 60);
+            std::cout << "\rBuilding E-chunk: " << std::setw(3) << int(prog * 100)
+                      << "%  ETA "
+                      << std::setw(2) << std::setfill('0') << h << ':'
+                      << std::setw(2) << m << ':'
+                      << std::setw(2) << ss << std::setfill(' ')
+                      << std::flush;
+            last = now;
+        }
     }
 
 done:
+    if (!verbose) {
+        if (!stopped() && !batch.empty() && nextStart == 0) flush_batch(true);
+        return E;
+    }
     if (!batch.empty() && nextStart == 0) flush_batch(true);
     if (interrupted) {
         std::cout << "\n\nInterrupted signal received — using partial E computed so far.\n\n";
@@ -821,6 +776,83 @@ done:
     return E;
 }
 
+// The buildE2 chunks of [startPrime, B1], built ahead on a host thread while the device
+// exponentiates the current one. At most depth chunks wait in the queue.
+class EChunkPipeline {
+public:
+    struct Chunk {
+        mpz_class E;
+        uint64_t start = 0;         // first prime of the chunk
+        uint64_t nextStart = 0;     // first prime of the next chunk, 0 for the last one
+    };
+
+    // fromB1 > 0: the chunks of the increment from fromB1 to B1, see buildE2
+    EChunkPipeline(uint64_t B1, uint64_t startPrime, uint64_t maxBits, bool includeTwo, uint64_t fromB1 = 0, size_t depth = 2)
+        : depth_(std::max<size_t>(depth, 1)) {
+        worker_ = std::thread([this, B1, startPrime, maxBits, includeTwo, fromB1] { run(B1, startPrime, maxBits, includeTwo, fromB1); });
+    }
+
+    ~EChunkPipeline() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        if (worker_.joinable()) worker_.join();
+    }
+
+    EChunkPipeline(const EChunkPipeline&) = delete;
+    EChunkPipeline& operator=(const EChunkPipeline&) = delete;
+
+    // Next chunk, waiting for it if needed. False after the last one.
+    bool pop(Chunk& c) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !queue_.empty() || finished_; });
+        if (queue_.empty()) return false;
+        c = std::move(queue_.front());
+        queue_.pop_front();
+        cv_.notify_all();
+        return true;
+    }
+
+private:
+    void run(uint64_t B1, uint64_t start, uint64_t maxBits, bool includeTwo, uint64_t fromB1) {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return queue_.size() < depth_ || stop_; });
+                if (stop_) break;
+            }
+            Chunk c;
+            c.start = start;
+            c.E = buildE2(B1, start, maxBits, c.nextStart, includeTwo, &stop_, fromB1);
+            if (stop_) break;
+            const uint64_t next = c.nextStart;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                queue_.push_back(std::move(c));
+            }
+            cv_.notify_all();
+            if (next == 0) break;
+            start = next | 1ULL;
+            includeTwo = false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            finished_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    const size_t depth_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Chunk> queue_;
+    std::atomic<bool> stop_{false};
+    bool finished_ = false;
+    std::thread worker_;
+};
+
 inline mpz_class gcd_with_dots(const mpz_class& A, const mpz_class& B) {
     std::atomic<bool> done{false};
     std::thread ticker([&]{
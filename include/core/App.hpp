@@ -21,10 +21,12 @@
 #include "io/JsonBuilder.hpp"
 #include "io/CurlClient.hpp"
 #include "marin/engine.h"
+#include <functional>
 #include <memory>
 #include <optional>
 #include <atomic>
 #include <gmp.h>
+#include <gmpxx.h>
 #ifndef CL_TARGET_OPENCL_VERSION
 #define CL_TARGET_OPENCL_VERSION 300
 #endif
@@ -49,10 +51,18 @@ public:
     int runPM1();
     int runPM1Marin();
     int runPM1Stage2();
-    int runPM1Stage2Marin();
+    // cancelled: polled during stage 2, true stops it (a factor was found meanwhile)
+    int runPM1Stage2Marin(const std::function<bool()>& cancelled = {});
     int runPM1Stage2MarinNKVersion();
+    // Product of the partial stage-2 accumulators of -s2merge, then the GCD
+    int runPM1Stage2Merge();
+    // True if the stage-1 checkpoint file holds a completed stage 1 of at least B1
+    static bool pm1Stage1Complete(const std::string& file, uint32_t p, uint64_t B1);
+    // True if the stage-2 checkpoint file is one of p, B1 and B2 that stage 2 resumes
+    static bool pm1Stage2Resumable(const std::string& file, uint32_t p, uint64_t B1, uint64_t B2);
     int runMemtestOpenCL();
     int runECMMarin();
+    int runCertMarin();
     int run();
     void tuneIterforce();
     double measureIps(uint64_t testIterforce, uint64_t testIters);
@@ -61,6 +71,11 @@ public:
                                   const std::string& savePath);
     int convertEcmResumeToPrime95(const std::string& ecmPath, const std::string& outPath,const std::string& date_start, const std::string& date_end);
 private:
+  // Result file, JSON and results.txt of a stage 2 whose GCD is g; true if g is a factor
+  bool reportPM1Stage2(const mpz_class& g);
+  // B1 and B2 of -pm1bounds or of a PFactor line, from the factor probability and the cost
+  void choosePM1Bounds();
+
   int    argc_;
   char** argv_;
   std::unique_ptr<io::WorktodoParser> worktodoParser_;
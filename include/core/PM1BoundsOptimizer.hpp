@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace core {
+
+// Bounds of a P-1 run and what they buy
+struct PM1Choice {
+    uint64_t B1 = 0, B2 = 0;            // B2 = 0: no stage 2
+    double probability = 0;             // a factor is found
+    double stage1Transforms = 0, stage2Transforms = 0;
+    double netTransforms = 0;           // expected test transforms saved, minus the cost of P-1
+};
+
+// Chooses B1 and B2 for 2^p - 1, trial factored to 2^tfBits, where a factor saves
+// testsSaved primality tests of p squarings each.
+//
+// Costs are counted in transforms, as the stage 2 planner does: 2 for a squaring of stage 1
+// or of the test, the stage 2 estimate of the plan that fits in the memory of the device.
+// The bounds maximize the expected transforms saved minus the transforms of P-1: the
+// expected tests saved per hour of P-1 alone would be largest with tiny bounds.
+class PM1BoundsOptimizer {
+public:
+    PM1BoundsOptimizer(uint32_t p, double tfBits, double testsSaved, size_t regBytes, size_t baseRegs, uint64_t regBudget);
+
+    // Usual trial-factoring depth of p when it is not known: about 63 bits at 2^20, then
+    // 2.2 bits more each time p doubles
+    static double defaultTfBits(uint32_t p);
+
+    PM1Choice evaluate(uint64_t B1, uint64_t B2) const;
+    PM1Choice optimize() const;
+
+    std::string describe(const PM1Choice& c, double secondsPerTransform) const;
+
+private:
+    uint32_t p_;
+    double tfBits_, testsSaved_;
+    size_t regBytes_, baseRegs_;
+    uint64_t regBudget_;
+};
+
+} // namespace core
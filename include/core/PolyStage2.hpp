@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "marin/engine.h"
+
+namespace core {
+
+// Polynomial P-1 stage 2 ("FFT continuation") on the registers of a Marin engine.
+//
+// f(X) = prod (X - H^(D/2 + j)) over the j of (-D/2, D/2) prime to D, m = phi(D) roots.
+// At the giant step x_k = H^(kD + D/2), x_k - H^(D/2 + j) = H^(D/2 + j) (H^(kD - j) - 1):
+// f(x_k) covers every prime of (kD - D/2, kD + D/2) that does not divide D.
+//
+// The x_k are the geometric progression w r^k, w = H^(D/2), r = w^2, so f is evaluated at
+// m + 1 consecutive giant steps with one polynomial product (Bluestein's chirp transform):
+// 2ik = (k + i)^2 - k^2 - i^2 gives
+//     w^(m^2 + k^2) f(x_k) = sum_i e_i u_(k+i),  e_i = c_i w^(m^2 - i^2 + i),  u_t = w^(t^2),
+// where c_i are the coefficients of f. The left side is f(x_k) times a unit, which does not
+// change the final gcd, and no inverse is needed.
+//
+// Polynomial coefficients are engine registers. Products use Karatsuba down to a schoolbook
+// base case, so a block of m + 1 giant steps costs O(m^1.585) multiplications where the
+// baby-step giant-step loop needs one for each pair (k, j) holding a prime.
+class PolyStage2 {
+public:
+    using Reg = engine::Reg;
+
+    // D even, the registers [firstReg, firstReg + registerCount(D)) are used
+    PolyStage2(const engine& eng, uint64_t D, Reg firstReg);
+
+    static size_t degree(uint64_t D);
+    static size_t registerCount(uint64_t D);
+    // Transforms of a block of giant steps and of init(), for the cost estimates
+    static double blockTransforms(uint64_t D);
+    static double initTransforms(uint64_t D);
+    // The values of D, from 210 to 30030, phi(D) increasing
+    static std::span<const uint64_t> candidates();
+
+    uint64_t D() const { return D_; }
+    size_t blockSize() const { return m_ + 1; }
+    uint64_t nextGiant() const { return k_; }
+
+    // Build f from H (register h, left unchanged) and the chirp sequence from giant step k0
+    void init(Reg h, uint64_t k0);
+    // acc *= w^(m^2 + k^2) f(x_k) for the blockSize() giant steps from nextGiant(), then advance
+    void evaluateBlock(Reg acc);
+
+private:
+    using Poly = std::vector<Reg>;
+    using View = std::span<const Reg>;
+
+    Poly alloc(size_t n);
+    void release(Poly& p);
+    void zero(View c) const;
+    void addTo(View c, View a) const;     // c[i] += a[i]
+    void subFrom(View c, View a) const;   // c[i] -= a[i]
+
+    // c = a * b, |c| = |a| + |b| - 1
+    void mul(View a, View b, View c);
+    void schoolbook(View a, View b, View c);
+    void karatsuba(View a, View b, View c);
+    // Monic product, the leading 1 is implicit: |c| = |a| + |b|
+    void mulMonic(View a, View b, View c);
+
+    static size_t scratch(size_t na, size_t nb);
+
+    const engine& eng_;
+    uint64_t D_;
+    size_t m_;
+    std::vector<Reg> free_;
+
+    Reg tmp_, tmpM_, w_, w2M_, v_;  // scratch, multiplicand scratch, w, w^2 (multiplicand), w^(2t+1)
+    Poly e_;                        // e reversed: e_[i] = e_(m-i)
+    Poly u_;                        // u_t for t = k_ ... k_ + 2m
+    Poly p_;                        // product e_ * u_
+    uint64_t k_ = 0;
+};
+
+} // namespace core
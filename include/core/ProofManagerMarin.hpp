@@ -23,9 +23,12 @@ public:
                  const std::vector<int>& digitWidth,
                  const std::vector<std::string>& knownFactors = {});
     void checkpoint(cl_mem buf, uint32_t iter);    
-    void checkpointMarin(engine::digit host, uint32_t iter);
-    std::filesystem::path proof() const;
+    void checkpointMarin(const engine::digit& host, uint32_t iter);
+    // proofPower == 0 uses the power the checkpoints were saved with
+    std::filesystem::path proof(engine* eng = nullptr, uint32_t proofPower = 0, bool verify = false) const;
     bool shouldCheckpoint(uint32_t iter) const;
+    // Proof checkpoints of a test started by an older version, see ProofSetMarin::importLegacyFiles
+    void importLegacyCheckpoints();
 
 private:
     ProofSetMarin           proofSet_;
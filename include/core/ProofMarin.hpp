@@ -1,8 +1,14 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
 #include <vector>
 #include <filesystem>
+#include "marin/engine.h"
+#include "util/MappedFile.hpp"
 
 namespace core {
 
@@ -16,6 +22,28 @@ public:
     ProofMarin(uint32_t exponent, std::vector<uint32_t> finalResidue, std::vector<std::vector<uint32_t>> intermediateResidues, std::vector<std::string> factors = {})
         : E(exponent), B(std::move(finalResidue)), middles(std::move(intermediateResidues)), knownFactors(std::move(factors)) {}
 
+    // Read-only memory mapping of a proof file. Residues are little-endian byte views
+    // into the mapping (index 0 is B, then the middles); nothing is copied.
+    class Mapped {
+    public:
+        explicit Mapped(const std::filesystem::path& filePath);
+
+        uint32_t E = 0;
+        uint32_t power = 0;
+        std::vector<std::string> knownFactors;
+
+        std::span<const uint8_t> residue(uint32_t i) const;
+        // SHA3 chain of the verifier: h0 = H(B), h(i+1) = H(h(i), middle i)
+        std::vector<std::array<uint64_t, 4>> hashChain() const;
+        ProofMarin toProof() const;
+
+    private:
+        util::MappedFile file_;
+        const uint8_t* data_ = nullptr;
+        size_t size_ = 0;
+        size_t dataOffset_ = 0;
+    };
+
     // File I/O methods for ProofMarin files
     void save(const std::filesystem::path& filePath) const;
     static ProofMarin load(const std::filesystem::path& filePath);
@@ -26,6 +54,13 @@ public:
                                            const std::array<uint64_t, 4>& hash,
                                            const std::vector<uint32_t>& words);
     static uint64_t res64(const std::vector<uint32_t>& words);
+
+    // Check the proof with the engine (at least 3 registers): 3^(2^E) == B.
+    bool verify(engine* eng) const;
+
+private:
+    // Filled by load() from the mapped file, so verify() does not rehash the residues
+    std::vector<std::array<uint64_t, 4>> hashChain_;
 };
 
 } // namespace core
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "core/ProofMarin.hpp"
+#include "marin/engine.h"
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <filesystem>
 
@@ -28,23 +30,39 @@ public:
     const std::vector<std::string> knownFactors; // known factors (for cofactor tests)
 
     ProofSetMarin(uint32_t exponent, uint32_t proofLevel, std::vector<std::string> factors = {});
+    ~ProofSetMarin();
 
     bool shouldCheckpoint(uint32_t iter) const;
+    // Residues live in one preallocated file with a fixed slot per checkpoint point.
+    // save() queues the write to a background thread; load() and flush() wait for it.
     void save(uint32_t iter, const std::vector<uint32_t>& words);
     std::vector<uint32_t> load(uint32_t iter) const;
+    void flush() const;
+    // Moves the <E>/proof/<iter> files of older versions into the store. Only for a Marin PRP
+    // test: the OpenCL ProofSet still writes and reads these files.
+    void importLegacyFiles();
 
     static WordsMarin fromUint64(const std::vector<uint64_t>& host, uint32_t exponent);
     static uint32_t bestPower(uint32_t E);
     static bool isInPoints(uint32_t E, uint32_t power, uint32_t k);
     static std::filesystem::path proofPath(uint32_t E);
+    static std::filesystem::path storePath(uint32_t E);
     static double diskUsageGB(uint32_t E, uint32_t power);
     
-    // Core proof generation algorithm
-    ProofMarin computeProof() const;
+    // Core proof generation algorithm.
+    // With an engine (at least 3 registers) the A^h * B steps run on the device,
+    // otherwise independent nodes of each tree level run on host threads.
+    ProofMarin computeProof(engine* eng = nullptr) const;
+    ProofMarin computeProof(uint32_t npower, engine* eng) const;
 
 private:
+    class Store;
+
     std::vector<uint32_t> points; // checkpoint iteration points
+    std::unique_ptr<Store> store_; // opened on the first save
     
+    std::vector<uint32_t> pointsFor(uint32_t npower) const;
+    uint64_t slotOffset(uint32_t iter) const;
     bool isValidTo(uint32_t limitK) const;
     bool fileExists(uint32_t k) const;
 };
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "marin/engine.h"
+
+namespace core {
+
+// Stage 2 of P-1 on the Marin engine: the algorithm, D and the size of the register file
+struct Stage2Plan {
+    enum class Algo : uint32_t { BabyGiant = 0, Polynomial = 1 };
+
+    Algo algo = Algo::BabyGiant;
+    uint64_t D = 0;
+    size_t babySteps = 0;       // baby steps, or the degree of the polynomial
+    size_t registers = 0;       // registers of the engine, the base registers included
+    double transforms = 0;      // estimated transforms of the whole stage 2
+};
+
+// Chooses the cheapest stage 2 whose registers fit in the memory of the device.
+// Both algorithms get cheaper per prime as D grows, but the tables grow with phi(D): the
+// memory decides how far D can go, and which of the two algorithms wins for (B1, B2].
+class Stage2Planner {
+public:
+    Stage2Planner(uint64_t B1, uint64_t B2, size_t regBytes, size_t baseRegs);
+
+    // Bytes available for the register file. It is a single buffer, below the largest
+    // allocation, and some memory is left for the transform tables and the display.
+    // 2 GiB if the device does not report its memory.
+    static uint64_t deviceBudget(uint64_t globalMem, uint64_t maxAlloc);
+
+    // Cheapest plan of at most budget bytes, polynomial only if forcePoly and one fits.
+    // If nothing fits, the smallest baby-step table.
+    Stage2Plan plan(uint64_t budget, bool forcePoly) const;
+    // The plan of a given algorithm and D, for a resumed stage 2
+    Stage2Plan make(Stage2Plan::Algo algo, uint64_t D) const;
+
+    // Seconds per transform, timing squarings of register r
+    static double secondsPerTransform(const engine& eng, engine::Reg r);
+
+    std::string describe(const Stage2Plan& plan, uint64_t budget, double secondsPerTransform = 0) const;
+
+private:
+    uint64_t B1_, B2_;
+    size_t regBytes_, baseRegs_;
+};
+
+} // namespace core
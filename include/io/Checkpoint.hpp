@@ -0,0 +1,65 @@
+// include/io/Checkpoint.hpp
+#pragma once
+
+#include "util/MappedFile.hpp"
+#include <gmpxx.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace io {
+
+// Checkpoint container shared by all modes.
+// Header: magic "PRMC", format version, section count, crc32 of these three words.
+// Then the sections, each one: tag, crc32 of the payload, payload size (64-bit), payload.
+// Readers look sections up by tag and ignore the ones they do not know, so a mode
+// can add state without breaking the files it already wrote.
+constexpr uint32_t ckptTag(const char (&s)[5]) {
+    return uint32_t(uint8_t(s[0])) | (uint32_t(uint8_t(s[1])) << 8)
+         | (uint32_t(uint8_t(s[2])) << 16) | (uint32_t(uint8_t(s[3])) << 24);
+}
+
+namespace ckpt {
+constexpr uint32_t Magic      = ckptTag("PRMC");
+constexpr uint32_t Version    = 1;
+constexpr size_t HeaderSize   = 4 * sizeof(uint32_t);
+constexpr size_t SectionHead  = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+
+// Sections common to the modes
+constexpr uint32_t Exponent   = ckptTag("EXPO");   // uint32_t p
+constexpr uint32_t Iteration  = ckptTag("ITER");   // loop position, type chosen by the mode
+constexpr uint32_t Elapsed    = ckptTag("TIME");   // double, seconds
+constexpr uint32_t Registers  = ckptTag("REGS");   // engine::get_packed_checkpoint of the live registers
+constexpr uint32_t EngineData = ckptTag("ENGN");   // engine::get_checkpoint, all registers
+} // namespace ckpt
+
+// Sections of a checkpoint file, read through a memory mapping.
+class CheckpointReader {
+public:
+    // False if the file is missing, is not a container or a section fails its crc32
+    bool open(const std::string& file);
+
+    bool has(uint32_t tag) const { return sections_.count(tag) != 0; }
+    std::span<const char> section(uint32_t tag) const;
+
+    // False if the section is missing or its size differs from sizeof(T)
+    template <typename T>
+    bool get(uint32_t tag, T& v) const {
+        auto s = section(tag);
+        if (s.size() != sizeof(T)) return false;
+        std::memcpy(&v, s.data(), sizeof(T));
+        return true;
+    }
+    bool getBytes(uint32_t tag, std::vector<char>& out) const;
+    bool getMpz(uint32_t tag, mpz_class& z) const;
+
+private:
+    util::MappedFile file_;
+    std::map<uint32_t, std::span<const char>> sections_;
+};
+
+} // namespace io
@@ -0,0 +1,70 @@
+// include/io/CheckpointWriter.hpp
+#pragma once
+
+#include "io/Checkpoint.hpp"
+#include <gmpxx.h>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace io {
+
+// Writes checkpoint snapshots on a background thread so the iteration loop
+// only pays for the device read-back. Two snapshot buffers are reused: the
+// loop fills one while the other is being written. At most one write is in
+// flight; submit() waits for the previous one before queuing the next.
+// Snapshots are io::Checkpoint containers; section crc32s are computed on the
+// writer thread. Files are replaced through <file>.new and <file>.old after an fsync.
+class CheckpointWriter {
+public:
+    class Snapshot {
+    public:
+        template <typename T>
+        void put(uint32_t tag, const T& v) { put(tag, &v, sizeof(T)); }
+        void put(uint32_t tag, const void* p, size_t size);
+        // little-endian bytes of a non-negative integer
+        void putMpz(uint32_t tag, const mpz_class& z);
+
+        // Reusable buffer for engine::get_checkpoint
+        std::vector<char>& scratch() { return scratch_; }
+
+    private:
+        friend class CheckpointWriter;
+        std::vector<char> bytes_;   // sections, crc32 filled in by the writer
+        uint32_t count_ = 0;
+        std::vector<char> scratch_;
+    };
+
+    CheckpointWriter();
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // The idle buffer, emptied, to be filled for the next submit()
+    Snapshot& next();
+    // Hand the buffer returned by next() to the writer for `file`.
+    // keepOld = false removes <file>.old once the new file is in place.
+    void submit(const std::string& file, bool keepOld = true);
+    // Block until the write in flight is on disk; false if the last write failed
+    bool wait();
+
+private:
+    void run();
+    bool write(Snapshot& s, const std::string& file, bool keepOld);
+
+    Snapshot buffers_[2];
+    size_t fill_ = 0;          // buffer handed out by next()
+    std::string file_;
+    bool keepOld_ = true;
+    bool queued_ = false;      // a snapshot waits for or is in the writer
+    bool ok_ = true;
+    bool stop_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+};
+
+} // namespace io
@@ -39,6 +39,15 @@ struct CliOptions {
     uint64_t chunk256 = 4;
     uint64_t K = 0;
     uint64_t nmax = 0;
+    bool s1keep = false;
+    std::string s1resume;
+    bool s2poly = false;
+    uint64_t s2mem = 0;
+    uint64_t s2lo = 0, s2hi = 0;
+    std::vector<std::string> s2merge;
+    bool pm1bounds = false;
+    double tfBits = 0;          // 0: the usual depth of the exponent
+    double testsSaved = 1.0;
     bool bsgs = false;
     uint64_t brent = 0; 
     int localCarryPropagationDepth = 8;
@@ -75,6 +84,9 @@ struct CliOptions {
     std::string http_host = "localhost";
     bool ipv4 = true;
     uint64_t max_e_bits = 268'435'456ULL;
+    uint64_t certSquarings = 0;
+    std::string certFile = "";
+    std::string certHash = "";
 
 };
 
@@ -7,13 +7,52 @@ Please give feedback to the authors if improvement is realized. It is distribute
 
 #pragma once
 
+#include <algorithm>
+#include <cstring>
 #include <vector>
 #include <gmp.h>
 
 #include "arith.h"
+#include "file.h"
+#include "util/BitPack.hpp"
+#include "util/GmpUtils.hpp"
 
 class engine
 {
+public:
+	// Host buffer borrowed from a per-thread pool and given back on destruction, so that
+	// conversions repeated in a loop reuse the same memory instead of allocating n words
+	// each time. The content of a borrowed buffer is unspecified.
+	template <typename T>
+	class scratch
+	{
+	private:
+		std::vector<T> _v;
+
+		static std::vector<std::vector<T>> & pool() { thread_local std::vector<std::vector<T>> p; return p; }
+
+		void borrow(const size_t size)
+		{
+			std::vector<std::vector<T>> & p = pool();
+			if (!p.empty()) { _v = std::move(p.back()); p.pop_back(); }
+			_v.resize(size);
+		}
+
+	public:
+		explicit scratch(const size_t size) { borrow(size); }
+		scratch(const scratch & rhs) { borrow(rhs.size()); std::copy(rhs._v.begin(), rhs._v.end(), _v.begin()); }
+		scratch & operator=(const scratch &) = delete;
+		~scratch() { pool().push_back(std::move(_v)); }
+
+		size_t size() const { return _v.size(); }
+		T * data() { return _v.data(); }
+		const T * data() const { return _v.data(); }
+		T & operator[](const size_t i) { return _v[i]; }
+		const T & operator[](const size_t i) const { return _v[i]; }
+		const T * begin() const { return _v.data(); }
+		const T * end() const { return _v.data() + _v.size(); }
+	};
+
 protected:
 	// d is encoded: low 32-bit word is the value and high 32-bit word is the width of the base
 	virtual void get(uint64 * const d, const size_t src) const = 0;
@@ -75,75 +114,98 @@ public:
 	// copy the content of src to a GMP integer. z must be initialized
 	void get_mpz(mpz_t & z, const Reg src) const
 	{
-		std::vector<uint64> data(get_size());
+		scratch<uint64> data(get_size());
 		get(data.data(), src);
 
-		std::vector<uint32> v(get_size() + 1, 0);
-		uint32 * const d32 = v.data();
-
 		bool equal_to_Mp = true;
-		size_t bit_index = 0;
 		for (const uint64 d : data)
 		{
-			const uint32 u = uint32(d);
-			const uint8 width = uint8(d >> 32);
-
-			if (u != (uint64(1) << width) - 1) equal_to_Mp = false;
-
-			const size_t i = bit_index / (8 * sizeof(uint32)), s = bit_index % (8 * sizeof(uint32));
-			d32[i] |= u << s; if (s != 0) d32[i + 1] |= u >> (32 - s);
-
-			bit_index += width;
+			if (uint32(d) != (uint64(1) << uint8(d >> 32)) - 1) { equal_to_Mp = false; break; }
 		}
 
 		if (equal_to_Mp) mpz_set_ui(z, 0);
 		else
 		{
-			size_t d_size = 0;
-			for (size_t i = 0, size = v.size(); i < size; ++i) if (d32[i] != 0) d_size = i + 1;
-			mpz_import(z, d_size, -1, sizeof(uint32), 0, 0, d32);
+			scratch<uint32> v((get_size() + 2) / 2 * 2);	// even: imported as 64-bit words
+			util::packDigits(data.data(), data.size(), v.data(), v.size());
+			util::importWords(z, v.data(), v.size());
 		}
 	}
 
 	// copy a GMP integer to the content of dst.
 	void set_mpz(const Reg dst, const mpz_t & z) const
 	{
-		std::vector<uint64> data(get_size());
+		scratch<uint64> data(get_size());
 		get(data.data(), dst);	// get widths
 
-		std::vector<uint32> v(get_size() + 1, 0);
+		scratch<uint32> v(get_size() + 1);
 		uint32 * const d32 = v.data();
+		std::fill(d32, d32 + v.size(), 0u);
 		size_t d_size = 0;
 		mpz_export(d32, &d_size, -1, sizeof(uint32), 0, 0, z);
 
-		std::vector<uint64> x(get_size());
+		util::unpackDigits(d32, v.size(), data.data(), data.size());
 
-		size_t bit_index = 0;
-		for (uint64 & d : data)
+		set(dst, data.data());
+	}
+
+	// Compact checkpoint of the live registers regs: each one as its packed residue, the digits
+	// concatenated into ceil(q / 32) 32-bit words, followed by the crc32 of these words.
+	void get_packed_checkpoint(std::vector<char> & data, const std::vector<Reg> & regs) const
+	{
+		scratch<uint64> d(get_size());
+		data.clear();
+		for (const Reg r : regs)
 		{
-			const uint8 width = uint8(d >> 32);
+			get(d.data(), r);
+
+			size_t bit_count = 0;
+			for (const uint64 w : d) bit_count += uint8(w >> 32);
+			scratch<uint32> v((bit_count + 31) / 32 + 1);
+			uint32 * const d32 = v.data();
+			util::packDigits(d.data(), d.size(), d32, v.size() - 1);
+
+			const size_t nbytes = (v.size() - 1) * sizeof(uint32);
+			v[v.size() - 1] = File::rc_crc32(0, reinterpret_cast<const char *>(d32), nbytes);
+			const size_t offset = data.size();
+			data.resize(offset + nbytes + sizeof(uint32));
+			std::memcpy(data.data() + offset, d32, nbytes + sizeof(uint32));
+		}
+	}
 
-			const size_t i = bit_index / (8 * sizeof(uint32)), s = bit_index % (8 * sizeof(uint32));
-			uint32 u = d32[i] >> s; if (s != 0) u |= d32[i + 1] << (32 - s);
+	// Restore registers saved with get_packed_checkpoint. False on a size or crc32 mismatch.
+	bool set_packed_checkpoint(const std::vector<Reg> & regs, const std::vector<char> & data) const
+	{
+		if (regs.empty()) return data.empty();
+		scratch<uint64> d(get_size());
+		get(d.data(), regs.front());	// get widths, the same for all registers
 
-			d = (u & ((1u << width) - 1)) | (uint64(width) << 32);
+		size_t bit_count = 0;
+		for (const uint64 w : d) bit_count += uint8(w >> 32);
+		const size_t nwords = (bit_count + 31) / 32;
+		if (data.size() != regs.size() * (nwords + 1) * sizeof(uint32)) return false;
 
-			bit_index += width;
+		scratch<uint32> v(nwords + 1);
+		for (size_t k = 0; k < regs.size(); ++k)
+		{
+			const char * const block = data.data() + k * (nwords + 1) * sizeof(uint32);
+			std::memcpy(v.data(), block, (nwords + 1) * sizeof(uint32));
+			if (File::rc_crc32(0, block, nwords * sizeof(uint32)) != v[nwords]) return false;
+			util::unpackDigits(v.data(), nwords, d.data(), d.size());
+			set(regs[k], d.data());
 		}
-
-		set(dst, data.data());
+		return true;
 	}
 
 	class digit
 	{
 	private:
-		std::vector<uint64> _data;
+		scratch<uint64> _data;
 
 	public:
 		// unsigned digit representation of src using IBDWT base
-		digit(engine * const eng, const Reg src)
+		digit(engine * const eng, const Reg src) : _data(eng->get_size())
 		{
-			_data.resize(eng->get_size());
 			eng->get(_data.data(), src);
 		}
 
@@ -151,6 +213,8 @@ public:
 
 		// get transform size
 		size_t get_size() const { return _data.size(); }
+		// encoded digits, as returned by engine::get
+		const uint64 * data() const { return _data.data(); }
 		// digit[i]
 		uint32 val(const size_t i) const { return uint32(_data[i]); }
 		// base of digit[i] is 2^width[i]
@@ -13,21 +13,74 @@ Please give feedback to the authors if improvement is realized. It is distribute
 
 #include "ocl/kernel.h"
 
-#define CREATE_KERNEL_TRANSFORM(name) _##name = create_kernel_transform(#name);
 #define CREATE_KERNEL_CARRY(name) _##name = create_kernel_carry(#name);
 
-#define DEFINE_FORWARD(u) void forward##u(const size_t src, const uint32 s, const uint32 lm) { ek_fb(_forward##u, src, s, lm, (u / 4) * _chunk##u); }
-#define DEFINE_BACKWARD(u) void backward##u(const size_t src, const uint32 s, const uint32 lm) { ek_fb(_backward##u, src, s, lm, (u / 4) * _chunk##u); }
+class gpu : public ocl::device
+{
+public:
+	// The transform of size n: a first stage of radix u0, then a stage of radix um at root index s and
+	// stride 2^lm, then forward_mul / sqr / mul of size uf (uf = 1 is the n = 4 kernels forward_mul4x1...).
+	// u0 = 0 or um = 0 if the stage is not needed. Only these kernels are compiled, with the plan as constants.
+	struct plan { uint32 u0, um, s, lm, uf; };
 
-#define DEFINE_FORWARD_0(u) void forward##u##_0(const size_t src) { ek_fb_0(_forward##u##_0, 8, src, (u / 4) * _chunk##u); }
-#define DEFINE_BACKWARD_0(u) void backward##u##_0(const size_t src) { ek_fb_0(_backward##u##_0, 8, src, (u / 4) * _chunk##u); }
+	static plan get_plan(const size_t n)
+	{
+		switch (n)
+		{
+			case 1u <<  2:	return plan{ 0, 0, 0, 0, 1 };
+			case 1u <<  3:	return plan{ 0, 0, 0, 0, 8 };
+			case 1u <<  4:	return plan{ 4, 0, 0, 0, 4 };
+			case 1u <<  5:	return plan{ 4, 0, 0, 0, 8 };
+			case 1u <<  6:	return plan{ 16, 0, 0, 0, 4 };
+			case 1u <<  7:	return plan{ 16, 0, 0, 0, 8 };
+			case 1u <<  8:	return plan{ 16, 0, 0, 0, 16 };
+			case 1u <<  9:	return plan{ 16, 0, 0, 0, 32 };
+			case 1u << 10:	return plan{ 16, 0, 0, 0, 64 };
+			case 1u << 11:	return plan{ 16, 0, 0, 0, 128 };
+			case 1u << 12:	return plan{ 64, 0, 0, 0, 64 };
+			case 1u << 13:	return plan{ 64, 0, 0, 0, 128 };
+			case 1u << 14:	return plan{ 64, 0, 0, 0, 256 };
+			case 1u << 15:	return plan{ 64, 0, 0, 0, 512 };
+			case 1u << 16:	return plan{ 64, 0, 0, 0, 1024 };
+			case 1u << 17:	return plan{ 256, 0, 0, 0, 512 };
+			case 1u << 18:	return plan{ 256, 0, 0, 0, 1024 };
+			case 1u << 19:	return plan{ 1024, 0, 0, 0, 512 };
+			case 1u << 20:	return plan{ 1024, 0, 0, 0, 1024 };
+			case 1u << 21:	return plan{ 64, 64, 1024, 8, 512 };
+			case 1u << 22:	return plan{ 64, 64, 1024, 9, 1024 };
+			case 1u << 23:	return plan{ 64, 256, 4096, 8, 512 };
+			case 1u << 24:	return plan{ 64, 256, 4096, 9, 1024 };
+			case 1u << 25:	return plan{ 256, 256, 16384, 8, 512 };
+			case 1u << 26:	return plan{ 256, 256, 16384, 9, 1024 };
+
+			case 5u <<  3:	return plan{ 5, 0, 0, 0, 8 };
+			// sqr16 cannot be applied because we have 80 / 8 = 10 global items and local size = 4
+			case 5u <<  4:	return plan{ 20, 0, 0, 0, 4 };
+			case 5u <<  5:	return plan{ 20, 0, 0, 0, 8 };
+			case 5u <<  6:	return plan{ 20, 0, 0, 0, 16 };
+			case 5u <<  7:	return plan{ 20, 0, 0, 0, 32 };
+			case 5u <<  8:	return plan{ 20, 0, 0, 0, 64 };
+			case 5u <<  9:	return plan{ 20, 0, 0, 0, 128 };
+			case 5u << 10:	return plan{ 80, 0, 0, 0, 64 };
+			case 5u << 11:	return plan{ 80, 0, 0, 0, 128 };
+			case 5u << 12:	return plan{ 80, 0, 0, 0, 256 };
+			case 5u << 13:	return plan{ 80, 0, 0, 0, 512 };
+			case 5u << 14:	return plan{ 320, 0, 0, 0, 256 };
+			case 5u << 15:	return plan{ 320, 0, 0, 0, 512 };
+			case 5u << 16:	return plan{ 320, 0, 0, 0, 1024 };
+			case 5u << 17:	return plan{ 80, 64, 1280, 6, 128 };
+			case 5u << 18:	return plan{ 80, 64, 1280, 7, 256 };
+			case 5u << 19:	return plan{ 80, 256, 5120, 6, 128 };
+			case 5u << 20:	return plan{ 80, 256, 5120, 7, 256 };
+			case 5u << 21:	return plan{ 80, 256, 5120, 8, 512 };
+			case 5u << 22:	return plan{ 80, 256, 5120, 9, 1024 };
+			case 5u << 23:	return plan{ 320, 256, 20480, 8, 512 };
+			case 5u << 24:	return plan{ 320, 256, 20480, 9, 1024 };
 
-#define DEFINE_FORWARD_MUL(u) void forward_mul##u(const size_t src) { ek_fms(_forward_mul##u, 8, src, (u / 4) * _blk##u); }
-#define DEFINE_SQR(u) void sqr##u(const size_t src) { ek_fms(_sqr##u, 8, src, (u / 4) * _blk##u); }
-#define DEFINE_MUL(u) void mul##u(const size_t dst, const size_t src) { ek_mul(_mul##u, 8, dst, src, (u / 4) * _blk##u); }
+			default: throw std::runtime_error("An unexpected error has occurred.");
+		}
+	}
 
-class gpu : public ocl::device
-{
 private:
 	const size_t _n, _n5;
 	const size_t _reg_count;
@@ -39,29 +92,21 @@ private:
 	// reg is the weighted representation of registers R0, R1, ...
 	cl_mem _reg = nullptr, _carry = nullptr, _root = nullptr, _weight = nullptr, _digit_width = nullptr;
 
-	// cl_kernel _forward4 = nullptr, _backward4 = nullptr, _forward16 = nullptr, _backward16 = nullptr;
-	cl_kernel _forward64 = nullptr, _backward64 = nullptr, _forward256 = nullptr, _backward256 = nullptr;
-	// cl_kernel _forward1024 = nullptr, _backward1024 = nullptr;
-
-	cl_kernel _forward4_0 = nullptr, _backward4_0 = nullptr, _forward5_0 = nullptr, _backward5_0 = nullptr;
-	cl_kernel _forward16_0 = nullptr, _backward16_0 = nullptr, _forward20_0 = nullptr, _backward20_0 = nullptr;
-	cl_kernel _forward64_0 = nullptr, _backward64_0 = nullptr, _forward80_0 = nullptr, _backward80_0 = nullptr;
-	cl_kernel _forward256_0 = nullptr, _backward256_0 = nullptr, _forward320_0 = nullptr, _backward320_0 = nullptr;
-	cl_kernel _forward1024_0 = nullptr, _backward1024_0 = nullptr;	// _forward1280_0 = nullptr, _backward1280_0 = nullptr;
-
-	cl_kernel _forward_mul4x1 = nullptr, _sqr4x1 = nullptr, _mul4x1 = nullptr;
-	cl_kernel _forward_mul4 = nullptr, _sqr4 = nullptr, _mul4 = nullptr;
-	cl_kernel _forward_mul8 = nullptr, _sqr8 = nullptr, _mul8 = nullptr;
-	cl_kernel _forward_mul16 = nullptr, _sqr16 = nullptr, _mul16 = nullptr;
-	cl_kernel _forward_mul32 = nullptr, _sqr32 = nullptr, _mul32 = nullptr;
-	cl_kernel _forward_mul64 = nullptr, _sqr64 = nullptr, _mul64 = nullptr;
-	cl_kernel _forward_mul128 = nullptr, _sqr128 = nullptr, _mul128 = nullptr;
-	cl_kernel _forward_mul256 = nullptr, _sqr256 = nullptr, _mul256 = nullptr;
-	cl_kernel _forward_mul512 = nullptr, _sqr512 = nullptr, _mul512 = nullptr;
-	cl_kernel _forward_mul1024 = nullptr, _sqr1024 = nullptr, _mul1024 = nullptr;
-	// cl_kernel _forward_mul2048 = nullptr, _sqr2048 = nullptr, _mul2048 = nullptr;
+	// Host staging of two registers, pinned if the platform allows it (pageable _staging_fallback otherwise).
+	// A transfer in flight on one slot is tracked by its event, the host works on the other one.
+	cl_mem _staging_mem = nullptr;
+	uint64 * _staging = nullptr;
+	std::vector<uint64> _staging_fallback;
+	cl_event _staging_evt[2] = { nullptr, nullptr };
+
+	const plan _plan;
+	size_t _fb0_local = 0, _fbm_local = 0, _fms_step = 0, _fms_local = 0;
+
+	cl_kernel _forward_0 = nullptr, _backward_0 = nullptr, _forward_m = nullptr, _backward_m = nullptr;
+	cl_kernel _forward_mul = nullptr, _sqr = nullptr, _mul = nullptr;
+
 	cl_kernel _carry_weight_mul_p1 = nullptr, _carry_weight_add_p1 = nullptr, _carry_weight_add_neg_p1 = nullptr, _carry_weight_p2 = nullptr;
-	cl_kernel _copy = nullptr, _subtract = nullptr;
+	cl_kernel _copy = nullptr, _subtract = nullptr, _set_int = nullptr;
 
 	std::vector<cl_kernel> _kernels;
 
@@ -85,8 +130,10 @@ public:
 		_chunk64(std::min(std::max(n / 8 * 4 / 64, size_t(1)), size_t(8))),		// 64 * CHUNK64 uint64_2 <= 8KB, workgroup size = (64 / 4) * CHUNK64 <= 128
 		_chunk80(std::min(std::max(n / 8 * 4 / 80, size_t(1)), size_t(8))),		// 80 * CHUNK80 uint64_2 <= 10KB, workgroup size = (80 / 4) * CHUNK80 <= 160
 		_chunk256(std::min(std::max(n / 8 * 4 / 256, size_t(1)), size_t(4))),	// 256 * CHUNK256 uint64_2 <= 16KB, workgroup size = (256 / 4) * CHUNK256 <= 256
-		_chunk320(std::min(std::max(n / 8 * 4 / 320, size_t(1)), size_t(2)))	// 320 * CHUNK320 uint64_2 <= 10KB, workgroup size = (320 / 4) * CHUNK320 <= 160 = 5 * 32
+		_chunk320(std::min(std::max(n / 8 * 4 / 320, size_t(1)), size_t(2))),	// 320 * CHUNK320 uint64_2 <= 10KB, workgroup size = (320 / 4) * CHUNK320 <= 160 = 5 * 32
 		// 1024: 1024 uint64_2 = 16KB, workgroup size = 1024 / 4 = 256, 1280: 1280 uint64_2 = 20KB, workgroup size = 1280 / 4 = 320
+
+		_plan(get_plan(n))
  	{}
 
 	virtual ~gpu() {}
@@ -104,6 +151,29 @@ public:
 	size_t get_chunk80() const { return _chunk80; }
 	size_t get_chunk256() const { return _chunk256; }
 	size_t get_chunk320() const { return _chunk320; }
+	const plan & get_transform_plan() const { return _plan; }
+
+	size_t get_chunk(const uint32 u) const
+	{
+		switch (u)
+		{
+			case 4: return _chunk4; case 5: return _chunk5; case 16: return _chunk16; case 20: return _chunk20;
+			case 64: return _chunk64; case 80: return _chunk80; case 256: return _chunk256; case 320: return _chunk320;
+			case 1024: return _chunk1024; case 1280: return _chunk1280;
+			default: return 0;
+		}
+	}
+
+	size_t get_blk(const uint32 u) const
+	{
+		switch (u)
+		{
+			case 4: return _blk4; case 8: return _blk8; case 16: return _blk16; case 32: return _blk32;
+			case 64: return _blk64; case 128: return _blk128; case 256: return _blk256; case 512: return _blk512;
+			case 1024: return _blk1024; case 2048: return _blk2048;
+			default: return 0;
+		}
+	}
 
 ///////////////////////////////
 
@@ -120,6 +190,13 @@ public:
 			_root = _create_buffer(CL_MEM_READ_ONLY, 3 * n * sizeof(uint64));
 			_weight = _create_buffer(CL_MEM_READ_ONLY, 2 * n * sizeof(uint64));
 			_digit_width = _create_buffer(CL_MEM_READ_ONLY, n * sizeof(uint8));
+
+			_staging = static_cast<uint64 *>(_create_host_buffer(_staging_mem, 2 * n * sizeof(uint64)));
+			if (_staging == nullptr)
+			{
+				_staging_fallback.resize(2 * n);
+				_staging = _staging_fallback.data();
+			}
 		}
 	}
 
@@ -132,6 +209,11 @@ public:
 		{
 			_release_buffer(_reg); _release_buffer(_carry);
 			_release_buffer(_root); _release_buffer(_weight); _release_buffer(_digit_width);
+
+			_wait_event(_staging_evt[0]); _wait_event(_staging_evt[1]);
+			_release_host_buffer(_staging_mem, _staging);
+			_staging = nullptr;
+			_staging_fallback.clear(); _staging_fallback.shrink_to_fit();
 		}
 	}
 
@@ -162,155 +244,30 @@ public:
 #if defined(ocl_debug)
 		std::cout << "Create ocl kernels." << std::endl;
 #endif
-		const size_t n = _n;
-
-		// CREATE_KERNEL_TRANSFORM(forward4);
-		// CREATE_KERNEL_TRANSFORM(backward4);
-		if ((n % 5 != 0) && (n <= 32))
-		{
-			CREATE_KERNEL_TRANSFORM(forward4_0);
-			CREATE_KERNEL_TRANSFORM(backward4_0);
-		}
-		if (n == 40)
-		{
-			CREATE_KERNEL_TRANSFORM(forward5_0);
-			CREATE_KERNEL_TRANSFORM(backward5_0);
-		}
+		const plan & p = _plan;
 
-		// CREATE_KERNEL_TRANSFORM(forward16);
-		// CREATE_KERNEL_TRANSFORM(backward16);
-		if ((n % 5 != 0) && (n >= 64) && (n <= 2048))
-		{
-			CREATE_KERNEL_TRANSFORM(forward16_0);
-			CREATE_KERNEL_TRANSFORM(backward16_0);
-		}
-		if ((n % 5 == 0) && (n >= 80) && (n <= 2560))
+		if (p.u0 != 0)
 		{
-			CREATE_KERNEL_TRANSFORM(forward20_0);
-			CREATE_KERNEL_TRANSFORM(backward20_0);
+			const std::string u0 = std::to_string(p.u0);
+			_forward_0 = create_kernel_transform(("forward" + u0 + "_0").c_str());
+			_backward_0 = create_kernel_transform(("backward" + u0 + "_0").c_str());
+			_fb0_local = (p.u0 / 4) * get_chunk(p.u0);
 		}
 
-		if (n >= 655360)
-		{
-			CREATE_KERNEL_TRANSFORM(forward64);
-			CREATE_KERNEL_TRANSFORM(backward64);
-		}
-		if ((n % 5 != 0) && (n >= 4096))
-		{
-			CREATE_KERNEL_TRANSFORM(forward64_0);
-			CREATE_KERNEL_TRANSFORM(backward64_0);
-		}
-		if ((n % 5 == 0) && (n >= 5120))
+		if (p.um != 0)
 		{
-			CREATE_KERNEL_TRANSFORM(forward80_0);
-			CREATE_KERNEL_TRANSFORM(backward80_0);
+			const std::string um = std::to_string(p.um);
+			_forward_m = create_kernel_transform(("forward" + um).c_str());
+			_backward_m = create_kernel_transform(("backward" + um).c_str());
+			_fbm_local = (p.um / 4) * get_chunk(p.um);
 		}
 
-		if (n >= 2621440)
-		{
-			CREATE_KERNEL_TRANSFORM(forward256);
-			CREATE_KERNEL_TRANSFORM(backward256);
-		}
-		if ((n % 5 != 0) && (n >= 131072))
-		{
-			CREATE_KERNEL_TRANSFORM(forward256_0);
-			CREATE_KERNEL_TRANSFORM(backward256_0);
-		}
-		if ((n % 5 == 0) && (n >= 81920))
-		{
-			CREATE_KERNEL_TRANSFORM(forward320_0);
-			CREATE_KERNEL_TRANSFORM(backward320_0);
-		}
-
-		// CREATE_KERNEL_TRANSFORM(forward1024);
-		// CREATE_KERNEL_TRANSFORM(backward1024);
-		if ((n % 5 != 0) && (n >= 524288) && (n <= 1048576))
-		{
-			CREATE_KERNEL_TRANSFORM(forward1024_0);
-			CREATE_KERNEL_TRANSFORM(backward1024_0);
-		}
-		// if ((n % 5 == 0) && (get_max_workgroup_size() >= 1280 / 4))
-		// {
-		// 	CREATE_KERNEL_TRANSFORM(forward1280_0);
-		// 	CREATE_KERNEL_TRANSFORM(backward1280_0);
-		// }
-
-		if (n == 4)
-		{
-			CREATE_KERNEL_TRANSFORM(forward_mul4x1);
-			CREATE_KERNEL_TRANSFORM(sqr4x1);
-			CREATE_KERNEL_TRANSFORM(mul4x1);
-		}
-
-		if ((n >= 16) && (n <= 80))
-		{
-			CREATE_KERNEL_TRANSFORM(forward_mul4);
-			CREATE_KERNEL_TRANSFORM(sqr4);
-			CREATE_KERNEL_TRANSFORM(mul4);
-		}
-
-		if ((n >= 8) && (n <= 160))
-		{
-			CREATE_KERNEL_TRANSFORM(forward_mul8);
-			CREATE_KERNEL_TRANSFORM(sqr8);
-			CREATE_KERNEL_TRANSFORM(mul8);
-		}
-
-		if ((n >= 256) && (n <= 320))
-		{
-			CREATE_KERNEL_TRANSFORM(forward_mul16);
-			CREATE_KERNEL_TRANSFORM(sqr16);
-			CREATE_KERNEL_TRANSFORM(mul16);
-		}
-
-		if ((n >= 512) && (n <= 640))
-		{
-			CREATE_KERNEL_TRANSFORM(forward_mul32);
-			CREATE_KERNEL_TRANSFORM(sqr32);
-			CREATE_KERNEL_TRANSFORM(mul32);
-		}
-
-		if ((n >= 1024) && (n <= 5120))
-		{
-			CREATE_KERNEL_TRANSFORM(forward_mul64);
-			CREATE_KERNEL_TRANSFORM(sqr64);
-			CREATE_KERNEL_TRANSFORM(mul64);
-		}
-
-		if (n >= 2048)
-		{
-			CREATE_KERNEL_TRANSFORM(forward_mul128);
-			CREATE_KERNEL_TRANSFORM(sqr128);
-			CREATE_KERNEL_TRANSFORM(mul128);
-		}
-
-		if (n >= 16384)
-		{
-			CREATE_KERNEL_TRANSFORM(forward_mul256);
-			CREATE_KERNEL_TRANSFORM(sqr256);
-			CREATE_KERNEL_TRANSFORM(mul256);
-		}
-
-		if (n >= 32768)
-		{
-			CREATE_KERNEL_TRANSFORM(forward_mul512);
-			CREATE_KERNEL_TRANSFORM(sqr512);
-			CREATE_KERNEL_TRANSFORM(mul512);
-		}
-
-		if (n >= 65536)
-		{
-			CREATE_KERNEL_TRANSFORM(forward_mul1024);
-			CREATE_KERNEL_TRANSFORM(sqr1024);
-			CREATE_KERNEL_TRANSFORM(mul1024);
-		}
-
-		// if (get_max_workgroup_size() >= 2048 / 4)
-		// {
-		// 	CREATE_KERNEL_TRANSFORM(forward_mul2048);
-		// 	CREATE_KERNEL_TRANSFORM(sqr2048);
-		// 	CREATE_KERNEL_TRANSFORM(mul2048);
-		// }
+		const std::string uf = (p.uf == 1) ? "4x1" : std::to_string(p.uf);
+		_forward_mul = create_kernel_transform(("forward_mul" + uf).c_str());
+		_sqr = create_kernel_transform(("sqr" + uf).c_str());
+		_mul = create_kernel_transform(("mul" + uf).c_str());
+		_fms_step = (p.uf == 1) ? 4 : 8;
+		_fms_local = (p.uf == 1) ? 0 : (p.uf / 4) * get_blk(p.uf);
 
 		CREATE_KERNEL_CARRY(carry_weight_mul_p1);
 		CREATE_KERNEL_CARRY(carry_weight_add_p1);
@@ -321,6 +278,10 @@ public:
 		_set_kernel_arg(_copy, 0, sizeof(cl_mem), &_reg);
 		_kernels.push_back(_copy);
 
+		_set_int = _create_kernel("set_int");
+		_set_kernel_arg(_set_int, 0, sizeof(cl_mem), &_reg);
+		_kernels.push_back(_set_int);
+
 		_subtract = _create_kernel("subtract");
 		_set_kernel_arg(_subtract, 0, sizeof(cl_mem), &_reg);
 		_set_kernel_arg(_subtract, 1, sizeof(cl_mem), &_weight);
@@ -339,10 +300,59 @@ public:
 
 ///////////////////////////////
 
-	void read_regs(uint64 * const ptr) { _read_buffer(_reg, ptr, _reg_count * _n * sizeof(uint64)); }
-	void write_regs(const uint64 * const ptr) { _write_buffer(_reg, ptr, _reg_count * _n * sizeof(uint64)); }
-	void read_reg(uint64 * const ptr, const size_t index) { _read_buffer(_reg, ptr, _n * sizeof(uint64), index * _n * sizeof(uint64)); }
-	void write_reg(const uint64 * const ptr, const size_t index) { _write_buffer(_reg, ptr, _n * sizeof(uint64), index * _n * sizeof(uint64)); }
+	// Register index is read into the staging buffer, valid until the next transfer
+	const uint64 * read_reg_staged(const size_t index)
+	{
+		const size_t size = _n * sizeof(uint64);
+		_wait_event(_staging_evt[0]);
+		_read_buffer_async(_reg, _staging, size, index * size, _staging_evt[0]);
+		_wait_event(_staging_evt[0]);
+		return _staging;
+	}
+
+	// Fill the returned staging buffer then call write_reg_staged
+	uint64 * staging()
+	{
+		_wait_event(_staging_evt[0]);
+		return _staging;
+	}
+
+	// Does not wait: the write is ordered before the kernels enqueued next
+	void write_reg_staged(const size_t index)
+	{
+		const size_t size = _n * sizeof(uint64);
+		_write_buffer_async(_reg, _staging, size, index * size, _staging_evt[0]);
+	}
+
+	void read_reg(uint64 * const ptr, const size_t index) { std::memcpy(ptr, read_reg_staged(index), _n * sizeof(uint64)); }
+	void write_reg(const uint64 * const ptr, const size_t index) { std::memcpy(staging(), ptr, _n * sizeof(uint64)); write_reg_staged(index); }
+
+	// All registers: the copy of register i to ptr overlaps the transfer of register i + 1
+	void read_regs(uint64 * const ptr)
+	{
+		const size_t n = _n, size = n * sizeof(uint64);
+		_wait_event(_staging_evt[0]); _wait_event(_staging_evt[1]);
+		_read_buffer_async(_reg, _staging, size, 0, _staging_evt[0]);
+		for (size_t i = 0; i < _reg_count; ++i)
+		{
+			const size_t slot = i % 2;
+			if (i + 1 < _reg_count) _read_buffer_async(_reg, &_staging[(1 - slot) * n], size, (i + 1) * size, _staging_evt[1 - slot]);
+			_wait_event(_staging_evt[slot]);
+			std::memcpy(&ptr[i * n], &_staging[slot * n], size);
+		}
+	}
+
+	void write_regs(const uint64 * const ptr)
+	{
+		const size_t n = _n, size = n * sizeof(uint64);
+		for (size_t i = 0; i < _reg_count; ++i)
+		{
+			const size_t slot = i % 2;
+			_wait_event(_staging_evt[slot]);
+			std::memcpy(&_staging[slot * n], &ptr[i * n], size);
+			_write_buffer_async(_reg, &_staging[slot * n], size, i * size, _staging_evt[slot]);
+		}
+	}
 
 	void write_root(const uint64 * const ptr) { _write_buffer(_root, ptr, 3 * _n * sizeof(uint64)); }
 	void write_weight(const uint64 * const ptr) { _write_buffer(_weight, ptr, 2 * _n * sizeof(uint64)); }
@@ -350,15 +360,6 @@ public:
 
 ///////////////////////////////
 
-	void ek_fb(cl_kernel & kernel, const size_t src, const uint32 s, const uint32 lm, const size_t local_size = 0)
-	{
-		const uint32 offset = uint32(src * _n);
-		_set_kernel_arg(kernel, 2, sizeof(uint32), &offset);
-		_set_kernel_arg(kernel, 3, sizeof(uint32), &s);
-		_set_kernel_arg(kernel, 4, sizeof(uint32), &lm);
-		_execute_kernel(kernel, _n / 8, local_size);
-	}
-
 	void ek_fb_0(cl_kernel & kernel, const size_t step, const size_t src, const size_t local_size = 0)
 	{
 		const uint32 offset = uint32(src * _n);
@@ -380,84 +381,15 @@ public:
 		ek_fms(kernel, step, dst, local_size);
 	}
 
-	// DEFINE_FORWARD(4);
-	// DEFINE_BACKWARD(4);
-	DEFINE_FORWARD_0(4);
-	DEFINE_BACKWARD_0(4);
-	DEFINE_FORWARD_0(5);
-	DEFINE_BACKWARD_0(5);
-
-	// DEFINE_FORWARD(16);
-	// DEFINE_BACKWARD(16);
-	DEFINE_FORWARD_0(16);
-	DEFINE_BACKWARD_0(16);
-	DEFINE_FORWARD_0(20);
-	DEFINE_BACKWARD_0(20);
-
-	DEFINE_FORWARD(64);
-	DEFINE_BACKWARD(64);
-	DEFINE_FORWARD_0(64);
-	DEFINE_BACKWARD_0(64);
-	DEFINE_FORWARD_0(80);
-	DEFINE_BACKWARD_0(80);
-
-	DEFINE_FORWARD(256);
-	DEFINE_BACKWARD(256);
-	DEFINE_FORWARD_0(256);
-	DEFINE_BACKWARD_0(256);
-	DEFINE_FORWARD_0(320);
-	DEFINE_BACKWARD_0(320);
-
-	// DEFINE_FORWARD(1024);
-	// DEFINE_BACKWARD(1024);
-	DEFINE_FORWARD_0(1024);
-	DEFINE_BACKWARD_0(1024);
-	// DEFINE_FORWARD_0(1280);
-	// DEFINE_BACKWARD_0(1280);
-
-	void forward_mul4x1(const size_t src) { ek_fms(_forward_mul4x1, 4, src); }
-	void sqr4x1(const size_t src) { ek_fms(_sqr4x1, 4, src); }
-	void mul4x1(const size_t dst, const size_t src) { ek_mul(_mul4x1, 4, dst, src); }
-
-	DEFINE_FORWARD_MUL(4);
-	DEFINE_SQR(4);
-	DEFINE_MUL(4);
-
-	DEFINE_FORWARD_MUL(8);
-	DEFINE_SQR(8);
-	DEFINE_MUL(8);
-
-	DEFINE_FORWARD_MUL(16);
-	DEFINE_SQR(16);
-	DEFINE_MUL(16);
-
-	DEFINE_FORWARD_MUL(32);
-	DEFINE_SQR(32);
-	DEFINE_MUL(32);
-
-	DEFINE_FORWARD_MUL(64);
-	DEFINE_SQR(64);
-	DEFINE_MUL(64);
-
-	DEFINE_FORWARD_MUL(128);
-	DEFINE_SQR(128);
-	DEFINE_MUL(128);
-
-	DEFINE_FORWARD_MUL(256);
-	DEFINE_SQR(256);
-	DEFINE_MUL(256);
-
-	DEFINE_FORWARD_MUL(512);
-	DEFINE_SQR(512);
-	DEFINE_MUL(512);
-
-	DEFINE_FORWARD_MUL(1024);
-	DEFINE_SQR(1024);
-	DEFINE_MUL(1024);
-
-	// DEFINE_FORWARD_MUL(2048);
-	// DEFINE_SQR(2048);
-	// DEFINE_MUL(2048);
+	// The stages of the plan, a stage that is not needed is skipped
+	void forward_0(const size_t src) { if (_forward_0 != nullptr) ek_fb_0(_forward_0, 8, src, _fb0_local); }
+	void backward_0(const size_t src) { if (_backward_0 != nullptr) ek_fb_0(_backward_0, 8, src, _fb0_local); }
+	void forward_m(const size_t src) { if (_forward_m != nullptr) ek_fb_0(_forward_m, 8, src, _fbm_local); }
+	void backward_m(const size_t src) { if (_backward_m != nullptr) ek_fb_0(_backward_m, 8, src, _fbm_local); }
+
+	void forward_mul(const size_t src) { ek_fms(_forward_mul, _fms_step, src, _fms_local); }
+	void sqr(const size_t src) { ek_fms(_sqr, _fms_step, src, _fms_local); }
+	void mul(const size_t dst, const size_t src) { ek_mul(_mul, _fms_step, dst, src, _fms_local); }
 
 	void carry_weight_mul(const size_t src, const uint32 a)
 	{
@@ -499,6 +431,14 @@ public:
 		_execute_kernel(_copy, _n);
 	}
 
+	void set_int(const size_t dst, const uint32 a)
+	{
+		const uint32 offset = uint32(dst * _n);
+		_set_kernel_arg(_set_int, 1, sizeof(uint32), &offset);
+		_set_kernel_arg(_set_int, 2, sizeof(uint32), &a);
+		_execute_kernel(_set_int, _n);
+	}
+
 	void subtract(const size_t src, const uint32 a)
 	{
 		const uint32 offset = uint32(src * _n);
@@ -559,7 +499,14 @@ public:
 
 		src << "#define CWM_WG_SZ\t" << (1u << _gpu->get_lcwm_wg_size()) << "u" << std::endl;
 
-		src << "#define MAX_WG_SZ\t" << _gpu->get_max_workgroup_size() << "u" << std::endl << std::endl;
+		src << "#define MAX_WG_SZ\t" << _gpu->get_max_workgroup_size() << "u" << std::endl;
+
+		const gpu::plan & plan = _gpu->get_transform_plan();
+		src << "#define FB0_SZ\t" << plan.u0 << "u" << std::endl;
+		src << "#define FBM_SZ\t" << plan.um << "u" << std::endl;
+		src << "#define FBM_S\t" << plan.s << "u" << std::endl;
+		src << "#define FBM_LM\t" << plan.lm << std::endl;
+		src << "#define FMS_SZ\t" << plan.uf << "u" << std::endl << std::endl;
 
 		if (!_gpu->read_OpenCL("ocl/kernel.cl", "src/ocl/kernel.h", "src_ocl_kernel", src)) src << src_ocl_kernel;
 
@@ -591,13 +538,7 @@ public:
 
 	void set(const Reg dst, const uint32 a) const override
 	{
-		const size_t n = _n;
-		std::vector<uint64> x(n);
-
-		x[0] = a;	// weight[0] = 1
-		for (size_t k = 1; k < n; ++k) x[k] = 0;
-
-		_gpu->write_reg(x.data(), size_t(dst));
+		_gpu->set_int(size_t(dst), a);	// filled on the device, weight[0] = 1
 	}
 
 	void set(const Reg dst, uint64 * const d) const override
@@ -605,15 +546,15 @@ public:
 		const size_t n = _n;
 		const uint64 * const weight = _weight.data();
 
-		// weight
-		std::vector<uint64> x(n);
+		// weight, in the staging buffer
+		uint64 * const x = _gpu->staging();
 		for (size_t k = 0; k < n; ++k)
 		{
 			const uint64 w = weight[2 * (k / 4 + (k % 4) * (n / 4)) + 0];
 			x[k] = mod_mul(uint32(d[k]), w);
 		}
 
-		_gpu->write_reg(x.data(), size_t(dst));
+		_gpu->write_reg_staged(size_t(dst));
 	}
 
 	void get(uint64 * const d, const Reg src) const override
@@ -622,14 +563,14 @@ public:
 		const uint64 * const weight = _weight.data();
 		const uint8 * const width = _digit_width.data();
 
-		_gpu->read_reg(d, size_t(src));
+		const uint64 * const x = _gpu->read_reg_staged(size_t(src));
 
 		// unweight, carry (strong)
 		uint64 c = 0;
 		for (size_t k = 0; k < n; ++k)
 		{
 			const uint64 wi = weight[2 * (k / 4 + (k % 4) * (n / 4)) + 1];
-			d[k] = adc(mod_mul(d[k], wi), width[k], c);
+			d[k] = adc(mod_mul(x[k], wi), width[k], c);
 		} 
 
 		while (c != 0)
@@ -652,62 +593,11 @@ public:
 
 	void square_mul(const Reg rsrc, const uint32 a = 1) const override
 	{
-		const size_t n = _n, src = size_t(rsrc);
+		const size_t src = size_t(rsrc);
 
-		switch (n)
-		{
-			case 1u <<  2:	_gpu->sqr4x1(src); break;
-			case 1u <<  3:	_gpu->sqr8(src); break;
-			case 1u <<  4:	_gpu->forward4_0(src); _gpu->sqr4(src); _gpu->backward4_0(src); break;
-			case 1u <<  5:	_gpu->forward4_0(src); _gpu->sqr8(src); _gpu->backward4_0(src); break;
-			case 1u <<  6:	_gpu->forward16_0(src); _gpu->sqr4(src); _gpu->backward16_0(src); break;
-			case 1u <<  7:	_gpu->forward16_0(src); _gpu->sqr8(src); _gpu->backward16_0(src); break;
-			case 1u <<  8:	_gpu->forward16_0(src); _gpu->sqr16(src); _gpu->backward16_0(src); break;
-			case 1u <<  9:	_gpu->forward16_0(src); _gpu->sqr32(src); _gpu->backward16_0(src); break;
-			case 1u << 10:	_gpu->forward16_0(src); _gpu->sqr64(src); _gpu->backward16_0(src); break;
-			case 1u << 11:	_gpu->forward16_0(src); _gpu->sqr128(src); _gpu->backward16_0(src); break;
-			case 1u << 12:	_gpu->forward64_0(src); _gpu->sqr64(src); _gpu->backward64_0(src); break;
-			case 1u << 13:	_gpu->forward64_0(src); _gpu->sqr128(src); _gpu->backward64_0(src); break;
-			case 1u << 14:	_gpu->forward64_0(src); _gpu->sqr256(src); _gpu->backward64_0(src); break;
-			case 1u << 15:	_gpu->forward64_0(src); _gpu->sqr512(src); _gpu->backward64_0(src); break;
-			case 1u << 16:	_gpu->forward64_0(src); _gpu->sqr1024(src); _gpu->backward64_0(src); break;
-			case 1u << 17:	_gpu->forward256_0(src); _gpu->sqr512(src); _gpu->backward256_0(src); break;
-			case 1u << 18:	_gpu->forward256_0(src); _gpu->sqr1024(src); _gpu->backward256_0(src); break;
-			case 1u << 19:	_gpu->forward1024_0(src); _gpu->sqr512(src); _gpu->backward1024_0(src); break;
-			case 1u << 20:	_gpu->forward1024_0(src); _gpu->sqr1024(src); _gpu->backward1024_0(src); break;
-			case 1u << 21:	_gpu->forward64_0(src); _gpu->forward64(src, 1024, 8); _gpu->sqr512(src); _gpu->backward64(src, 1024, 8); _gpu->backward64_0(src); break;
-			case 1u << 22:	_gpu->forward64_0(src); _gpu->forward64(src, 1024, 9); _gpu->sqr1024(src); _gpu->backward64(src, 1024, 9); _gpu->backward64_0(src); break;
-			case 1u << 23:	_gpu->forward64_0(src); _gpu->forward256(src, 4096, 8); _gpu->sqr512(src); _gpu->backward256(src, 4096, 8); _gpu->backward64_0(src); break;
-			case 1u << 24:	_gpu->forward64_0(src); _gpu->forward256(src, 4096, 9); _gpu->sqr1024(src); _gpu->backward256(src, 4096, 9); _gpu->backward64_0(src); break;
-			case 1u << 25:	_gpu->forward256_0(src); _gpu->forward256(src, 16384, 8); _gpu->sqr512(src); _gpu->backward256(src, 16384, 8); _gpu->backward256_0(src); break;
-			case 1u << 26:	_gpu->forward256_0(src); _gpu->forward256(src, 16384, 9); _gpu->sqr1024(src); _gpu->backward256(src, 16384, 9); _gpu->backward256_0(src); break;
-
-			case 5u <<  3: _gpu->forward5_0(src); _gpu->sqr8(src); _gpu->backward5_0(src); break;
-			// sqr16 cannot be applied because we have 80 / 8 = 10 global items and local size = 4
-			case 5u <<  4: _gpu->forward20_0(src); _gpu->sqr4(src); _gpu->backward20_0(src); break;
-			case 5u <<  5: _gpu->forward20_0(src); _gpu->sqr8(src); _gpu->backward20_0(src); break;
-			case 5u <<  6: _gpu->forward20_0(src); _gpu->sqr16(src); _gpu->backward20_0(src); break;
-			case 5u <<  7: _gpu->forward20_0(src); _gpu->sqr32(src); _gpu->backward20_0(src); break;
-			case 5u <<  8: _gpu->forward20_0(src); _gpu->sqr64(src); _gpu->backward20_0(src); break;
-			case 5u <<  9: _gpu->forward20_0(src); _gpu->sqr128(src); _gpu->backward20_0(src); break;
-			case 5u << 10: _gpu->forward80_0(src); _gpu->sqr64(src); _gpu->backward80_0(src); break;
-			case 5u << 11: _gpu->forward80_0(src); _gpu->sqr128(src); _gpu->backward80_0(src); break;
-			case 5u << 12: _gpu->forward80_0(src); _gpu->sqr256(src); _gpu->backward80_0(src); break;
-			case 5u << 13: _gpu->forward80_0(src); _gpu->sqr512(src); _gpu->backward80_0(src); break;
-			case 5u << 14: _gpu->forward320_0(src); _gpu->sqr256(src); _gpu->backward320_0(src); break;
-			case 5u << 15: _gpu->forward320_0(src); _gpu->sqr512(src); _gpu->backward320_0(src); break;
-			case 5u << 16: _gpu->forward320_0(src); _gpu->sqr1024(src); _gpu->backward320_0(src); break;
-			case 5u << 17: _gpu->forward80_0(src); _gpu->forward64(src, 1280, 6); _gpu->sqr128(src); _gpu->backward64(src, 1280, 6); _gpu->backward80_0(src); break;
-			case 5u << 18: _gpu->forward80_0(src); _gpu->forward64(src, 1280, 7); _gpu->sqr256(src); _gpu->backward64(src, 1280, 7); _gpu->backward80_0(src); break;
-			case 5u << 19: _gpu->forward80_0(src); _gpu->forward256(src, 5120, 6); _gpu->sqr128(src); _gpu->backward256(src, 5120, 6); _gpu->backward80_0(src); break;
-			case 5u << 20: _gpu->forward80_0(src); _gpu->forward256(src, 5120, 7); _gpu->sqr256(src); _gpu->backward256(src, 5120, 7); _gpu->backward80_0(src); break;
-			case 5u << 21: _gpu->forward80_0(src); _gpu->forward256(src, 5120, 8); _gpu->sqr512(src); _gpu->backward256(src, 5120, 8); _gpu->backward80_0(src); break;
-			case 5u << 22: _gpu->forward80_0(src); _gpu->forward256(src, 5120, 9); _gpu->sqr1024(src); _gpu->backward256(src, 5120, 9); _gpu->backward80_0(src); break;
-			case 5u << 23: _gpu->forward320_0(src); _gpu->forward256(src, 20480, 8); _gpu->sqr512(src); _gpu->backward256(src, 20480, 8); _gpu->backward320_0(src); break;
-			case 5u << 24: _gpu->forward320_0(src); _gpu->forward256(src, 20480, 9); _gpu->sqr1024(src); _gpu->backward256(src, 20480, 9); _gpu->backward320_0(src); break;
-
-			default: throw std::runtime_error("An unexpected error has occurred.");
-		}
+		_gpu->forward_0(src); _gpu->forward_m(src);
+		_gpu->sqr(src);
+		_gpu->backward_m(src); _gpu->backward_0(src);
 
 		_gpu->carry_weight_mul(src, a);
 	}
@@ -716,120 +606,19 @@ public:
 	{
 		if (rsrc != rdst) copy(rdst, rsrc);
 
-		const size_t n = _n, dst = size_t(rdst);
-
-		switch (n)
-		{
-			case 1u <<  2:	_gpu->forward_mul4x1(dst); break;
-			case 1u <<  3:	_gpu->forward_mul8(dst); break;
-			case 1u <<  4:	_gpu->forward4_0(dst); _gpu->forward_mul4(dst); break;
-			case 1u <<  5:	_gpu->forward4_0(dst); _gpu->forward_mul8(dst); break;
-			case 1u <<  6:	_gpu->forward16_0(dst); _gpu->forward_mul4(dst); break;
-			case 1u <<  7:	_gpu->forward16_0(dst); _gpu->forward_mul8(dst); break;
-			case 1u <<  8:	_gpu->forward16_0(dst); _gpu->forward_mul16(dst); break;
-			case 1u <<  9:	_gpu->forward16_0(dst); _gpu->forward_mul32(dst); break;
-			case 1u << 10:	_gpu->forward16_0(dst); _gpu->forward_mul64(dst); break;
-			case 1u << 11:	_gpu->forward16_0(dst); _gpu->forward_mul128(dst); break;
-			case 1u << 12:	_gpu->forward64_0(dst); _gpu->forward_mul64(dst); break;
-			case 1u << 13:	_gpu->forward64_0(dst); _gpu->forward_mul128(dst); break;
-			case 1u << 14:	_gpu->forward64_0(dst); _gpu->forward_mul256(dst); break;
-			case 1u << 15:	_gpu->forward64_0(dst); _gpu->forward_mul512(dst); break;
-			case 1u << 16:	_gpu->forward64_0(dst); _gpu->forward_mul1024(dst); break;
-			case 1u << 17:	_gpu->forward256_0(dst); _gpu->forward_mul512(dst); break;
-			case 1u << 18:	_gpu->forward256_0(dst); _gpu->forward_mul1024(dst); break;
-			case 1u << 19:	_gpu->forward1024_0(dst); _gpu->forward_mul512(dst); break;
-			case 1u << 20:	_gpu->forward1024_0(dst); _gpu->forward_mul1024(dst); break;
-			case 1u << 21:	_gpu->forward64_0(dst); _gpu->forward64(dst, 1024, 8); _gpu->forward_mul512(dst); break;
-			case 1u << 22:	_gpu->forward64_0(dst); _gpu->forward64(dst, 1024, 9); _gpu->forward_mul1024(dst); break;
-			case 1u << 23:	_gpu->forward64_0(dst); _gpu->forward256(dst, 4096, 8); _gpu->forward_mul512(dst); break;
-			case 1u << 24:	_gpu->forward64_0(dst); _gpu->forward256(dst, 4096, 9); _gpu->forward_mul1024(dst); break;
-			case 1u << 25:	_gpu->forward256_0(dst); _gpu->forward256(dst, 16384, 8); _gpu->forward_mul512(dst); break;
-			case 1u << 26:	_gpu->forward256_0(dst); _gpu->forward256(dst, 16384, 9); _gpu->forward_mul1024(dst); break;
-
-			case 5u <<  3: _gpu->forward5_0(dst); _gpu->forward_mul8(dst); break;
-			case 5u <<  4: _gpu->forward20_0(dst); _gpu->forward_mul4(dst); break;
-			case 5u <<  5: _gpu->forward20_0(dst); _gpu->forward_mul8(dst); break;
-			case 5u <<  6: _gpu->forward20_0(dst); _gpu->forward_mul16(dst); break;
-			case 5u <<  7: _gpu->forward20_0(dst); _gpu->forward_mul32(dst); break;
-			case 5u <<  8: _gpu->forward20_0(dst); _gpu->forward_mul64(dst); break;
-			case 5u <<  9: _gpu->forward20_0(dst); _gpu->forward_mul128(dst); break;
-			case 5u << 10: _gpu->forward80_0(dst); _gpu->forward_mul64(dst); break;
-			case 5u << 11: _gpu->forward80_0(dst); _gpu->forward_mul128(dst); break;
-			case 5u << 12: _gpu->forward80_0(dst); _gpu->forward_mul256(dst); break;
-			case 5u << 13: _gpu->forward80_0(dst); _gpu->forward_mul512(dst); break;
-			case 5u << 14: _gpu->forward320_0(dst); _gpu->forward_mul256(dst); break;
-			case 5u << 15: _gpu->forward320_0(dst); _gpu->forward_mul512(dst); break;
-			case 5u << 16: _gpu->forward320_0(dst); _gpu->forward_mul1024(dst); break;
-			case 5u << 17: _gpu->forward80_0(dst); _gpu->forward64(dst, 1280, 6); _gpu->forward_mul128(dst); break;
-			case 5u << 18: _gpu->forward80_0(dst); _gpu->forward64(dst, 1280, 7); _gpu->forward_mul256(dst); break;
-			case 5u << 19: _gpu->forward80_0(dst); _gpu->forward256(dst, 5120, 6); _gpu->forward_mul128(dst); break;
-			case 5u << 20: _gpu->forward80_0(dst); _gpu->forward256(dst, 5120, 7); _gpu->forward_mul256(dst); break;
-			case 5u << 21: _gpu->forward80_0(dst); _gpu->forward256(dst, 5120, 8); _gpu->forward_mul512(dst); break;
-			case 5u << 22: _gpu->forward80_0(dst); _gpu->forward256(dst, 5120, 9); _gpu->forward_mul1024(dst); break;
-			case 5u << 23: _gpu->forward320_0(dst); _gpu->forward256(dst, 20480, 8); _gpu->forward_mul512(dst); break;
-			case 5u << 24: _gpu->forward320_0(dst); _gpu->forward256(dst, 20480, 9); _gpu->forward_mul1024(dst); break;
+		const size_t dst = size_t(rdst);
 
-			default: throw std::runtime_error("An unexpected error has occurred.");
-		}
+		_gpu->forward_0(dst); _gpu->forward_m(dst);
+		_gpu->forward_mul(dst);
 	}
 
 	void mul(const Reg rdst, const Reg rsrc, const uint32 a = 1) const override
 	{
-		const size_t n = _n, dst = size_t(rdst), src = size_t(rsrc);
-
-		switch (n)
-		{
-			case 1u <<  2:	_gpu->mul4x1(dst, src); break;
-			case 1u <<  3:	_gpu->mul8(dst, src); break;
-			case 1u <<  4:	_gpu->forward4_0(dst); _gpu->mul4(dst, src); _gpu->backward4_0(dst); break;
-			case 1u <<  5:	_gpu->forward4_0(dst); _gpu->mul8(dst, src); _gpu->backward4_0(dst); break;
-			case 1u <<  6:	_gpu->forward16_0(dst); _gpu->mul4(dst, src); _gpu->backward16_0(dst); break;
-			case 1u <<  7:	_gpu->forward16_0(dst); _gpu->mul8(dst, src); _gpu->backward16_0(dst); break;
-			case 1u <<  8:	_gpu->forward16_0(dst); _gpu->mul16(dst, src); _gpu->backward16_0(dst); break;
-			case 1u <<  9:	_gpu->forward16_0(dst); _gpu->mul32(dst, src); _gpu->backward16_0(dst); break;
-			case 1u << 10:	_gpu->forward16_0(dst); _gpu->mul64(dst, src); _gpu->backward16_0(dst); break;
-			case 1u << 11:	_gpu->forward16_0(dst); _gpu->mul128(dst, src); _gpu->backward16_0(dst); break;
-			case 1u << 12:	_gpu->forward64_0(dst); _gpu->mul64(dst, src); _gpu->backward64_0(dst); break;
-			case 1u << 13:	_gpu->forward64_0(dst); _gpu->mul128(dst, src); _gpu->backward64_0(dst); break;
-			case 1u << 14:	_gpu->forward64_0(dst); _gpu->mul256(dst, src); _gpu->backward64_0(dst); break;
-			case 1u << 15:	_gpu->forward64_0(dst); _gpu->mul512(dst, src); _gpu->backward64_0(dst); break;
-			case 1u << 16:	_gpu->forward64_0(dst); _gpu->mul1024(dst, src); _gpu->backward64_0(dst); break;
-			case 1u << 17:	_gpu->forward256_0(dst); _gpu->mul512(dst, src); _gpu->backward256_0(dst); break;
-			case 1u << 18:	_gpu->forward256_0(dst); _gpu->mul1024(dst, src); _gpu->backward256_0(dst); break;
-			case 1u << 19:	_gpu->forward1024_0(dst); _gpu->mul512(dst, src); _gpu->backward1024_0(dst); break;
-			case 1u << 20:	_gpu->forward1024_0(dst); _gpu->mul1024(dst, src); _gpu->backward1024_0(dst); break;
-			case 1u << 21:	_gpu->forward64_0(dst); _gpu->forward64(dst, 1024, 8); _gpu->mul512(dst, src); _gpu->backward64(dst, 1024, 8); _gpu->backward64_0(dst); break;
-			case 1u << 22:	_gpu->forward64_0(dst); _gpu->forward64(dst, 1024, 9); _gpu->mul1024(dst, src); _gpu->backward64(dst, 1024, 9); _gpu->backward64_0(dst); break;
-			case 1u << 23:	_gpu->forward64_0(dst); _gpu->forward256(dst, 4096, 8); _gpu->mul512(dst, src); _gpu->backward256(dst, 4096, 8); _gpu->backward64_0(dst); break;
-			case 1u << 24:	_gpu->forward64_0(dst); _gpu->forward256(dst, 4096, 9); _gpu->mul1024(dst, src); _gpu->backward256(dst, 4096, 9); _gpu->backward64_0(dst); break;
-			case 1u << 25:	_gpu->forward256_0(dst); _gpu->forward256(dst, 16384, 8); _gpu->mul512(dst, src); _gpu->backward256(dst, 16384, 8); _gpu->backward256_0(dst); break;
-			case 1u << 26:	_gpu->forward256_0(dst); _gpu->forward256(dst, 16384, 9); _gpu->mul1024(dst, src); _gpu->backward256(dst, 16384, 9); _gpu->backward256_0(dst); break;
-
-			case 5u <<  3: _gpu->forward5_0(dst); _gpu->mul8(dst, src); _gpu->backward5_0(dst); break;
-			case 5u <<  4: _gpu->forward20_0(dst); _gpu->mul4(dst, src); _gpu->backward20_0(dst); break;
-			case 5u <<  5: _gpu->forward20_0(dst); _gpu->mul8(dst, src); _gpu->backward20_0(dst); break;
-			case 5u <<  6: _gpu->forward20_0(dst); _gpu->mul16(dst, src); _gpu->backward20_0(dst); break;
-			case 5u <<  7: _gpu->forward20_0(dst); _gpu->mul32(dst, src); _gpu->backward20_0(dst); break;
-			case 5u <<  8: _gpu->forward20_0(dst); _gpu->mul64(dst, src); _gpu->backward20_0(dst); break;
-			case 5u <<  9: _gpu->forward20_0(dst); _gpu->mul128(dst, src); _gpu->backward20_0(dst); break;
-			case 5u << 10: _gpu->forward80_0(dst); _gpu->mul64(dst, src); _gpu->backward80_0(dst); break;
-			case 5u << 11: _gpu->forward80_0(dst); _gpu->mul128(dst, src); _gpu->backward80_0(dst); break;
-			case 5u << 12: _gpu->forward80_0(dst); _gpu->mul256(dst, src); _gpu->backward80_0(dst); break;
-			case 5u << 13: _gpu->forward80_0(dst); _gpu->mul512(dst, src); _gpu->backward80_0(dst); break;
-			case 5u << 14: _gpu->forward320_0(dst); _gpu->mul256(dst, src); _gpu->backward320_0(dst); break;
-			case 5u << 15: _gpu->forward320_0(dst); _gpu->mul512(dst, src); _gpu->backward320_0(dst); break;
-			case 5u << 16: _gpu->forward320_0(dst); _gpu->mul1024(dst, src); _gpu->backward320_0(dst); break;
-			case 5u << 17: _gpu->forward80_0(dst); _gpu->forward64(dst, 1280, 6); _gpu->mul128(dst, src); _gpu->backward64(dst, 1280, 6); _gpu->backward80_0(dst); break;
-			case 5u << 18: _gpu->forward80_0(dst); _gpu->forward64(dst, 1280, 7); _gpu->mul256(dst, src); _gpu->backward64(dst, 1280, 7); _gpu->backward80_0(dst); break;
-			case 5u << 19: _gpu->forward80_0(dst); _gpu->forward256(dst, 5120, 6); _gpu->mul128(dst, src); _gpu->backward256(dst, 5120, 6); _gpu->backward80_0(dst); break;
-			case 5u << 20: _gpu->forward80_0(dst); _gpu->forward256(dst, 5120, 7); _gpu->mul256(dst, src); _gpu->backward256(dst, 5120, 7); _gpu->backward80_0(dst); break;
-			case 5u << 21: _gpu->forward80_0(dst); _gpu->forward256(dst, 5120, 8); _gpu->mul512(dst, src); _gpu->backward256(dst, 5120, 8); _gpu->backward80_0(dst); break;
-			case 5u << 22: _gpu->forward80_0(dst); _gpu->forward256(dst, 5120, 9); _gpu->mul1024(dst, src); _gpu->backward256(dst, 5120, 9); _gpu->backward80_0(dst); break;
-			case 5u << 23: _gpu->forward320_0(dst); _gpu->forward256(dst, 20480, 8); _gpu->mul512(dst, src); _gpu->backward256(dst, 20480, 8); _gpu->backward320_0(dst); break;
-			case 5u << 24: _gpu->forward320_0(dst); _gpu->forward256(dst, 20480, 9); _gpu->mul1024(dst, src); _gpu->backward256(dst, 20480, 9); _gpu->backward320_0(dst); break;
+		const size_t dst = size_t(rdst), src = size_t(rsrc);
 
-			default: throw std::runtime_error("An unexpected error has occurred.");
-		}
+		_gpu->forward_0(dst); _gpu->forward_m(dst);
+		_gpu->mul(dst, src);
+		_gpu->backward_m(dst); _gpu->backward_0(dst);
 
 		_gpu->carry_weight_mul(dst, a);
 	}
@@ -846,7 +635,7 @@ public:
 		_gpu->carry_weight_sub(size_t(dst), size_t(src)); 
 	}
 
-	size_t get_register_data_size() const override { return _reg_count * _n * sizeof(uint64); }
+	size_t get_register_data_size() const override { return _n * sizeof(uint64); }
 
 	bool get_data(std::vector<char> & data, const Reg src) const override
 	{
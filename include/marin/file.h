@@ -12,6 +12,12 @@ Please give feedback to the authors if improvement is realized. It is distribute
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include "util/Crc32.hpp"
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 class File
 {
@@ -45,40 +51,10 @@ public:
 
 	uint32_t crc32() const { return _crc32; }
 
-	// Rosetta Code, CRC-32, C
+	// CRC-32 of buf continued from crc32, shared with util/Crc32 (hardware accelerated when available)
 	static uint32_t rc_crc32(const uint32_t crc32, const char * const buf, const size_t len)
 	{
-		static uint32_t table[256];
-		static bool have_table = false;
-	
-		// This check is not thread safe; there is no mutex
-		if (!have_table)
-		{
-			// Calculate CRC table
-			for (size_t i = 0; i < 256; ++i)
-			{
-				uint32_t rem = uint32_t(i);  // remainder from polynomial division
-				for (size_t j = 0; j < 8; ++j)
-				{
-					if (rem & 1)
-					{
-						rem >>= 1;
-						rem ^= 0xedb88320;
-					}
-					else rem >>= 1;
-				}
-				table[i] = rem;
-			}
-			have_table = true;
-		}
-
-		uint32_t crc = ~crc32;
-		for (size_t i = 0; i < len; ++i)
-		{
-			const uint8_t octet = uint8_t(buf[i]);  // cast to unsigned octet
-			crc = (crc >> 8) ^ table[(crc & 0xff) ^ octet];
-		}
-		return ~crc;
+		return updateCRC32(crc32, buf, len);
 	}
 
 	bool read(char * const ptr, const size_t size)
@@ -95,6 +71,17 @@ public:
 		return (ret == size * sizeof(char));
 	}
 
+	// Flush the stream and the OS buffers to the device
+	bool sync()
+	{
+		if (std::fflush(_cfile) != 0) return false;
+#ifdef _WIN32
+		return (_commit(_fileno(_cfile)) == 0);
+#else
+		return (fsync(fileno(_cfile)) == 0);
+#endif
+	}
+
 	void write_crc32()
 	{
 		uint32_t crc32 = ~_crc32 ^ 0xa23777ac;
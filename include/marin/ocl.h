@@ -26,6 +26,8 @@ Please give feedback to the authors if improvement is realized. It is distribute
 #include <map>
 #include <algorithm>
 
+#include "opencl/ProgramCache.hpp"
+
 // #define ocl_debug		1
 #define ocl_fast_exec		1
 
@@ -422,17 +424,21 @@ public:
 #if defined(ocl_debug)
 		std::cout <<  "Load ocl program." << std::endl;
 #endif
-		const char * src[1]; src[0] = program_src.c_str();
-		cl_int err_cpws;
-		_program = clCreateProgramWithSource(_context, 1, src, nullptr, &err_cpws);
-		fatal(err_cpws);
-
 		char pgm_options[1024];
 		strcpy(pgm_options, "");
 #if defined(ocl_debug)
 		if (_vendor == EVendor::NVIDIA) strcat(pgm_options, " -cl-nv-verbose");
 		if (_vendor == EVendor::AMD) strcat(pgm_options, " -save-temps=.");
+#else
+		// The source carries the n-dependent #defines, so it is the cache key with the options
+		_program = prmers::ocl::ProgramCache::load(_context, _device, program_src, pgm_options);
+		if (_program != nullptr) return;
 #endif
+		const char * src[1]; src[0] = program_src.c_str();
+		cl_int err_cpws;
+		_program = clCreateProgramWithSource(_context, 1, src, nullptr, &err_cpws);
+		fatal(err_cpws);
+
 		const cl_int err = clBuildProgram(_program, 1, &_device, pgm_options, nullptr, nullptr);
 
 #if !defined(ocl_debug)
@@ -464,6 +470,8 @@ public:
 		std::ofstream file_out((_vendor == EVendor::NVIDIA) ? "pgm.ptx" : "pgm.bin", std::ios::binary);
 		file_out.write(binary.data(), std::streamsize(bin_size));
 		file_out.close();
+#else
+		prmers::ocl::ProgramCache::store(_program, _device, program_src, pgm_options);
 #endif
 	}
 
@@ -527,6 +535,63 @@ protected:
 		fatal(clEnqueueWriteBuffer(_queue, mem, CL_TRUE, offset, size, ptr, 0, nullptr, nullptr));
 	}
 
+protected:
+	// Host memory allocated by the driver (CL_MEM_ALLOC_HOST_PTR), pinned on most platforms, and mapped for its lifetime.
+	// Transfers between it and device buffers are direct DMA copies, without the bounce through a driver buffer.
+	// Returns nullptr if the platform cannot provide it.
+	void * _create_host_buffer(cl_mem & mem, const size_t size)
+	{
+		cl_int err;
+		mem = clCreateBuffer(_context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, size, nullptr, &err);
+		if (err != CL_SUCCESS) { mem = nullptr; return nullptr; }
+		void * const ptr = clEnqueueMapBuffer(_queue, mem, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, size, 0, nullptr, nullptr, &err);
+		if (err != CL_SUCCESS) { _release_buffer(mem); return nullptr; }
+		return ptr;
+	}
+
+protected:
+	void _release_host_buffer(cl_mem & mem, void * const ptr)
+	{
+		if (mem != nullptr)
+		{
+			fatal(clEnqueueUnmapMemObject(_queue, mem, ptr, 0, nullptr, nullptr));
+			_sync();
+			_release_buffer(mem);
+		}
+	}
+
+protected:
+	// Non-blocking transfers, ordered with the kernels by the queue. ptr must not be accessed until evt is complete.
+	void _read_buffer_async(cl_mem & mem, void * const ptr, const size_t size, const size_t offset, cl_event & evt)
+	{
+		// Same safeguard as _read_buffer, with a xorshift generator: std::rand per byte costs more than the transfer.
+		uint64_t x = uint64_t(std::rand()) | 1;
+		char * const cptr = static_cast<char *>(ptr);
+		for (size_t i = 0; i < size; i += sizeof(uint64_t))
+		{
+			x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+			std::memcpy(cptr + i, &x, std::min(sizeof(uint64_t), size - i));
+		}
+		fatal(clEnqueueReadBuffer(_queue, mem, CL_FALSE, offset, size, ptr, 0, nullptr, &evt));
+	}
+
+protected:
+	void _write_buffer_async(cl_mem & mem, const void * const ptr, const size_t size, const size_t offset, cl_event & evt)
+	{
+		fatal(clEnqueueWriteBuffer(_queue, mem, CL_FALSE, offset, size, ptr, 0, nullptr, &evt));
+	}
+
+protected:
+	static void _wait_event(cl_event & evt)
+	{
+		if (evt != nullptr)
+		{
+			fatal(clWaitForEvents(1, &evt));
+			fatal(clReleaseEvent(evt));
+			evt = nullptr;
+		}
+	}
+
 protected:
 	cl_kernel _create_kernel(const char * const kernel_name)
 	{
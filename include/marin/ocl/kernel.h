@@ -48,6 +48,11 @@ static const char * const src_ocl_kernel = \
 "#define CHUNK320	2u\n" \
 "#define CWM_WG_SZ	256u\n" \
 "#define MAX_WG_SZ	256u\n" \
+"#define FB0_SZ		64u\n" \
+"#define FBM_SZ		0u\n" \
+"#define FBM_S		0u\n" \
+"#define FBM_LM		0\n" \
+"#define FMS_SZ		1024u\n" \
 "#endif\n" \
 "\n" \
 "#define sz_t		uint\n" \
@@ -369,7 +374,7 @@ static const char * const src_ocl_kernel = \
 "	storeg2(4, &x[k], m, xl);\n" \
 "}*/\n" \
 "\n" \
-"#if (N_SZ % 5 != 0) && (N_SZ <= 32)\n" \
+"#if (FB0_SZ == 4)\n" \
 "\n" \
 "// Radix-4, first stage\n" \
 "__kernel\n" \
@@ -398,7 +403,7 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "#endif\n" \
-"#if (N_SZ == 40)\n" \
+"#if (FB0_SZ == 5)\n" \
 "\n" \
 "// Radix-5, first stage\n" \
 "__kernel\n" \
@@ -433,7 +438,7 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "#endif\n" \
-"#if (N_SZ == 4)\n" \
+"#if (FMS_SZ == 1)\n" \
 "\n" \
 "// Radix-4\n" \
 "__kernel\n" \
@@ -482,7 +487,7 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "#endif\n" \
-"#if (N_SZ >= 16) && (N_SZ <= 80)\n" \
+"#if (FMS_SZ == 4)\n" \
 "\n" \
 "// 2 x Radix-4\n" \
 "__kernel\n" \
@@ -532,7 +537,7 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "#endif\n" \
-"#if (N_SZ >= 8) && (N_SZ <= 160)\n" \
+"#if (FMS_SZ == 8)\n" \
 "\n" \
 "// Radix-8\n" \
 "__kernel\n" \
@@ -782,7 +787,7 @@ static const char * const src_ocl_kernel = \
 "	backward_4o(4u << lm, &x[ki], 4 * CHUNK16, &X[i], r2i[sj / 4], r4i[sj / 4]);\n" \
 "}*/\n" \
 "\n" \
-"#if (N_SZ % 5 != 0) && (N_SZ >= 64) && (N_SZ <= 2048)\n" \
+"#if (FB0_SZ == 16)\n" \
 "\n" \
 "__kernel\n" \
 "ATTR_FB_16()\n" \
@@ -811,7 +816,7 @@ static const char * const src_ocl_kernel = \
 "\n" \
 "#if (MAX_WG_SZ >= 20 / 4 * CHUNK20)\n" \
 "\n" \
-"#if (N_SZ % 5 == 0) && (N_SZ >= 80) && (N_SZ <= 2560)\n" \
+"#if (FB0_SZ == 20)\n" \
 "\n" \
 "#define ATTR_FB_20()	__attribute__((reqd_work_group_size(20 / 4 * CHUNK20, 1, 1)))\n" \
 "\n" \
@@ -854,13 +859,13 @@ static const char * const src_ocl_kernel = \
 "\n" \
 "#define ATTR_FB_64()	__attribute__((reqd_work_group_size(64 / 4 * CHUNK64, 1, 1)))\n" \
 "\n" \
-"#if (N_SZ >= 655360)\n" \
+"#if (FBM_SZ == 64)\n" \
 "\n" \
 "__kernel\n" \
 "ATTR_FB_64()\n" \
-"void forward64(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset,\n" \
-"	const sz_t s, const uint32 lm)\n" \
+"void forward64(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset)\n" \
 "{\n" \
+"	const sz_t s = FBM_S; const uint32 lm = FBM_LM;\n" \
 "	DECLARE_VAR(64 / 4, CHUNK64);\n" \
 "\n" \
 "	forward_4i(16 * CHUNK64, &X[i], 16u << lm, &x[ki], r2[sj / 16], r4[sj / 16]);\n" \
@@ -869,9 +874,9 @@ static const char * const src_ocl_kernel = \
 "\n" \
 "__kernel\n" \
 "ATTR_FB_64()\n" \
-"void backward64(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset,\n" \
-"	const sz_t s, const uint32 lm)\n" \
+"void backward64(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset)\n" \
 "{\n" \
+"	const sz_t s = FBM_S; const uint32 lm = FBM_LM;\n" \
 "	DECLARE_VAR(64 / 4, CHUNK64);\n" \
 "\n" \
 "	BACKWARD_64_80(CHUNK64);\n" \
@@ -879,7 +884,7 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "#endif\n" \
-"#if (N_SZ % 5 != 0) && (N_SZ >= 4096)\n" \
+"#if (FB0_SZ == 64)\n" \
 "\n" \
 "__kernel\n" \
 "ATTR_FB_64()\n" \
@@ -907,7 +912,7 @@ static const char * const src_ocl_kernel = \
 "#endif\n" \
 "#if (MAX_WG_SZ >= 80 / 4 * CHUNK80)\n" \
 "\n" \
-"#if (N_SZ % 5 == 0) && (N_SZ >= 5120)\n" \
+"#if (FB0_SZ == 80)\n" \
 "\n" \
 "#define ATTR_FB_80()	__attribute__((reqd_work_group_size(80 / 4 * CHUNK80, 1, 1)))\n" \
 "\n" \
@@ -954,13 +959,13 @@ static const char * const src_ocl_kernel = \
 "\n" \
 "#define ATTR_FB_256()	__attribute__((reqd_work_group_size(256 / 4 * CHUNK256, 1, 1)))\n" \
 "\n" \
-"#if (N_SZ >= 2621440)\n" \
+"#if (FBM_SZ == 256)\n" \
 "\n" \
 "__kernel\n" \
 "ATTR_FB_256()\n" \
-"void forward256(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset,\n" \
-"	const sz_t s, const uint32 lm)\n" \
+"void forward256(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset)\n" \
 "{\n" \
+"	const sz_t s = FBM_S; const uint32 lm = FBM_LM;\n" \
 "	DECLARE_VAR(256 / 4, CHUNK256);\n" \
 "\n" \
 "	forward_4i(64 * CHUNK256, &X[i], 64u << lm, &x[ki], r2[sj / 64], r4[sj / 64]);\n" \
@@ -969,9 +974,9 @@ static const char * const src_ocl_kernel = \
 "\n" \
 "__kernel\n" \
 "ATTR_FB_256()\n" \
-"void backward256(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset,\n" \
-"	const sz_t s, const uint32 lm)\n" \
+"void backward256(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset)\n" \
 "{\n" \
+"	const sz_t s = FBM_S; const uint32 lm = FBM_LM;\n" \
 "	DECLARE_VAR(256 / 4, CHUNK256);\n" \
 "\n" \
 "	BACKWARD_256_320(CHUNK256);\n" \
@@ -979,7 +984,7 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "#endif\n" \
-"#if (N_SZ % 5 != 0) && (N_SZ >= 131072)\n" \
+"#if (FB0_SZ == 256)\n" \
 "\n" \
 "__kernel\n" \
 "ATTR_FB_256()\n" \
@@ -1007,7 +1012,7 @@ static const char * const src_ocl_kernel = \
 "#endif\n" \
 "#if (MAX_WG_SZ >= 320 / 4 * CHUNK320)\n" \
 "\n" \
-"#if (N_SZ % 5 == 0) && (N_SZ >= 81920)\n" \
+"#if (FB0_SZ == 320)\n" \
 "\n" \
 "#define ATTR_FB_320()	__attribute__((reqd_work_group_size(320 / 4 * CHUNK320, 1, 1)))\n" \
 "\n" \
@@ -1080,7 +1085,7 @@ static const char * const src_ocl_kernel = \
 "	backward_4o(256u << lm, &x[ki], 256, &X[i], r2i[sj / 256], r4i[sj / 256]);\n" \
 "}*/\n" \
 "\n" \
-"#if (N_SZ % 5 != 0) && (N_SZ >= 524288) && (N_SZ <= 1048576)\n" \
+"#if (FB0_SZ == 1024)\n" \
 "\n" \
 "__kernel\n" \
 "ATTR_FB_1024()\n" \
@@ -1108,7 +1113,7 @@ static const char * const src_ocl_kernel = \
 "#endif\n" \
 "#if (MAX_WG_SZ >= 1280 / 4)\n" \
 "\n" \
-"#if (N_SZ % 5 == 0)\n" \
+"#if (FB0_SZ == 1280)\n" \
 "\n" \
 "#define ATTR_FB_1280()	__attribute__((reqd_work_group_size(1280 / 4, 1, 1)))\n" \
 "\n" \
@@ -1139,7 +1144,7 @@ static const char * const src_ocl_kernel = \
 "\n" \
 "/////////////////////////////////////\n" \
 "\n" \
-"#if (MAX_WG_SZ >= 16 / 4 * BLK16) && (N_SZ >= 256) && (N_SZ <= 320)\n" \
+"#if (MAX_WG_SZ >= 16 / 4 * BLK16) && (FMS_SZ == 16)\n" \
 "\n" \
 "#define DECLARE_VAR_16() \\\n" \
 "	__local uint64_2 X[16 * BLK16]; \\\n" \
@@ -1184,7 +1189,7 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "#endif\n" \
-"#if (MAX_WG_SZ >= 32 / 4 * BLK32) && (N_SZ >= 512) && (N_SZ <= 640)\n" \
+"#if (MAX_WG_SZ >= 32 / 4 * BLK32) && (FMS_SZ == 32)\n" \
 "\n" \
 "#define DECLARE_VAR_32() \\\n" \
 "	__local uint64_2 X[32 * BLK32]; \\\n" \
@@ -1229,7 +1234,7 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "#endif\n" \
-"#if (MAX_WG_SZ >= 64 / 4 * BLK64) && (N_SZ >= 1024) && (N_SZ <= 5120)\n" \
+"#if (MAX_WG_SZ >= 64 / 4 * BLK64) && (FMS_SZ == 64)\n" \
 "\n" \
 "#define DECLARE_VAR_64() \\\n" \
 "	__local uint64_2 X[64 * BLK64]; \\\n" \
@@ -1279,7 +1284,7 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "#endif\n" \
-"#if (MAX_WG_SZ >= 128 / 4 * BLK128) && (N_SZ >= 2048)\n" \
+"#if (MAX_WG_SZ >= 128 / 4 * BLK128) && (FMS_SZ == 128)\n" \
 "\n" \
 "#define DECLARE_VAR_128() \\\n" \
 "	__local uint64_2 X[128 * BLK128]; \\\n" \
@@ -1329,7 +1334,7 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "#endif\n" \
-"#if (MAX_WG_SZ >= 256 / 4 * BLK256) && (N_SZ >= 16384)\n" \
+"#if (MAX_WG_SZ >= 256 / 4 * BLK256) && (FMS_SZ == 256)\n" \
 "\n" \
 "#define DECLARE_VAR_256() \\\n" \
 "	__local uint64_2 X[256 * BLK256]; \\\n" \
@@ -1385,7 +1390,7 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "#endif\n" \
-"#if (MAX_WG_SZ >= 512 / 4 * BLK512) && (N_SZ >= 32768)\n" \
+"#if (MAX_WG_SZ >= 512 / 4 * BLK512) && (FMS_SZ == 512)\n" \
 "\n" \
 "#define DECLARE_VAR_512() \\\n" \
 "	__local uint64_2 X[512 * BLK512]; \\\n" \
@@ -1441,7 +1446,7 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "#endif\n" \
-"#if (MAX_WG_SZ >= 1024 / 4) && (N_SZ >= 65536)\n" \
+"#if (MAX_WG_SZ >= 1024 / 4) && (FMS_SZ == 1024)\n" \
 "\n" \
 "#define DECLARE_VAR_1024() \\\n" \
 "	__local uint64_2 X[1024]; \\\n" \
@@ -1712,6 +1717,13 @@ static const char * const src_ocl_kernel = \
 "}\n" \
 "\n" \
 "__kernel\n" \
+"void set_int(__global uint64 * restrict const reg, const sz_t offset, const uint32 a)\n" \
+"{\n" \
+"	const sz_t gid = (sz_t)get_global_id(0);\n" \
+"	reg[offset + gid] = (gid == 0) ? (uint64)(a) : 0;	// weight[0] = 1\n" \
+"}\n" \
+"\n" \
+"__kernel\n" \
 "void subtract(__global uint64 * restrict const reg, __global const uint64 * restrict const weight,\n" \
 "	__global const uint_8 * restrict const width, const sz_t offset, const uint32 a)\n" \
 "{\n" \
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+
+namespace math {
+
+// Probability that P-1 finds a factor of 2^p - 1.
+//
+// A factor q = 2kp + 1 is found if k is B1-smooth, or B1-smooth but for one prime of
+// (B1, B2]. For an integer N of random size, Dickman's rho gives the first probability,
+// rho(u) with u = ln N / ln B1, and the second one adds
+//     sum over the primes t of (B1, B2] of rho((ln N - ln t) / ln B1) / t,
+// about the integral of rho((ln N - x) / ln B1) / x for x = ln t from ln B1 to ln B2.
+// As usual for Mersenne numbers, there is a factor between 2^b and 2^(b+1) with probability
+// 1/b: the probabilities of the bit levels above the trial-factoring depth are summed.
+class PM1Probability {
+public:
+    // Dickman's rho, from a table of u rho(u) = integral of rho over [u - 1, u] by steps of 1/256
+    static double rho(double u);
+
+    // An integer of the given size, in bits, is B1-smooth but for at most one prime of (B1, B2].
+    // B2 <= B1 is stage 1 only.
+    static double smooth(double bits, uint64_t B1, uint64_t B2);
+
+    // P-1 with B1 and B2 finds a factor of 2^p - 1 known to have no factor below 2^tfBits
+    static double factor(uint32_t p, double tfBits, uint64_t B1, uint64_t B2);
+};
+
+} // namespace math
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+namespace math {
+
+// Primes of [lo, hi] in increasing order, produced lazily by a segmented sieve of Eratosthenes.
+// Segments are bit-packed on the wheel 30 (one byte for each 30 integers, one bit for each
+// residue coprime to 30) and fit in the L2 cache. A batch of segments is sieved by several
+// threads while the previous batch is consumed. Memory is O(sqrt(hi) + threads * segment),
+// whatever the length of the interval. hi must be below 2^62.
+class PrimeSieve {
+public:
+    explicit PrimeSieve(uint64_t lo, uint64_t hi, unsigned threads = 0);
+    ~PrimeSieve();
+    PrimeSieve(const PrimeSieve&) = delete;
+    PrimeSieve& operator=(const PrimeSieve&) = delete;
+
+    // Next prime, 0 once hi is passed
+    uint64_t next();
+
+    // Number of primes in [lo, hi], sieved by segments without storing them
+    static uint64_t count(uint64_t lo, uint64_t hi, unsigned threads = 0);
+
+private:
+    struct Segment {
+        uint64_t base = 0;                  // multiple of 30, the integer of bit 0 of byte 0
+        std::vector<uint8_t> bits;
+    };
+    using Batch = std::vector<Segment>;
+
+    Batch sieveBatch(uint64_t from) const;
+    void sieveSegment(Segment& seg) const;
+    bool advance();
+
+    uint64_t lo_, hi_;
+    unsigned threads_;
+    std::vector<uint32_t> sievingPrimes_;  // 7 <= p <= sqrt(hi)
+    size_t small_ = 0;                      // 2, 3 and 5 already returned
+
+    Batch batch_;
+    size_t segIndex_ = 0, byteIndex_ = 0;  // next byte to read
+    uint64_t byteBase_ = 0;                 // integer of bit 0 of the current byte
+    uint8_t pending_ = 0;                   // bits of the current byte not yet returned
+    uint64_t nextBase_ = 0;                 // first integer of the next batch
+    std::future<Batch> ahead_;
+};
+
+} // namespace math
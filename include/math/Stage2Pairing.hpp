@@ -0,0 +1,51 @@
+#pragma once
+#include "math/PrimeSieve.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace math {
+
+// Prime pairing of the baby-step giant-step P-1 stage 2.
+// A prime q is written q = k*D +/- j with k = round(q / D), 0 < j < D/2 and gcd(j, D) = 1.
+// With the giant step G_k = H^((kD)^2) and the baby step B_j = H^(j^2),
+// G_k - B_j = B_j * (H^((kD-j)(kD+j)) - 1), so one factor covers both kD-j and kD+j.
+// Primes dividing D are not covered: D is built from primes up to 13, always below B1.
+class Stage2Pairing {
+public:
+    // Pairs of the primes of [lo, hi], by increasing giant step
+    Stage2Pairing(uint64_t D, uint64_t lo, uint64_t hi);
+
+    uint64_t D() const { return D_; }
+    // The baby steps j, increasing; a pair refers to a baby step by its index in this list
+    const std::vector<uint32_t>& babySteps() const { return baby_; }
+
+    // Next giant step having at least one pair and the baby indices of its pairs,
+    // increasing. False once hi is passed.
+    bool next(uint64_t& k, std::vector<uint32_t>& pairs);
+
+    // Primes and pairs returned so far
+    uint64_t primes() const { return primes_; }
+    uint64_t pairs() const { return pairs_; }
+
+    // Giant step of q
+    static uint64_t giant(uint64_t D, uint64_t q) { return (q + D / 2) / D; }
+    static std::vector<uint32_t> babySteps(uint64_t D);
+
+    // The values of D, from 210 to 30030
+    static std::span<const uint64_t> candidates();
+    // Estimated number of transforms of a stage 2 over (B1, B2]
+    static double transforms(uint64_t D, uint64_t B1, uint64_t B2);
+
+private:
+    uint64_t D_;
+    std::vector<uint32_t> baby_;
+    std::vector<int32_t> index_;    // j -> baby index, -1 if gcd(j, D) != 1
+    std::vector<uint8_t> used_;     // baby indices of the current giant step
+    PrimeSieve sieve_;
+    uint64_t pending_;              // first prime of the next giant step, 0 at the end
+    uint64_t primes_ = 0, pairs_ = 0;
+};
+
+} // namespace math
@@ -27,6 +27,8 @@ public:
     std::size_t getMaxWorkGroupSize() const noexcept;
     const std::vector<std::size_t>& getMaxWorkItemSizes() const noexcept;
     cl_ulong getLocalMemSize() const noexcept;
+    cl_ulong getGlobalMemSize() const noexcept;
+    cl_ulong getMaxMemAllocSize() const noexcept;
 
     std::size_t getLocalSize() const noexcept;
     std::size_t getLocalSize2() const noexcept;
@@ -54,6 +56,8 @@ private:
     std::size_t maxWorkGroupSize_;
     std::vector<std::size_t> maxWorkItemSizes_;
     cl_ulong localMemSize_;
+    cl_ulong globalMemSize_;
+    cl_ulong maxMemAllocSize_;
 
     std::size_t localSize_;
     std::size_t localSize2_;
@@ -0,0 +1,32 @@
+#pragma once
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 300
+#endif
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+#include <string>
+
+namespace prmers::ocl {
+
+// On-disk cache of built program binaries (CL_PROGRAM_BINARIES).
+// An entry is keyed by the kernel source, the build options (-D defines), the device
+// name and version and the driver version, so any change among them triggers a rebuild.
+// Directory: $PRMERS_KERNEL_CACHE if set (empty disables the cache), otherwise
+// %LOCALAPPDATA%/prmers/kernels, $XDG_CACHE_HOME/prmers/kernels or ~/.cache/prmers/kernels.
+class ProgramCache {
+public:
+    // Program built from the cached binary, nullptr on a miss or if the driver
+    // rejects the binary; the caller then builds from source and calls store().
+    static cl_program load(cl_context context, cl_device_id device,
+                           const std::string& source, const std::string& options);
+
+    // Save the binary of a program built from source. Failures are silent.
+    static void store(cl_program program, cl_device_id device,
+                      const std::string& source, const std::string& options);
+};
+
+} // namespace prmers::ocl
@@ -0,0 +1,32 @@
+// include/util/BitPack.hpp
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace util {
+
+// Packing of IBDWT digits into consecutive bits. Digits have one of two widths
+// (w or w+1 bits, see ibdwt weights_widths); digit i starts at the sum of the widths
+// before it. Large inputs are split into chunks whose bit offsets are found by a
+// prefix sum and packed on several threads; each chunk is a branch-free loop over a
+// 64-bit accumulator, so the words shared by two chunks are the only serial step.
+
+// Engine layout (marin engine::get/set): value in the low 32 bits, width in bits 32..39.
+// out receives outWords words: the packed digits, then zeros. outWords must hold the
+// sum of the widths.
+void packDigits(const uint64_t* digits, size_t n, uint32_t* out, size_t outWords);
+// Inverse of packDigits: the widths are read from digits, the values replaced.
+// Bits past nwords read as zero.
+void unpackDigits(const uint32_t* words, size_t nwords, uint64_t* digits, size_t n);
+
+// Values and widths in separate arrays; values must be below 2^width, width <= 32.
+void packBits(const uint64_t* values, const int* widths, size_t n, uint32_t* out, size_t outWords);
+void unpackBits(const uint32_t* words, size_t nwords, const int* widths, size_t n, uint64_t* values);
+
+// Propagate carries so that every value fits its width; values may start as any
+// 64-bit number. Chunks are normalized in parallel, then the carry out of each chunk
+// is added into the next one (it dies out after a few digits).
+// Returns the carry out of the last digit, of weight 2^(sum of the widths).
+uint64_t normalizeCarries(uint64_t* values, const int* widths, size_t n);
+
+} // namespace util
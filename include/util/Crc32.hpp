@@ -3,6 +3,10 @@
 #include <string>
 #include <cstdint>
 #include <cstddef>
+// CRC-32 of `data` continued from the CRC-32 `crc` of the preceding bytes
+// (0 for the first block). Uses PCLMULQDQ or the ARMv8 CRC instructions when
+// the CPU has them, slicing-by-16 tables otherwise.
+uint32_t updateCRC32(uint32_t crc, const void* data, size_t size);
 uint32_t computeCRC32(const std::string &data);
 uint32_t computeCRC32(const void* data, size_t size);
 std::string toLower(const std::string &s);
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 #include <gmpxx.h>
@@ -7,7 +8,11 @@
 // GMP-based modular arithmetic helpers
 namespace util {
     mpz_class convertToGMP(const std::vector<uint32_t>& words);
+    // z = the little-endian 32-bit words; an even count takes GMP's direct limb copy
+    void importWords(mpz_t z, const uint32_t* words, size_t count);
     std::vector<uint32_t> convertFromGMP(const mpz_class& gmp_val);
+    // Residue of digits v[i] (any 64-bit value) of width widths[i]:
+    // carries normalized, bits packed and imported at once, reduced mod Mp
     mpz_class vectToMpz(const std::vector<uint64_t>& v,
                         const std::vector<int>& widths,
                         const mpz_class& Mp);
@@ -38,6 +38,11 @@ Please give feedback to the authors if improvement is realized. It is distribute
 #define CHUNK320	2u
 #define CWM_WG_SZ	256u
 #define MAX_WG_SZ	256u
+#define FB0_SZ		64u
+#define FBM_SZ		0u
+#define FBM_S		0u
+#define FBM_LM		0
+#define FMS_SZ		1024u
 #endif
 
 #define sz_t		uint
@@ -359,7 +364,7 @@ void backward4(__global uint64 * restrict const reg, __global const uint64 * res
 	storeg2(4, &x[k], m, xl);
 }*/
 
-#if (N_SZ % 5 != 0) && (N_SZ <= 32)
+#if (FB0_SZ == 4)
 
 // Radix-4, first stage
 __kernel
@@ -388,7 +393,7 @@ void backward4_0(__global uint64 * restrict const reg, __global const uint64 * r
 }
 
 #endif
-#if (N_SZ == 40)
+#if (FB0_SZ == 5)
 
 // Radix-5, first stage
 __kernel
@@ -423,7 +428,7 @@ void backward5_0(__global uint64 * restrict const reg, __global const uint64 * r
 }
 
 #endif
-#if (N_SZ == 4)
+#if (FMS_SZ == 1)
 
 // Radix-4
 __kernel
@@ -472,7 +477,7 @@ void mul4x1(__global uint64 * restrict const reg, __global const uint64 * restri
 }
 
 #endif
-#if (N_SZ >= 16) && (N_SZ <= 80)
+#if (FMS_SZ == 4)
 
 // 2 x Radix-4
 __kernel
@@ -522,7 +527,7 @@ void mul4(__global uint64 * restrict const reg, __global const uint64 * restrict
 }
 
 #endif
-#if (N_SZ >= 8) && (N_SZ <= 160)
+#if (FMS_SZ == 8)
 
 // Radix-8
 __kernel
@@ -772,7 +777,7 @@ void backward16(__global uint64 * restrict const reg, __global const uint64 * re
 	backward_4o(4u << lm, &x[ki], 4 * CHUNK16, &X[i], r2i[sj / 4], r4i[sj / 4]);
 }*/
 
-#if (N_SZ % 5 != 0) && (N_SZ >= 64) && (N_SZ <= 2048)
+#if (FB0_SZ == 16)
 
 __kernel
 ATTR_FB_16()
@@ -801,7 +806,7 @@ void backward16_0(__global uint64 * restrict const reg, __global const uint64 *
 
 #if (MAX_WG_SZ >= 20 / 4 * CHUNK20)
 
-#if (N_SZ % 5 == 0) && (N_SZ >= 80) && (N_SZ <= 2560)
+#if (FB0_SZ == 20)
 
 #define ATTR_FB_20()	__attribute__((reqd_work_group_size(20 / 4 * CHUNK20, 1, 1)))
 
@@ -844,13 +849,13 @@ void backward20_0(__global uint64 * restrict const reg, __global const uint64 *
 
 #define ATTR_FB_64()	__attribute__((reqd_work_group_size(64 / 4 * CHUNK64, 1, 1)))
 
-#if (N_SZ >= 655360)
+#if (FBM_SZ == 64)
 
 __kernel
 ATTR_FB_64()
-void forward64(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset,
-	const sz_t s, const uint32 lm)
+void forward64(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset)
 {
+	const sz_t s = FBM_S; const uint32 lm = FBM_LM;
 	DECLARE_VAR(64 / 4, CHUNK64);
 
 	forward_4i(16 * CHUNK64, &X[i], 16u << lm, &x[ki], r2[sj / 16], r4[sj / 16]);
@@ -859,9 +864,9 @@ void forward64(__global uint64 * restrict const reg, __global const uint64 * res
 
 __kernel
 ATTR_FB_64()
-void backward64(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset,
-	const sz_t s, const uint32 lm)
+void backward64(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset)
 {
+	const sz_t s = FBM_S; const uint32 lm = FBM_LM;
 	DECLARE_VAR(64 / 4, CHUNK64);
 
 	BACKWARD_64_80(CHUNK64);
@@ -869,7 +874,7 @@ void backward64(__global uint64 * restrict const reg, __global const uint64 * re
 }
 
 #endif
-#if (N_SZ % 5 != 0) && (N_SZ >= 4096)
+#if (FB0_SZ == 64)
 
 __kernel
 ATTR_FB_64()
@@ -897,7 +902,7 @@ void backward64_0(__global uint64 * restrict const reg, __global const uint64 *
 #endif
 #if (MAX_WG_SZ >= 80 / 4 * CHUNK80)
 
-#if (N_SZ % 5 == 0) && (N_SZ >= 5120)
+#if (FB0_SZ == 80)
 
 #define ATTR_FB_80()	__attribute__((reqd_work_group_size(80 / 4 * CHUNK80, 1, 1)))
 
@@ -944,13 +949,13 @@ void backward80_0(__global uint64 * restrict const reg, __global const uint64 *
 
 #define ATTR_FB_256()	__attribute__((reqd_work_group_size(256 / 4 * CHUNK256, 1, 1)))
 
-#if (N_SZ >= 2621440)
+#if (FBM_SZ == 256)
 
 __kernel
 ATTR_FB_256()
-void forward256(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset,
-	const sz_t s, const uint32 lm)
+void forward256(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset)
 {
+	const sz_t s = FBM_S; const uint32 lm = FBM_LM;
 	DECLARE_VAR(256 / 4, CHUNK256);
 
 	forward_4i(64 * CHUNK256, &X[i], 64u << lm, &x[ki], r2[sj / 64], r4[sj / 64]);
@@ -959,9 +964,9 @@ void forward256(__global uint64 * restrict const reg, __global const uint64 * re
 
 __kernel
 ATTR_FB_256()
-void backward256(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset,
-	const sz_t s, const uint32 lm)
+void backward256(__global uint64 * restrict const reg, __global const uint64 * restrict const root, const sz_t offset)
 {
+	const sz_t s = FBM_S; const uint32 lm = FBM_LM;
 	DECLARE_VAR(256 / 4, CHUNK256);
 
 	BACKWARD_256_320(CHUNK256);
@@ -969,7 +974,7 @@ void backward256(__global uint64 * restrict const reg, __global const uint64 * r
 }
 
 #endif
-#if (N_SZ % 5 != 0) && (N_SZ >= 131072)
+#if (FB0_SZ == 256)
 
 __kernel
 ATTR_FB_256()
@@ -997,7 +1002,7 @@ void backward256_0(__global uint64 * restrict const reg, __global const uint64 *
 #endif
 #if (MAX_WG_SZ >= 320 / 4 * CHUNK320)
 
-#if (N_SZ % 5 == 0) && (N_SZ >= 81920)
+#if (FB0_SZ == 320)
 
 #define ATTR_FB_320()	__attribute__((reqd_work_group_size(320 / 4 * CHUNK320, 1, 1)))
 
@@ -1070,7 +1075,7 @@ void backward1024(__global uint64 * restrict const reg, __global const uint64 *
 	backward_4o(256u << lm, &x[ki], 256, &X[i], r2i[sj / 256], r4i[sj / 256]);
 }*/
 
-#if (N_SZ % 5 != 0) && (N_SZ >= 524288) && (N_SZ <= 1048576)
+#if (FB0_SZ == 1024)
 
 __kernel
 ATTR_FB_1024()
@@ -1098,7 +1103,7 @@ void backward1024_0(__global uint64 * restrict const reg, __global const uint64
 #endif
 #if (MAX_WG_SZ >= 1280 / 4)
 
-#if (N_SZ % 5 == 0)
+#if (FB0_SZ == 1280)
 
 #define ATTR_FB_1280()	__attribute__((reqd_work_group_size(1280 / 4, 1, 1)))
 
@@ -1129,7 +1134,7 @@ void backward1280_0(__global uint64 * restrict const reg, __global const uint64
 
 /////////////////////////////////////
 
-#if (MAX_WG_SZ >= 16 / 4 * BLK16) && (N_SZ >= 256) && (N_SZ <= 320)
+#if (MAX_WG_SZ >= 16 / 4 * BLK16) && (FMS_SZ == 16)
 
 #define DECLARE_VAR_16() \
 	__local uint64_2 X[16 * BLK16]; \
@@ -1174,7 +1179,7 @@ void mul16(__global uint64 * restrict const reg, __global const uint64 * restric
 }
 
 #endif
-#if (MAX_WG_SZ >= 32 / 4 * BLK32) && (N_SZ >= 512) && (N_SZ <= 640)
+#if (MAX_WG_SZ >= 32 / 4 * BLK32) && (FMS_SZ == 32)
 
 #define DECLARE_VAR_32() \
 	__local uint64_2 X[32 * BLK32]; \
@@ -1219,7 +1224,7 @@ void mul32(__global uint64 * restrict const reg, __global const uint64 * restric
 }
 
 #endif
-#if (MAX_WG_SZ >= 64 / 4 * BLK64) && (N_SZ >= 1024) && (N_SZ <= 5120)
+#if (MAX_WG_SZ >= 64 / 4 * BLK64) && (FMS_SZ == 64)
 
 #define DECLARE_VAR_64() \
 	__local uint64_2 X[64 * BLK64]; \
@@ -1269,7 +1274,7 @@ void mul64(__global uint64 * restrict const reg, __global const uint64 * restric
 }
 
 #endif
-#if (MAX_WG_SZ >= 128 / 4 * BLK128) && (N_SZ >= 2048)
+#if (MAX_WG_SZ >= 128 / 4 * BLK128) && (FMS_SZ == 128)
 
 #define DECLARE_VAR_128() \
 	__local uint64_2 X[128 * BLK128]; \
@@ -1319,7 +1324,7 @@ void mul128(__global uint64 * restrict const reg, __global const uint64 * restri
 }
 
 #endif
-#if (MAX_WG_SZ >= 256 / 4 * BLK256) && (N_SZ >= 16384)
+#if (MAX_WG_SZ >= 256 / 4 * BLK256) && (FMS_SZ == 256)
 
 #define DECLARE_VAR_256() \
 	__local uint64_2 X[256 * BLK256]; \
@@ -1375,7 +1380,7 @@ void mul256(__global uint64 * restrict const reg, __global const uint64 * restri
 }
 
 #endif
-#if (MAX_WG_SZ >= 512 / 4 * BLK512) && (N_SZ >= 32768)
+#if (MAX_WG_SZ >= 512 / 4 * BLK512) && (FMS_SZ == 512)
 
 #define DECLARE_VAR_512() \
 	__local uint64_2 X[512 * BLK512]; \
@@ -1431,7 +1436,7 @@ void mul512(__global uint64 * restrict const reg, __global const uint64 * restri
 }
 
 #endif
-#if (MAX_WG_SZ >= 1024 / 4) && (N_SZ >= 65536)
+#if (MAX_WG_SZ >= 1024 / 4) && (FMS_SZ == 1024)
 
 #define DECLARE_VAR_1024() \
 	__local uint64_2 X[1024]; \
@@ -1701,6 +1706,13 @@ void copy(__global uint64 * restrict const reg, const sz_t offset_y, const sz_t
 	reg[offset_y + gid] = reg[offset_x + gid];
 }
 
+__kernel
+void set_int(__global uint64 * restrict const reg, const sz_t offset, const uint32 a)
+{
+	const sz_t gid = (sz_t)get_global_id(0);
+	reg[offset + gid] = (gid == 0) ? (uint64)(a) : 0;	// weight[0] = 1
+}
+
 __kernel
 void subtract(__global uint64 * restrict const reg, __global const uint64 * restrict const weight,
 	__global const uint_8 * restrict const width, const sz_t offset, const uint32 a)
@@ -118,7 +118,7 @@ using core::algo::hex_to_le_bytes_pad4;
 using core::algo::buildE2;
 using core::algo::product_prefix_fit_u64;
 using core::algo::product_tree_range_u64;
-using core::algo::compute_X_with_dots;
+using core::algo::compute_X;
 using core::algo::gcd_with_dots;
 
 
@@ -274,12 +274,21 @@ App::App(int argc, char** argv)
       io::WorktodoParser wp{o.worktodo_path};
       if (auto e = wp.parse()) {
             o.exponent     = e->exponent;
-            o.mode         = e->prpTest ? "prp" : (e->llTest ? "ll" : (e->pm1Test ? "pm1" : ""));
+            o.mode         = e->prpTest ? "prp" : (e->llTest ? "ll" : (e->pm1Test ? "pm1" : (e->certTest ? "cert" : "")));
             o.aid          = e->aid;
             o.knownFactors = e->knownFactors;
             if (e->pm1Test) {
                 o.B1 = e->B1;
                 o.B2 = e->B2;
+                if (e->B1 == 0) {
+                    o.pm1bounds  = true;
+                    o.tfBits     = e->tfBits;
+                    o.testsSaved = e->testsSaved;
+                }
+            }
+            if (e->certTest) {
+                o.certSquarings = e->certSquarings;
+                o.proof = false;
             }
             hasWorktodoEntry_ = true;
       }
@@ -798,6 +807,14 @@ int App::run() {
         rc = runMemtestOpenCL();
         ran = true;
     }
+    if(options.mode == "cert"){
+        rc = runCertMarin();
+        ran = true;
+    }
+    // -pm1bounds, or a PFactor line: the bounds are chosen for both P-1 backends
+    if (options.mode == "pm1" && options.pm1bounds && options.s2merge.empty() && options.exponent > 89) {
+        choosePM1Bounds();
+    }
     if (options.mode == "llsafe") {
         rc = runLlSafeMarin();
         ran = true;
@@ -806,6 +823,10 @@ int App::run() {
         rc = runLlSafeMarinDoubling();
         ran = true;
     }
+    else if (options.mode == "pm1" && !options.s2merge.empty()) {
+        rc = runPM1Stage2Merge();
+        ran = true;
+    }
     else if (options.mode == "pm1" && options.marin /*&& options.B2 <= 0*/) {
         if (options.exponent > 89) {
             int rc_local = 0;
@@ -817,13 +838,21 @@ int App::run() {
             const std::string s2f = s2.str();
 
             bool haveS1 = File(s1f).exists() || File(s1f + ".old").exists();
-            bool haveS2 = File(s2f).exists() || File(s2f + ".old").exists() || File(s2f + ".new").exists();
+            // a stage-2 checkpoint of other bounds is not resumed, stage 1 decides as without it
+            bool haveS2 = pm1Stage2Resumable(s2f, static_cast<uint32_t>(options.exponent), options.B1, options.B2);
+            // an unfinished stage 1, or one below B1, is resumed or extended by stage 1
+            if (haveS1 && !haveS2)
+                haveS1 = options.B2 > 0 && pm1Stage1Complete(File(s1f).exists() ? s1f : s1f + ".old", static_cast<uint32_t>(options.exponent), options.B1);
+
+            // -s1resume: the stage 1 of a Prime95 or GMP-ECM save file
+            const bool haveResume = !options.s1resume.empty();
 
-            if ((haveS2 || haveS1) && options.nmax == 0  && options.K == 0) {
+            if ((haveS2 || haveS1 || haveResume) && options.nmax == 0  && options.K == 0) {
                 std::ostringstream msg;
                 msg << "Detected P-1 checkpoint(s): "
                     << (haveS2 ? "[Stage 2] " : "")
                     << (haveS1 ? "[Stage 1] " : "")
+                    << (haveResume ? "[" + options.s1resume + "] " : "")
                     << "→ jumping to runPM1Stage2Marin()";
                 std::cout << msg.str() << std::endl;
                 if (guiServer_) { guiServer_->appendLog(msg.str()); guiServer_->setStatus("Resuming P-1 Stage 2"); }
@@ -0,0 +1,91 @@
+#include "core/PM1BoundsOptimizer.hpp"
+#include "core/Stage2Planner.hpp"
+#include "math/PM1Probability.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace core {
+
+namespace {
+
+constexpr double kRatios[] = { 1, 5, 10, 20, 30, 50, 75, 100, 150, 200, 300, 500, 1000 };
+
+// x to two significant digits, as bounds are written
+uint64_t roundBound(double x) {
+    if (x < 100) return uint64_t(std::llround(x));
+    const double scale = std::pow(10.0, std::floor(std::log10(x)) - 1);
+    return uint64_t(std::llround(x / scale) * scale);
+}
+
+} // namespace
+
+PM1BoundsOptimizer::PM1BoundsOptimizer(uint32_t p, double tfBits, double testsSaved, size_t regBytes, size_t baseRegs, uint64_t regBudget)
+    : p_(p), tfBits_(tfBits), testsSaved_(testsSaved), regBytes_(regBytes), baseRegs_(baseRegs), regBudget_(regBudget) {}
+
+double PM1BoundsOptimizer::defaultTfBits(uint32_t p) {
+    return std::max(60.0, 63.0 + 2.17 * (std::log2(double(p)) - 20.0));
+}
+
+PM1Choice PM1BoundsOptimizer::evaluate(uint64_t B1, uint64_t B2) const {
+    PM1Choice c;
+    c.B1 = B1;
+    c.B2 = (B2 > B1) ? B2 : 0;
+    c.probability = math::PM1Probability::factor(p_, tfBits_, B1, c.B2);
+    // E has about B1 / ln 2 bits, a squaring each
+    c.stage1Transforms = 2.0 * double(B1) / std::log(2.0);
+    if (c.B2 != 0) c.stage2Transforms = Stage2Planner(B1, c.B2, regBytes_, baseRegs_).plan(regBudget_, false).transforms;
+    const double testTransforms = testsSaved_ * 2.0 * double(p_);
+    c.netTransforms = c.probability * testTransforms - c.stage1Transforms - c.stage2Transforms;
+    return c;
+}
+
+PM1Choice PM1BoundsOptimizer::optimize() const {
+    const double testTransforms = testsSaved_ * 2.0 * double(p_);
+    PM1Choice best = evaluate(1000, 0);
+    auto consider = [&](double B1, double B2) {
+        const PM1Choice c = evaluate(uint64_t(B1), uint64_t(B2));
+        if (c.netTransforms > best.netTransforms) best = c;
+    };
+
+    // A coarse grid, B1 while stage 1 costs less than the tests it may save
+    for (double B1 = 1000; 2.0 * B1 / std::log(2.0) < testTransforms; B1 *= 1.2)
+        for (const double r : kRatios) consider(B1, B1 * r);
+
+    // then smaller steps around the best point
+    for (double step = 1.1; step > 1.005; step = std::sqrt(step)) {
+        bool moved = true;
+        while (moved) {
+            moved = false;
+            const PM1Choice c = best;
+            const double B1 = double(c.B1), B2 = double(std::max(c.B2, c.B1));
+            for (const double f1 : { 1 / step, 1.0, step })
+                for (const double f2 : { 1 / step, 1.0, step }) {
+                    if (f1 == 1.0 && f2 == 1.0) continue;
+                    consider(std::max(1000.0, B1 * f1), B2 * f2);
+                }
+            moved = (best.B1 != c.B1 || best.B2 != c.B2);
+        }
+    }
+
+    const uint64_t B1 = roundBound(double(best.B1));
+    return evaluate(B1, best.B2 ? std::max(roundBound(double(best.B2)), B1) : 0);
+}
+
+std::string PM1BoundsOptimizer::describe(const PM1Choice& c, double secondsPerTransform) const {
+    std::ostringstream oss;
+    oss << "P-1 bounds for 2^" << p_ << " - 1, trial factored to 2^" << std::fixed << std::setprecision(1) << tfBits_
+        << ", " << testsSaved_ << " tests saved: B1 = " << c.B1 << ", B2 = " << c.B2
+        << ", probability " << std::setprecision(2) << 100 * c.probability << "%, "
+        << std::scientific << std::setprecision(3) << c.stage1Transforms << " + " << c.stage2Transforms << " transforms";
+    const double s = (c.stage1Transforms + c.stage2Transforms) * secondsPerTransform;
+    if (s > 0) {
+        const uint64_t t = uint64_t(s);
+        oss << ", about " << t / 3600 << "h " << (t % 3600) / 60 << "m " << t % 60 << "s, "
+            << std::fixed << std::setprecision(4) << c.probability * testsSaved_ * 3600 / s << " tests saved per hour";
+    }
+    return oss.str();
+}
+
+} // namespace core
@@ -0,0 +1,296 @@
+#include "core/PolyStage2.hpp"
+#include <algorithm>
+#include <bit>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+
+namespace core {
+
+namespace {
+
+// Schoolbook below: a Karatsuba step trades one product of halves for about 5 n additions
+constexpr size_t kSchoolbook = 4;
+
+// Fixed registers: tmp_, tmpM_, w_, w2M_, v_
+constexpr size_t kFixedRegs = 5;
+
+// D = 210 * c, phi(D) grows by 48 each step, then 2310 * c and 30030
+constexpr uint64_t kCandidates[] = { 210, 420, 630, 840, 1050, 1260, 1470, 1680, 1890,
+                                     2310, 4620, 6930, 9240, 11550, 13860, 30030 };
+
+// Transforms of c = a * b, as done by mul(). The recursion meets few sizes, they are
+// remembered: the bounds optimizer asks for many plans.
+double mulTransforms(size_t na, size_t nb) {
+    if (na == 0 || nb == 0) return 0;
+    if (na < nb) std::swap(na, nb);
+    // a multiplicand per coefficient of b, then a multiplication per pair
+    if (nb <= kSchoolbook) return double(nb) + 2.0 * double(na) * double(nb);
+    thread_local std::map<std::pair<size_t, size_t>, double> known;
+    if (auto it = known.find({na, nb}); it != known.end()) return it->second;
+    double t = 0;
+    if (na != nb) {
+        for (size_t off = 0; off < na; off += nb) t += mulTransforms(std::min(nb, na - off), nb);
+    } else {
+        const size_t h = na / 2, hi = na - h;
+        t = mulTransforms(h, h) + 2 * mulTransforms(hi, hi);
+    }
+    known.emplace(std::make_pair(na, nb), t);
+    return t;
+}
+
+// Transforms of dst = src^e
+double powTransforms(uint64_t e) {
+    return 1.0 + 2.0 * double(std::bit_width(e)) + 2.0 * double(std::popcount(e));
+}
+
+} // namespace
+
+PolyStage2::PolyStage2(const engine& eng, uint64_t D, Reg firstReg)
+    : eng_(eng), D_(D), m_(degree(D)) {
+    if (D_ % 2 != 0 || m_ == 0) throw std::invalid_argument("PolyStage2: D must be even");
+    tmp_ = firstReg; tmpM_ = firstReg + 1; w_ = firstReg + 2; w2M_ = firstReg + 3; v_ = firstReg + 4;
+    const size_t n = registerCount(D_);
+    for (size_t i = n; i-- > kFixedRegs; ) free_.push_back(firstReg + i);
+}
+
+// phi(D): D is even, the j prime to D are the odd ones
+size_t PolyStage2::degree(uint64_t D) {
+    if (D % 2 != 0) return 0;
+    uint64_t phi = D, n = D;
+    for (uint64_t f = 2; f * f <= n; ++f) {
+        if (n % f != 0) continue;
+        while (n % f == 0) n /= f;
+        phi -= phi / f;
+    }
+    if (n > 1) phi -= phi / n;
+    return size_t(phi);
+}
+
+// Reserved scratch of mul(a, b, c), mirroring its recursion
+size_t PolyStage2::scratch(size_t na, size_t nb) {
+    if (na == 0 || nb == 0) return 0;
+    if (na < nb) std::swap(na, nb);
+    if (nb <= kSchoolbook) return 0;
+    if (na != nb) {
+        size_t s = 0;
+        for (size_t off = 0; off < na; off += nb) {
+            const size_t len = std::min(nb, na - off);
+            s = std::max(s, len + nb - 1 + scratch(len, nb));
+        }
+        return s;
+    }
+    const size_t hi = na - na / 2;
+    return 4 * hi - 1 + scratch(hi, hi);
+}
+
+size_t PolyStage2::registerCount(uint64_t D) {
+    const size_t m = degree(D);
+    // e (m + 1), u (2m + 1) and their product (3m + 1) stay allocated. The product tree of
+    // init() peaks at 2m plus the scratch of m/2 x m/2, well below.
+    return kFixedRegs + (6 * m + 3) + scratch(m + 1, 2 * m + 1);
+}
+
+double PolyStage2::blockTransforms(uint64_t D) {
+    const size_t m = degree(D);
+    // product, m + 1 multiplications of the accumulator, m + 1 chirp steps
+    return mulTransforms(m + 1, 2 * m + 1) + 3.0 * double(m + 1) + 5.0 * double(m + 1);
+}
+
+double PolyStage2::initTransforms(uint64_t D) {
+    const size_t m = degree(D);
+    double t = 2.0 * powTransforms(D / 2) + double(D);        // w, the roots
+    for (size_t d = 1; d < m; d *= 2) t += double(m / (2 * d)) * mulTransforms(d, d);
+    t += 8.0 * double(m) + powTransforms(m);                   // weights
+    t += 10.0 * double(m) + 3.0 * powTransforms(~uint64_t(0)); // chirp, k0 < 2^64
+    return t;
+}
+
+std::span<const uint64_t> PolyStage2::candidates() {
+    return kCandidates;
+}
+
+PolyStage2::Poly PolyStage2::alloc(size_t n) {
+    if (n > free_.size()) throw std::logic_error("PolyStage2: out of registers");
+    Poly p(free_.end() - std::ptrdiff_t(n), free_.end());
+    free_.resize(free_.size() - n);
+    return p;
+}
+
+void PolyStage2::release(Poly& p) {
+    free_.insert(free_.end(), p.begin(), p.end());
+    p.clear();
+}
+
+void PolyStage2::zero(View c) const {
+    for (const Reg r : c) eng_.set(r, 0u);
+}
+
+void PolyStage2::addTo(View c, View a) const {
+    for (size_t i = 0; i < a.size(); ++i) eng_.add(c[i], a[i]);
+}
+
+void PolyStage2::subFrom(View c, View a) const {
+    for (size_t i = 0; i < a.size(); ++i) eng_.sub_reg(c[i], a[i]);
+}
+
+void PolyStage2::mul(View a, View b, View c) {
+    if (a.empty() || b.empty()) return;
+    if (a.size() < b.size()) std::swap(a, b);
+    if (b.size() <= kSchoolbook) { schoolbook(a, b, c); return; }
+    if (a.size() == b.size()) { karatsuba(a, b, c); return; }
+
+    // unbalanced: slices of a of the size of b
+    const size_t nb = b.size();
+    zero(c);
+    for (size_t off = 0; off < a.size(); off += nb) {
+        const size_t len = std::min(nb, a.size() - off);
+        Poly t = alloc(len + nb - 1);
+        mul(a.subspan(off, len), b, t);
+        addTo(c.subspan(off, t.size()), t);
+        release(t);
+    }
+}
+
+void PolyStage2::schoolbook(View a, View b, View c) {
+    zero(c);
+    for (size_t j = 0; j < b.size(); ++j) {
+        eng_.set_multiplicand(tmpM_, b[j]);
+        for (size_t i = 0; i < a.size(); ++i) {
+            eng_.copy(tmp_, a[i]);
+            eng_.mul(tmp_, tmpM_);
+            eng_.add(c[i + j], tmp_);
+        }
+    }
+}
+
+// a = a0 + a1 X^h: a b = P0 + (P1 - P0 - P2) X^h + P2 X^2h, P1 = (a0 + a1)(b0 + b1)
+void PolyStage2::karatsuba(View a, View b, View c) {
+    const size_t n = a.size(), h = n / 2, hi = n - h;
+    Poly sa = alloc(hi), sb = alloc(hi), t = alloc(2 * hi - 1);
+    for (size_t i = 0; i < hi; ++i) {
+        eng_.copy(sa[i], a[h + i]);
+        eng_.copy(sb[i], b[h + i]);
+        if (i < h) { eng_.add(sa[i], a[i]); eng_.add(sb[i], b[i]); }
+    }
+
+    mul(a.first(h), b.first(h), c.first(2 * h - 1));
+    eng_.set(c[2 * h - 1], 0u);
+    mul(a.subspan(h), b.subspan(h), c.subspan(2 * h));
+    mul(sa, sb, t);
+
+    subFrom(t, c.first(2 * h - 1));
+    subFrom(t, c.subspan(2 * h));
+    addTo(c.subspan(h), t);
+    release(t); release(sb); release(sa);
+}
+
+void PolyStage2::mulMonic(View a, View b, View c) {
+    const size_t n = a.size() + b.size();
+    mul(a, b, c.first(n - 1));
+    eng_.set(c[n - 1], 0u);
+    addTo(c.subspan(a.size()), b);
+    addTo(c.subspan(b.size()), a);
+}
+
+void PolyStage2::init(Reg h, uint64_t k0) {
+    const size_t m = m_;
+
+    // w = H^(D/2), w^2
+    eng_.copy(tmp_, h);
+    eng_.pow(w_, tmp_, D_ / 2);
+    eng_.copy(tmp_, w_);
+    eng_.square_mul(tmp_);
+    eng_.set_multiplicand(w2M_, tmp_);
+
+    // Roots H^s, 0 < s < D, s - D/2 prime to D: s - D/2 is odd, s goes by H^2
+    eng_.copy(tmp_, h);
+    eng_.square_mul(tmp_);
+    eng_.set_multiplicand(tmpM_, tmp_);
+    const uint64_t half = D_ / 2, s0 = (half % 2 == 0) ? 1 : 2;
+    eng_.copy(v_, h);
+    if (s0 == 2) eng_.square_mul(v_);
+    std::vector<Poly> level;
+    for (uint64_t s = s0; s < D_; s += 2) {
+        const uint64_t j = (s > half) ? s - half : half - s;
+        if (std::gcd(j, D_) == 1) {
+            Poly leaf = alloc(1);
+            eng_.set(leaf[0], 0u);
+            eng_.sub_reg(leaf[0], v_);
+            level.push_back(std::move(leaf));
+        }
+        if (s + 2 < D_) eng_.mul(v_, tmpM_);
+    }
+
+    // Product tree of the monic linear factors
+    while (level.size() > 1) {
+        std::vector<Poly> next;
+        for (size_t i = 0; i < level.size(); i += 2) {
+            if (i + 1 == level.size()) { next.push_back(std::move(level[i])); break; }
+            Poly c = alloc(level[i].size() + level[i + 1].size());
+            mulMonic(level[i], level[i + 1], c);
+            release(level[i + 1]); release(level[i]);
+            next.push_back(std::move(c));
+        }
+        level = std::move(next);
+    }
+    Poly f = std::move(level[0]);
+
+    // e_i = c_i w^(m^2 - i^2 + i), c_m = 1. z_i = w^(m^2 - i^2 + i) = z_(i+1) w^(2i) and z_m = w^m.
+    Poly e = alloc(m + 1);
+    eng_.set(e[0], 1u);
+    for (size_t i = 1; i < m; ++i) { eng_.copy(e[i], e[i - 1]); eng_.mul(e[i], w2M_); }
+    eng_.copy(tmp_, w_);
+    eng_.pow(v_, tmp_, m);
+    eng_.copy(e[m], v_);
+    for (size_t i = m; i-- > 0; ) {
+        eng_.set_multiplicand(tmpM_, e[i]);
+        eng_.mul(v_, tmpM_);
+        eng_.set_multiplicand(tmpM_, v_);
+        eng_.copy(e[i], f[i]);
+        eng_.mul(e[i], tmpM_);
+    }
+    release(f);
+    e_.assign(e.rbegin(), e.rend());
+
+    // u_t = w^(t^2) for t = k0 ... k0 + 2m: u_(t+1) = u_t w^(2t+1)
+    u_ = alloc(2 * m + 1);
+    eng_.copy(tmp_, w_);
+    eng_.pow(u_[0], tmp_, k0);
+    eng_.copy(tmp_, u_[0]);
+    eng_.pow(u_[0], tmp_, k0);
+    eng_.copy(tmp_, w_);
+    eng_.pow(v_, tmp_, 2 * k0 + 1);
+    for (size_t t = 1; t <= 2 * m; ++t) {
+        eng_.set_multiplicand(tmpM_, v_);
+        eng_.copy(u_[t], u_[t - 1]);
+        eng_.mul(u_[t], tmpM_);
+        eng_.mul(v_, w2M_);
+    }
+
+    p_ = alloc(3 * m + 1);
+    k_ = k0;
+}
+
+void PolyStage2::evaluateBlock(Reg acc) {
+    const size_t m = m_;
+
+    // p_(m + k) = sum_i e_i u_(k+i)
+    mul(e_, u_, p_);
+    for (size_t k = 0; k <= m; ++k) {
+        eng_.set_multiplicand(tmpM_, p_[m + k]);
+        eng_.mul(acc, tmpM_);
+    }
+
+    // slide the chirp window by m + 1
+    k_ += m + 1;
+    std::rotate(u_.begin(), u_.begin() + std::ptrdiff_t(m + 1), u_.end());
+    for (size_t t = m; t <= 2 * m; ++t) {
+        eng_.set_multiplicand(tmpM_, v_);
+        eng_.copy(u_[t], u_[t - 1]);
+        eng_.mul(u_[t], tmpM_);
+        eng_.mul(v_, w2M_);
+    }
+}
+
+} // namespace core
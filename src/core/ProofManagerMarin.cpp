@@ -22,8 +22,11 @@
  */
 #include "core/ProofManagerMarin.hpp"
 #include "io/JsonBuilder.hpp"
+#include "util/BitPack.hpp"
 #include <vector>
 #include <iostream>
+#include <stdexcept>
+#include <system_error>
 
 namespace core {
 
@@ -50,81 +53,33 @@ void ProofManagerMarin::checkpoint(cl_mem buf, uint32_t iter) {
     // Get residue from NTT buffer using compactBits
     auto words = io::JsonBuilder::compactBits(host, digitWidth_, exponent_);
     
-    // Save in PRPLL-compatible format
+    // Queued to the residue store; the CRC is taken from memory, no read-back
     proofSet_.save(iter, words);
-    
-    // Verify the checkpoint by loading it back and comparing
-    try {
-        auto loadedWords = proofSet_.load(iter);
-        
-        // Compare the saved and loaded data
-        if (words.size() != loadedWords.size()) {
-            std::cerr << "Warning: Checkpoint validation failed: size mismatch (" 
-                      << words.size() << " vs " << loadedWords.size() << ")" << std::endl;
-            return;
-        }
-        
-        for (size_t i = 0; i < words.size(); ++i) {
-            if (words[i] != loadedWords[i]) {
-                std::cerr << "Warning: Checkpoint validation failed: data mismatch at word " 
-                          << i << " (0x" << words[i] << " vs 0x" << loadedWords[i] << ")" << std::endl;
-                return;
-            }
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "Warning: Checkpoint validation failed at iteration " << iter 
-                  << ": " << e.what() << std::endl;
-    }
 }
 
 bool ProofManagerMarin::shouldCheckpoint(uint32_t iter) const {
   return proofSet_.shouldCheckpoint(iter);
 }
 
-void ProofManagerMarin::checkpointMarin(engine::digit host, uint32_t iter)
+void ProofManagerMarin::importLegacyCheckpoints()
 {
-    if (!proofSet_.shouldCheckpoint(iter)) return;
-
-    digitWidth_.resize(host.get_size());
-    std::vector<uint64_t> digits(host.get_size());
+    proofSet_.importLegacyFiles();
+}
 
-    for (size_t i = 0; i < host.get_size(); ++i)
-    {
-        digits[i] = host.val(i);
-        digitWidth_[i] = static_cast<uint8_t>(host.width(i));
-    }
+void ProofManagerMarin::checkpointMarin(const engine::digit& host, uint32_t iter)
+{
+    if (!proofSet_.shouldCheckpoint(iter)) return;
 
-    auto words = io::JsonBuilder::compactBits(digits, digitWidth_, exponent_);
+    std::vector<uint32_t> words((exponent_ - 1) / 32 + 1);
+    util::packDigits(host.data(), host.get_size(), words.data(), words.size());
     proofSet_.save(iter, words);
-
-    try
-    {
-        auto loadedWords = proofSet_.load(iter);
-        if (words.size() != loadedWords.size())
-        {
-            std::cerr << "Warning: Checkpoint validation failed: size mismatch (" << words.size() << " vs " << loadedWords.size() << ")" << std::endl;
-            return;
-        }
-        for (size_t i = 0; i < words.size(); ++i)
-        {
-            if (words[i] != loadedWords[i])
-            {
-                std::cerr << "Warning: Checkpoint validation failed: data mismatch at word " << i << " (0x" << words[i] << " vs 0x" << loadedWords[i] << ")" << std::endl;
-                return;
-            }
-        }
-    }
-    catch (const std::exception& e)
-    {
-        std::cerr << "Warning: Checkpoint validation failed at iteration " << iter << ": " << e.what() << std::endl;
-    }
 }
 
 
-std::filesystem::path ProofManagerMarin::proof() const {
+std::filesystem::path ProofManagerMarin::proof(engine* eng, uint32_t proofPower, bool verify) const {
     try {
         // Generate proof from collected checkpoints
-        ProofMarin proof = proofSet_.computeProof();
+        ProofMarin proof = proofSet_.computeProof((proofPower == 0) ? proofSet_.power : proofPower, eng);
         
         // Create proof file name: {exponent}-{power}.proof
         std::string filename = std::to_string(exponent_) + "-" + 
@@ -136,10 +91,22 @@ std::filesystem::path ProofManagerMarin::proof() const {
         proof.save(proofFilePath);
         
         // Check the proof was saved correctly by attempting to load it
+        bool valid = true;
         try {
             auto loadedProof = ProofMarin::load(proofFilePath);
+            // Verify generated proof
+            if (verify && eng != nullptr) {
+                valid = loadedProof.verify(eng);
+            }
         } catch (const std::exception& e) {
             std::cerr << "Warning: Proof file validation failed: " << e.what() << std::endl;
+            valid = false;
+        }
+        // A proof that cannot be read back or does not verify must not be submitted
+        if (!valid) {
+            std::error_code ec;
+            std::filesystem::remove(proofFilePath, ec);
+            throw std::runtime_error("Proof verification failed for " + proofFilePath.string());
         }
         
         return proofFilePath;
@@ -150,4 +117,4 @@ std::filesystem::path ProofManagerMarin::proof() const {
     }
 }
 
-} // namespace core
\ No newline at end of file
+} // namespace core
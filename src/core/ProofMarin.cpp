@@ -21,8 +21,15 @@
  */
 #include "core/ProofMarin.hpp"
 #include "io/Sha3Hash.h"
+#include "util/GmpUtils.hpp"
+#include "util/Timer.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
+#include <iostream>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -52,21 +59,19 @@ void ProofMarin::save(const std::filesystem::path& filePath) const {
     throw std::runtime_error("Error writing ProofMarin file header: " + filePath.string());
   }
 
-  // Helper function to write a residue
+  // Helper function to write a residue as one little-endian block
+  const uint32_t nBytes = (E - 1) / 8 + 1;
+  std::vector<uint8_t> bytes(nBytes);
   auto writeResidue = [&](const std::vector<uint32_t>& residue) {
-    uint32_t nBytes = (E - 1) / 8 + 1;
-    
-    // Write the residue data as bytes in little-endian format
-    for (uint32_t byteIdx = 0; byteIdx < nBytes; ++byteIdx) {
-      uint32_t wordIdx = byteIdx / 4;
-      uint32_t byteInWord = byteIdx % 4;
-      
-      uint8_t byte = 0;
-      if (wordIdx < residue.size()) {
-        byte = static_cast<uint8_t>((residue[wordIdx] >> (byteInWord * 8)) & 0xFF);
+    std::fill(bytes.begin(), bytes.end(), uint8_t(0));
+    if constexpr (std::endian::native == std::endian::little) {
+      std::memcpy(bytes.data(), residue.data(), std::min<size_t>(nBytes, residue.size() * sizeof(uint32_t)));
+    } else {
+      for (uint32_t byteIdx = 0; byteIdx < nBytes && byteIdx / 4 < residue.size(); ++byteIdx) {
+        bytes[byteIdx] = static_cast<uint8_t>(residue[byteIdx / 4] >> ((byteIdx % 4) * 8));
       }
-      file.write(reinterpret_cast<const char*>(&byte), 1);
     }
+    file.write(reinterpret_cast<const char*>(bytes.data()), nBytes);
   };
 
   // Write final residue B first
@@ -82,26 +87,33 @@ void ProofMarin::save(const std::filesystem::path& filePath) const {
   }
 }
 
-ProofMarin ProofMarin::load(const std::filesystem::path& filePath) {
-  std::ifstream file(filePath, std::ios::binary);
-  if (!file) {
+ProofMarin::Mapped::Mapped(const std::filesystem::path& filePath) {
+  if (!file_.open(filePath)) {
     throw std::runtime_error("Cannot open ProofMarin file: " + filePath.string());
   }
+  data_ = file_.data();
+  size_ = file_.size();
 
-  // Parse ASCII header
-  std::string line;
-  uint32_t version = 0, hashsize = 0, power = 0, exponent = 0;
-  std::vector<std::string> factors;
+  // Parse the ASCII header: "PRP PROOF" then VERSION, HASHSIZE, POWER, NUMBER.
+  // Binary data starts after NUMBER
+  size_t pos = 0;
+  auto nextLine = [&](std::string& line) {
+    if (pos >= size_) return false;
+    const uint8_t* nl = static_cast<const uint8_t*>(std::memchr(data_ + pos, '\n', size_ - pos));
+    if (nl == nullptr) return false;
+    line.assign(reinterpret_cast<const char*>(data_ + pos), static_cast<size_t>(nl - (data_ + pos)));
+    pos = static_cast<size_t>(nl - data_) + 1;
+    return true;
+  };
 
-  // Read and validate "PRP ProofMarin"
-  if (!std::getline(file, line) || line != "PRP PROOF") {
+  std::string line;
+  uint32_t version = 0, hashsize = 0;
+  if (!nextLine(line) || line != "PRP PROOF") {
     throw std::runtime_error("Invalid ProofMarin file header: " + filePath.string());
   }
 
-  // Parse header fields (VERSION, HASHSIZE, POWER, NUMBER)
-  // Binary data starts after NUMBER
   for (int i = 0; i < 4; ++i) {
-    if (!std::getline(file, line)) {
+    if (!nextLine(line)) {
       throw std::runtime_error("Incomplete header in ProofMarin file: " + filePath.string());
     }
     
@@ -114,34 +126,20 @@ ProofMarin ProofMarin::load(const std::filesystem::path& filePath) {
     std::string value = line.substr(eq_pos + 1);
     
     if (key == "VERSION") {
-      version = std::stoul(value);
+      version = static_cast<uint32_t>(std::stoul(value));
     } else if (key == "HASHSIZE") {
-      hashsize = std::stoul(value);
+      hashsize = static_cast<uint32_t>(std::stoul(value));
     } else if (key == "POWER") {
-      power = std::stoul(value);
+      power = static_cast<uint32_t>(std::stoul(value));
     } else if (key == "NUMBER" && !value.empty() && value[0] == 'M') {
-      // Parse cofactor format: M18178631/36357263/145429049
-      std::string numberStr = value.substr(1); // Remove 'M'
+      // Cofactor format: M18178631/36357263/145429049, or a plain Mersenne number: M18178631
+      std::string numberStr = value.substr(1);
       size_t slashPos = numberStr.find('/');
-      
-      if (slashPos != std::string::npos) {
-        // Cofactor format detected
-        exponent = std::stoul(numberStr.substr(0, slashPos));
-        
-        // Parse factors separated by '/'
-        std::string factorStr = numberStr.substr(slashPos + 1);
-        size_t start = 0;
-        size_t end = factorStr.find('/');
-        
-        while (end != std::string::npos) {
-          factors.push_back(factorStr.substr(start, end - start));
-          start = end + 1;
-          end = factorStr.find('/', start);
-        }
-        factors.push_back(factorStr.substr(start)); // Last factor
-      } else {
-        // Mersenne number: M18178631
-        exponent = std::stoul(numberStr);
+      E = static_cast<uint32_t>(std::stoul(numberStr.substr(0, slashPos)));
+      while (slashPos != std::string::npos) {
+        size_t end = numberStr.find('/', slashPos + 1);
+        knownFactors.push_back(numberStr.substr(slashPos + 1, end == std::string::npos ? std::string::npos : end - slashPos - 1));
+        slashPos = end;
       }
     } else {
       throw std::runtime_error("Unexpected header field: " + key);
@@ -158,44 +156,62 @@ ProofMarin ProofMarin::load(const std::filesystem::path& filePath) {
   if (power == 0 || power > 12) {
     throw std::runtime_error("Invalid ProofMarin power: " + std::to_string(power));
   }
-  if (exponent == 0) {
+  if (E == 0) {
     throw std::runtime_error("Invalid or missing exponent in ProofMarin file");
   }
 
-  // Helper function to read a residue
-  auto readResidue = [&]() -> std::vector<uint32_t> {
-    uint32_t nBytes = (exponent - 1) / 8 + 1;
-    uint32_t nWords = (exponent + 31) / 32;
+  dataOffset_ = pos;
+  const size_t nBytes = (E - 1) / 8 + 1;
+  if (size_ - dataOffset_ < (power + 1) * nBytes) {
+    throw std::runtime_error("Error reading residue data from ProofMarin file");
+  }
+}
+
+std::span<const uint8_t> ProofMarin::Mapped::residue(uint32_t i) const {
+  const size_t nBytes = (E - 1) / 8 + 1;
+  return {data_ + dataOffset_ + i * nBytes, nBytes};
+}
+
+std::vector<std::array<uint64_t, 4>> ProofMarin::Mapped::hashChain() const {
+  std::vector<std::array<uint64_t, 4>> chain;
+  chain.reserve(power + 1);
+  auto B = residue(0);
+  io::SHA3 first;
+  chain.push_back(std::move(first.update(B.data(), static_cast<uint32_t>(B.size()))).finish());
+  for (uint32_t i = 1; i <= power; ++i) {
+    auto M = residue(i);
+    io::SHA3 hasher;
+    hasher.update(chain.back().data(), static_cast<uint32_t>(chain.back().size() * sizeof(uint64_t)));
+    chain.push_back(std::move(hasher.update(M.data(), static_cast<uint32_t>(M.size()))).finish());
+  }
+  return chain;
+}
+
+ProofMarin ProofMarin::Mapped::toProof() const {
+  const uint32_t nWords = (E + 31) / 32;
+  auto toWords = [&](std::span<const uint8_t> bytes) {
     std::vector<uint32_t> data(nWords, 0);
-    
-    for (uint32_t byteIdx = 0; byteIdx < nBytes; ++byteIdx) {
-      uint8_t byte;
-      file.read(reinterpret_cast<char*>(&byte), 1);
-      if (!file.good()) {
-        throw std::runtime_error("Error reading residue data from ProofMarin file");
-      }
-      
-      uint32_t wordIdx = byteIdx / 4;
-      uint32_t byteInWord = byteIdx % 4;
-      
-      if (wordIdx < nWords) {
-        data[wordIdx] |= (static_cast<uint32_t>(byte) << (byteInWord * 8));
+    if constexpr (std::endian::native == std::endian::little) {
+      std::memcpy(data.data(), bytes.data(), bytes.size());
+    } else {
+      for (size_t byteIdx = 0; byteIdx < bytes.size(); ++byteIdx) {
+        data[byteIdx / 4] |= static_cast<uint32_t>(bytes[byteIdx]) << ((byteIdx % 4) * 8);
       }
     }
-    
     return data;
   };
 
-  // Read final residue B
-  auto B = readResidue();
-
-  // Read intermediate residues (middles)
   std::vector<std::vector<uint32_t>> middles;
-  for (uint32_t i = 0; i < power; ++i) {
-    middles.push_back(readResidue());
+  for (uint32_t i = 1; i <= power; ++i) {
+    middles.push_back(toWords(residue(i)));
   }
+  ProofMarin proof(E, toWords(residue(0)), std::move(middles), knownFactors);
+  proof.hashChain_ = hashChain();
+  return proof;
+}
 
-  return ProofMarin(exponent, std::move(B), std::move(middles), std::move(factors));
+ProofMarin ProofMarin::load(const std::filesystem::path& filePath) {
+  return Mapped(filePath).toProof();
 }
 
 // Hash functions for ProofMarin generation
@@ -228,4 +244,73 @@ uint64_t ProofMarin::res64(const std::vector<uint32_t>& words) {
   return result;
 }
 
-} // namespace core
\ No newline at end of file
+bool ProofMarin::verify(engine* eng) const {
+  const uint32_t npower = static_cast<uint32_t>(middles.size());
+  if (npower == 0) {
+    throw std::runtime_error("Invalid proof: no middle residues");
+  }
+  if (eng->get_checkpoint_size() < 3 * eng->get_size() * sizeof(uint64_t)) {
+    throw std::runtime_error("Proof verification needs an engine with 3 registers");
+  }
+
+  util::Timer timer;
+  const engine::Reg RA = 0, RB = 1, RD = 2;
+  mpz_t z; mpz_init(z);
+  auto setReg = [&](engine::Reg r, const std::vector<uint32_t>& w) {
+    mpz_set(z, util::convertToGMP(w).get_mpz_t());
+    eng->set_mpz(r, z);
+  };
+
+  std::cout << "Starting proof verification for M" << E;
+  for (const auto& factor : knownFactors) std::cout << "/" << factor;
+  std::cout << " with power " << npower << std::endl;
+
+  // A = 3, B = final residue
+  mpz_class A = 3;
+  mpz_class Bw = util::convertToGMP(B);
+
+  const bool haveChain = (hashChain_.size() == npower + 1);
+  auto hash = haveChain ? hashChain_[0] : hashWords(E, B);
+  uint32_t span = E;
+  for (uint32_t i = 0; i < npower; ++i, span = (span + 1) / 2) {
+    const auto& M = middles[i];
+    hash = haveChain ? hashChain_[i + 1] : hashWords(E, hash, M);
+    const uint64_t h = hash[0];
+
+    // B = M^h * (B^2 if span odd else B)
+    mpz_set(z, Bw.get_mpz_t());
+    eng->set_mpz(RB, z);
+    if (span % 2 != 0) eng->square_mul(RB);
+    eng->set_multiplicand(RB, RB);
+    setReg(RA, M);
+    eng->pow(RD, RA, h);
+    eng->mul(RD, RB);
+    eng->get_mpz(z, RD);
+    Bw = mpz_class(z);
+
+    // A = A^h * M
+    mpz_set(z, A.get_mpz_t());
+    eng->set_mpz(RA, z);
+    eng->pow(RD, RA, h);
+    setReg(RB, M);
+    eng->set_multiplicand(RB, RB);
+    eng->mul(RD, RB);
+    eng->get_mpz(z, RD);
+    A = mpz_class(z);
+  }
+
+  // Final step: A = A^(2^span)
+  mpz_set(z, A.get_mpz_t());
+  eng->set_mpz(RD, z);
+  for (uint32_t k = 0; k < span; ++k) eng->square_mul(RD);
+  eng->get_mpz(z, RD);
+  A = mpz_class(z);
+  mpz_clear(z);
+
+  const bool ok = (A == Bw);
+  std::cout << "Verification result: " << (ok ? "SUCCESS" : "FAIL") << std::endl;
+  std::cout << "Proof verified in " << std::fixed << std::setprecision(2) << timer.elapsed() << " seconds." << std::endl;
+  return ok;
+}
+
+} // namespace core
@@ -30,6 +30,14 @@
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 namespace core {
 
@@ -52,6 +60,181 @@ WordsMarin WordsMarin::fromUint64(const std::vector<uint64_t>& host, uint32_t ex
     return WordsMarin(host);
 }
 
+// Proof residue store: a 16-byte header (magic, version, E, power) followed by one
+// fixed slot per checkpoint point holding CRC32, the iteration and the (E + 31) / 32 words.
+// Writes are queued to a single background thread; at most kMaxPending residues wait in memory.
+namespace {
+constexpr uint32_t kStoreMagic = 0x504d5250; // "PRMP"
+constexpr uint32_t kStoreVersion = 1;
+constexpr uint64_t kStoreHeaderBytes = 4 * sizeof(uint32_t);
+constexpr size_t kMaxPending = 2;
+
+// Reads the leaves [first, first + count) of a proof level in order on one thread, at most
+// kMaxPending ahead of the fold. An error of the reader is thrown again by pop().
+class LeafPrefetch {
+public:
+  LeafPrefetch(std::function<mpz_class(uint32_t)> read, uint32_t first, uint32_t count)
+      : read_(std::move(read)) {
+    worker_ = std::thread([this, first, count] { run(first, count); });
+  }
+
+  ~LeafPrefetch() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+  }
+
+  LeafPrefetch(const LeafPrefetch&) = delete;
+  LeafPrefetch& operator=(const LeafPrefetch&) = delete;
+
+  mpz_class pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !queue_.empty() || error_; });
+    if (queue_.empty()) std::rethrow_exception(error_);
+    mpz_class v = std::move(queue_.front());
+    queue_.pop_front();
+    cv_.notify_all();
+    return v;
+  }
+
+private:
+  void run(uint32_t first, uint32_t count) {
+    for (uint32_t i = first; i < first + count; ++i) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return queue_.size() < kMaxPending || stop_; });
+        if (stop_) return;
+      }
+      try {
+        mpz_class v = read_(i);
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(v));
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = std::current_exception();
+        cv_.notify_all();
+        return;
+      }
+      cv_.notify_all();
+    }
+  }
+
+  std::function<mpz_class(uint32_t)> read_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<mpz_class> queue_;
+  std::exception_ptr error_;
+  bool stop_ = false;
+  std::thread worker_;
+};
+}
+
+class ProofSetMarin::Store {
+public:
+  Store(const std::filesystem::path& path, uint32_t E, uint32_t power, uint64_t totalBytes) {
+    const uint32_t header[4] = {kStoreMagic, kStoreVersion, E, power};
+    bool reuse = false;
+    if (std::filesystem::exists(path) && std::filesystem::file_size(path) == totalBytes) {
+      std::ifstream in(path, std::ios::binary);
+      uint32_t h[4] = {};
+      in.read(reinterpret_cast<char*>(h), sizeof(h));
+      reuse = in.good() && std::equal(std::begin(h), std::end(h), std::begin(header));
+    }
+    if (!reuse) {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(header), sizeof(header));
+      if (!out.good()) {
+        throw std::runtime_error("Cannot create proof residue store: " + path.string());
+      }
+      out.close();
+      std::filesystem::resize_file(path, totalBytes); // sparse on most filesystems
+    }
+    file_.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file_) {
+      throw std::runtime_error("Cannot open proof residue store: " + path.string());
+    }
+    path_ = path;
+    worker_ = std::thread([this] { run(); });
+  }
+
+  ~Store() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+  }
+
+  void push(uint64_t offset, std::vector<uint32_t> record) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return pending_.size() < kMaxPending; });
+    throwIfFailed();
+    pending_.push_back({offset, std::move(record)});
+    cv_.notify_all();
+  }
+
+  void flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return pending_.empty() && !writing_; });
+    throwIfFailed();
+  }
+
+private:
+  struct Job {
+    uint64_t offset;
+    std::vector<uint32_t> record;
+  };
+
+  void throwIfFailed() {
+    if (!error_.empty()) {
+      std::string e = std::move(error_);
+      error_.clear();
+      throw std::runtime_error(e);
+    }
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+      if (pending_.empty()) return;
+      Job job = std::move(pending_.front());
+      pending_.pop_front();
+      writing_ = true;
+      lock.unlock();
+
+      file_.seekp(static_cast<std::streamoff>(job.offset));
+      file_.write(reinterpret_cast<const char*>(job.record.data()),
+                  static_cast<std::streamsize>(job.record.size() * sizeof(uint32_t)));
+      file_.flush();
+      const bool ok = file_.good();
+      file_.clear();
+
+      lock.lock();
+      writing_ = false;
+      if (!ok) {
+        error_ = "Error writing proof checkpoint " + std::to_string(job.record[1]) + " to " + path_.string();
+        std::cerr << "Warning: " << error_ << std::endl;
+      }
+      cv_.notify_all();
+    }
+  }
+
+  std::filesystem::path path_;
+  std::fstream file_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Job> pending_;
+  bool writing_ = false;
+  bool stop_ = false;
+  std::string error_;
+  std::thread worker_;
+};
+
 // ProofSetMarin
 ProofSetMarin::ProofSetMarin(uint32_t exponent, uint32_t proofLevel, std::vector<std::string> factors)
   : E{exponent}, power{proofLevel}, knownFactors{std::move(factors)} {
@@ -92,33 +275,67 @@ ProofSetMarin::ProofSetMarin(uint32_t exponent, uint32_t proofLevel, std::vector
   }
 }
 
+void ProofSetMarin::importLegacyFiles() {
+  // A test started by an older version wrote a file per checkpoint: CRC32, then the words.
+  // They are copied into the store, and removed once it is written.
+  std::vector<std::filesystem::path> imported;
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(proofPath(E), ec)) {
+    const std::string name = entry.path().filename().string();
+    if (name.empty() || name.size() > 10 || !std::all_of(name.begin(), name.end(), [](char c) { return c >= '0' && c <= '9'; })) continue;
+    const uint64_t iter = std::stoull(name);
+    if (iter > E || !shouldCheckpoint(static_cast<uint32_t>(iter))) continue;
+
+    std::ifstream file(entry.path(), std::ios::binary);
+    uint32_t crc = 0;
+    std::vector<uint32_t> words((E + 31) / 32);
+    file.read(reinterpret_cast<char*>(&crc), sizeof(crc));
+    file.read(reinterpret_cast<char*>(words.data()), static_cast<std::streamsize>(words.size() * sizeof(uint32_t)));
+    if (!file.good() || crc != computeCRC32(words.data(), words.size() * sizeof(uint32_t))) {
+      std::cerr << "Warning: ignoring corrupted proof checkpoint file " << entry.path().string() << std::endl;
+      continue;
+    }
+    save(static_cast<uint32_t>(iter), words);
+    imported.push_back(entry.path());
+  }
+  if (imported.empty()) return;
+
+  flush();
+  for (const auto& path : imported) std::filesystem::remove(path, ec);
+  std::cout << "Imported " << imported.size() << " proof checkpoint files into " << storePath(E).string() << std::endl;
+}
+
 bool ProofSetMarin::shouldCheckpoint(uint32_t iter) const {
   return isInPoints(E, power, iter);
 }
 
+ProofSetMarin::~ProofSetMarin() = default;
+
+uint64_t ProofSetMarin::slotOffset(uint32_t iter) const {
+  const uint64_t slotBytes = (2 + uint64_t(E + 31) / 32) * sizeof(uint32_t);
+  const auto it = std::lower_bound(points.begin(), points.end(), iter);
+  return kStoreHeaderBytes + static_cast<uint64_t>(it - points.begin()) * slotBytes;
+}
+
 void ProofSetMarin::save(uint32_t iter, const std::vector<uint32_t>& words) {
   if (!shouldCheckpoint(iter)) {
     return;
   }
 
-  // Create the file path for this iteration
-  auto filePath = proofPath(E) / std::to_string(iter);
-  
-  // Write the words data to file
-  std::ofstream file(filePath, std::ios::binary);
-  if (!file) {
-    throw std::runtime_error("Cannot create proof checkpoint file: " + filePath.string());
-  }
-  
-  // Write CRC32 first, then the data
-  uint32_t crc = computeCRC32(words.data(), words.size() * sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(&crc), sizeof(crc));
-  file.write(reinterpret_cast<const char*>(words.data()),
-          static_cast<std::streamsize>(words.size() * sizeof(uint32_t)));
-  
-  if (!file.good()) {
-    throw std::runtime_error("Error writing proof checkpoint file: " + filePath.string());
+  if (!store_) {
+    store_ = std::make_unique<Store>(storePath(E), E, power, slotOffset(uint32_t(-1)));
   }
+
+  // The CRC is taken from the in-memory residue, so the write needs no read-back
+  std::vector<uint32_t> record(2 + (E + 31) / 32, 0);
+  std::copy_n(words.begin(), std::min(words.size(), record.size() - 2), record.begin() + 2);
+  record[0] = computeCRC32(record.data() + 2, (record.size() - 2) * sizeof(uint32_t));
+  record[1] = iter;
+  store_->push(slotOffset(iter), std::move(record));
+}
+
+void ProofSetMarin::flush() const {
+  if (store_) store_->flush();
 }
 
 WordsMarin ProofSetMarin::fromUint64(const std::vector<uint64_t>& host, uint32_t exponent) {
@@ -157,6 +374,10 @@ std::filesystem::path ProofSetMarin::proofPath(uint32_t E) {
   return std::filesystem::path(std::to_string(E)) / "proof";
 }
 
+std::filesystem::path ProofSetMarin::storePath(uint32_t E) {
+  return proofPath(E) / "residues.bin";
+}
+
 bool ProofSetMarin::isValidTo(uint32_t limitK) const {
   // Check if we have all required checkpoint files up to limitK
   for (uint32_t point : points) {
@@ -169,8 +390,14 @@ bool ProofSetMarin::isValidTo(uint32_t limitK) const {
 }
 
 bool ProofSetMarin::fileExists(uint32_t k) const {
-  auto filePath = proofPath(E) / std::to_string(k);
-  return std::filesystem::exists(filePath);
+  // A slot is in use once its iteration field has been written
+  flush();
+  std::ifstream file(storePath(E), std::ios::binary);
+  if (!file) return false;
+  uint32_t head[2] = {};
+  file.seekg(static_cast<std::streamoff>(slotOffset(k)));
+  file.read(reinterpret_cast<char*>(head), sizeof(head));
+  return file.good() && head[1] == k;
 }
 
 std::vector<uint32_t> ProofSetMarin::load(uint32_t iter) const {
@@ -178,42 +405,65 @@ std::vector<uint32_t> ProofSetMarin::load(uint32_t iter) const {
     throw std::runtime_error("Attempt to load non-checkpoint iteration: " + std::to_string(iter));
   }
 
-  auto filePath = proofPath(E) / std::to_string(iter);
+  flush();
+  auto filePath = storePath(E);
   std::ifstream file(filePath, std::ios::binary);
   if (!file) {
-    throw std::runtime_error("Cannot open proof checkpoint file: " + filePath.string());
+    throw std::runtime_error("Cannot open proof residue store: " + filePath.string());
   }
 
-  // Read CRC32 first
-  uint32_t crc;
-  file.read(reinterpret_cast<char*>(&crc), sizeof(crc));
+  // Read CRC32 and iteration, then the (E + 31) / 32 words of the slot
+  uint32_t head[2] = {};
+  std::vector<uint32_t> words((E + 31) / 32);
+  file.seekg(static_cast<std::streamoff>(slotOffset(iter)));
+  file.read(reinterpret_cast<char*>(head), sizeof(head));
+  file.read(reinterpret_cast<char*>(words.data()), static_cast<std::streamsize>(words.size() * sizeof(uint32_t)));
   if (!file.good()) {
-    throw std::runtime_error("Error reading CRC32 from proof checkpoint file: " + filePath.string());
+    throw std::runtime_error("Error reading proof checkpoint " + std::to_string(iter) + " from " + filePath.string());
   }
-
-  // Calculate expected file size in 32-bit words: (E + 31) / 32
-  uint32_t expectedWords = (E + 31) / 32;
-  
-  // Read the 32-bit words data
-  std::vector<uint32_t> words(expectedWords);
-  file.read(reinterpret_cast<char*>(words.data()), expectedWords * sizeof(uint32_t));
-  if (!file.good()) {
-    throw std::runtime_error("Error reading data from proof checkpoint file: " + filePath.string());
+  if (head[1] != iter) {
+    throw std::runtime_error("Missing proof checkpoint " + std::to_string(iter) + " in " + filePath.string());
   }
 
   // Verify CRC32
   uint32_t computedCrc = computeCRC32(words.data(), words.size() * sizeof(uint32_t));
-  if (crc != computedCrc) {
-    throw std::runtime_error("CRC32 mismatch in proof checkpoint file: " + filePath.string());
+  if (head[0] != computedCrc) {
+    throw std::runtime_error("CRC32 mismatch for proof checkpoint " + std::to_string(iter) + " in " + filePath.string());
   }
 
   return words;
 }
 
-ProofMarin ProofSetMarin::computeProof() const {
+std::vector<uint32_t> ProofSetMarin::pointsFor(uint32_t npower) const {
+  if (npower == power) return points;
+
+  // The points of a lower power are a subset of the saved ones
+  std::vector<uint32_t> newPoints;
+  newPoints.push_back(0);
+  for (uint32_t level = 0, span = (E + 1) / 2; level < npower; ++level, span = (span + 1) / 2) {
+    for (uint32_t i = 0, end = static_cast<uint32_t>(newPoints.size()); i < end; ++i) {
+      newPoints.push_back(newPoints[i] + span);
+    }
+  }
+  newPoints.front() = E;
+  std::sort(newPoints.begin(), newPoints.end());
+  newPoints.push_back(uint32_t(-1)); // guard element
+  return newPoints;
+}
+
+ProofMarin ProofSetMarin::computeProof(engine* eng) const {
+  return computeProof(power, eng);
+}
+
+ProofMarin ProofSetMarin::computeProof(uint32_t npower, engine* eng) const {
   // Start timing proof generation
   util::Timer timer;
 
+  if (npower > power) {
+    throw std::runtime_error("Proof power " + std::to_string(npower) + " exceeds the saved power " + std::to_string(power));
+  }
+  const std::vector<uint32_t> pts = pointsFor(npower);
+
   std::vector<std::vector<uint32_t>> middles;
   std::vector<uint64_t> hashes;
 
@@ -221,92 +471,141 @@ ProofMarin ProofSetMarin::computeProof() const {
   auto B = load(E);
   auto hash = ProofMarin::hashWords(E, B);
 
-  // Pre-allocate maximum needed buffer pool (power levels use 2^p buffers max)
-  uint32_t maxBuffers = (1u << power);
-  std::vector<mpz_class> bufferPool(maxBuffers);
+  // The engine needs three registers: A (turned into a multiplicand by pow), B and the product.
+  if (eng != nullptr && eng->get_checkpoint_size() < 3 * eng->get_size() * sizeof(uint64_t)) {
+    eng = nullptr;
+  }
+
+  unsigned nThreads = std::thread::hardware_concurrency();
+  if (nThreads == 0) nThreads = 4;
+
+  // Run f(j) for j in [0, count) on the host thread pool. The first exception of a worker
+  // stops the others from taking new indices and is thrown again after the join.
+  auto parallelFor = [nThreads](uint32_t count, const std::function<void(uint32_t)>& f) {
+    const unsigned th = std::min<unsigned>(nThreads, count);
+    if (th <= 1) {
+      for (uint32_t j = 0; j < count; ++j) f(j);
+      return;
+    }
+    std::atomic<uint32_t> next{0};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < th; ++t)
+      workers.emplace_back([&] {
+        try {
+          for (uint32_t j = next.fetch_add(1); j < count; j = next.fetch_add(1)) f(j);
+        } catch (...) {
+          next = count;
+          std::lock_guard<std::mutex> lock(errorMutex);
+          if (!error) error = std::current_exception();
+        }
+      });
+    for (auto& w : workers) w.join();
+    if (error) std::rethrow_exception(error);
+  };
+
+  // A^h * B mod 2^E - 1
+  auto expMulHost = [this](const mpz_class& A, uint64_t h, const mpz_class& Bv) {
+    mpz_class temp = util::mersennePowMod(A, h, E);
+    mpz_class result = temp * Bv;
+    return util::mersenneReduce(result, E);
+  };
+  auto expMulEngine = [eng](const mpz_class& A, uint64_t h, const mpz_class& Bv) {
+    const engine::Reg RA = 0, RB = 1, RD = 2;
+    mpz_t z; mpz_init_set(z, A.get_mpz_t());
+    eng->set_mpz(RA, z);
+    eng->pow(RD, RA, h);
+    mpz_set(z, Bv.get_mpz_t());
+    eng->set_mpz(RB, z);
+    eng->set_multiplicand(RB, RB);
+    eng->mul(RD, RB);
+    eng->get_mpz(z, RD);
+    mpz_class r(z);
+    mpz_clear(z);
+    return r;
+  };
 
   // Main computation loop
-  for (uint32_t p = 0; p < power; ++p) {
+  for (uint32_t p = 0; p < npower; ++p) {
     assert(p == hashes.size());
-    
-    uint32_t s = (1u << (power - p - 1)); // Step size for this level
-    uint32_t levelBuffers = (1u << p); // Number of buffers needed for this level
-    uint32_t bufIndex = 0;
-    
-    // Clear buffers that will be used for this level
-    for (uint32_t i = 0; i < levelBuffers; ++i) {
-      bufferPool[i] = 0;
-    }
-    
-    // Load residues and apply binary tree algorithm
+
+    uint32_t s = (1u << (npower - p - 1)); // Step size for this level
+    uint32_t levelBuffers = (1u << p); // Number of leaves for this level
+
+    // Leaves: PRPLL's formula, checkpoint at points[s * (i * 2 + 1) - 1]
     for (uint32_t i = 0; i < levelBuffers; ++i) {
-      // PRPLL's formula: load checkpoint at points[s * (i * 2 + 1) - 1]
       uint32_t checkpointIndex = s * (i * 2 + 1) - 1;
-      
-      if (checkpointIndex >= points.size()) {
-        continue;
-      }
-      
-      uint32_t iteration = points[checkpointIndex];
-      
-      if (iteration > E || !shouldCheckpoint(iteration)) {
-        continue;
+      if (checkpointIndex >= pts.size() || pts[checkpointIndex] > E || !shouldCheckpoint(pts[checkpointIndex])) {
+        throw std::runtime_error("Missing proof checkpoint at level " + std::to_string(p));
       }
-      
-      auto w = load(iteration);
-      bufferPool[bufIndex] = util::convertToGMP(w);
-      bufIndex++;
-      
-      // Apply hashes from previous levels
-      for (uint32_t k = 0; i & (1u << k); ++k) {
-        assert(k <= p - 1);
-        if (bufIndex < 2) {
-          std::cerr << "Error: need at least 2 buffers for expMul, have " << bufIndex << std::endl;
-          continue;
+    }
+    // Streaming combine: leaves are read in tree order and folded on a stack of at most p + 1
+    // residues (PRPLL's expMul: after pushing leaf i, pop once per trailing 1-bit of i).
+    // The next checkpoints are read by a prefetch thread while the current multiplications run.
+    using ExpMul = std::function<mpz_class(const mpz_class&, uint64_t, const mpz_class&)>;
+    auto loadLeaf = [&](uint32_t i) { return util::convertToGMP(load(pts[s * (i * 2 + 1) - 1])); };
+    auto fold = [&](uint32_t first, uint32_t count, const ExpMul& expMul) {
+      std::vector<mpz_class> stack;
+      stack.reserve(p + 1);
+      LeafPrefetch leaves(loadLeaf, first, count);
+      for (uint32_t i = 0; i < count; ++i) {
+        stack.push_back(leaves.pop());
+        for (uint32_t k = 0; i & (1u << k); ++k) {
+          mpz_class right = std::move(stack.back());
+          stack.pop_back();
+          stack.back() = expMul(stack.back(), hashes[p - 1 - k], right);
         }
-        
-        bufIndex--;
-        uint64_t h = hashes[p - 1 - k]; // Hash from previous level
-        
-        // PRPLL's expMul: (bufIndex-1) := (bufIndex-1)^h * bufIndex
-        mpz_class temp = util::mersennePowMod(bufferPool[bufIndex - 1], h, E); // A^h mod (2^E - 1)
-        mpz_class result = temp * bufferPool[bufIndex]; // A^h * B
-        bufferPool[bufIndex - 1] = util::mersenneReduce(result, E); // Optimized Mersenne reduction
-        
-        // Clear the consumed buffer
-        bufferPool[bufIndex] = 0;
       }
+      return std::move(stack.back());
+    };
+
+    mpz_class levelValue;
+    if (eng != nullptr) {
+      levelValue = fold(0, levelBuffers, expMulEngine);
+    } else {
+      // Split the level into 2^t aligned subtrees folded on host threads (at most
+      // nThreads * (p + 1) residues resident), then combine their roots.
+      uint32_t t = 0;
+      while ((2u << t) <= std::min<uint32_t>(nThreads, levelBuffers)) ++t;
+      const uint32_t sub = levelBuffers >> t;
+      std::vector<mpz_class> roots(1u << t);
+      parallelFor(1u << t, [&](uint32_t j) { roots[j] = fold(j * sub, sub, expMulHost); });
+      for (uint32_t k = static_cast<uint32_t>(std::countr_zero(sub)); roots.size() > 1; ++k) {
+        std::vector<mpz_class> up(roots.size() / 2);
+        parallelFor(static_cast<uint32_t>(up.size()), [&](uint32_t j) { up[j] = expMulHost(roots[2 * j], hashes[p - 1 - k], roots[2 * j + 1]); });
+        roots.swap(up);
+      }
+      levelValue = std::move(roots[0]);
     }
-    
-    if (bufIndex != 1) {
-      std::cerr << "Warning: expected bufIndex=1, got " << bufIndex << std::endl;
-    }
-    
+
     // Convert the final result to words format
-    auto levelResult = util::convertFromGMP(bufferPool[0]);
-    
+    auto levelResult = util::convertFromGMP(levelValue);
+
     if (levelResult.empty()) {
       throw std::runtime_error("Read ZERO during proof generation at level " + std::to_string(p));
     }
-    
+    levelResult.resize((E + 31) / 32, 0); // hashWords reads the full residue
+
     // Store the result as middle for this level
     middles.push_back(levelResult);
-    
+
     // Update hash chain with this level's middle
     hash = ProofMarin::hashWords(E, hash, levelResult);
     uint64_t newHash = hash[0]; // The first 64 bits of the hash
     hashes.push_back(newHash);
-    
+
     // Show middle and hash for the current level
     uint64_t middleRes64 = ProofMarin::res64(levelResult);
-    std::cout << "proof [" << p << "] : M " << std::hex << std::setfill('0') << std::setw(16) << middleRes64 
+    std::cout << "proof [" << p << "] : M " << std::hex << std::setfill('0') << std::setw(16) << middleRes64
               << ", h " << std::setw(16) << newHash << std::dec << std::endl;
   }
-  
+
   // Display proof generation time
   double elapsed = timer.elapsed();
-  std::cout << "Proof generated in " << std::fixed << std::setprecision(2) << elapsed << " seconds." << std::endl;
-  
+  std::cout << "Proof generated in " << std::fixed << std::setprecision(2) << elapsed << " seconds"
+            << (eng != nullptr ? " (engine)." : ".") << std::endl;
+
   return ProofMarin{E, std::move(B), std::move(middles), knownFactors};
 }
 
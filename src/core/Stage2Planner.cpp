@@ -0,0 +1,88 @@
+#include "core/Stage2Planner.hpp"
+#include "core/PolyStage2.hpp"
+#include "math/Stage2Pairing.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+namespace core {
+
+Stage2Planner::Stage2Planner(uint64_t B1, uint64_t B2, size_t regBytes, size_t baseRegs)
+    : B1_(B1), B2_(B2), regBytes_(regBytes), baseRegs_(baseRegs) {}
+
+uint64_t Stage2Planner::deviceBudget(uint64_t globalMem, uint64_t maxAlloc) {
+    if (globalMem == 0) return uint64_t(2) << 30;
+    uint64_t budget = globalMem - globalMem / 8;
+    if (maxAlloc != 0) budget = std::min(budget, maxAlloc);
+    return budget;
+}
+
+Stage2Plan Stage2Planner::make(Stage2Plan::Algo algo, uint64_t D) const {
+    Stage2Plan p;
+    p.algo = algo;
+    p.D = D;
+    if (algo == Stage2Plan::Algo::BabyGiant) {
+        p.babySteps = math::Stage2Pairing::babySteps(D).size();
+        p.registers = baseRegs_ + p.babySteps;
+        p.transforms = math::Stage2Pairing::transforms(D, B1_, B2_);
+    } else {
+        p.babySteps = PolyStage2::degree(D);
+        p.registers = baseRegs_ + PolyStage2::registerCount(D);
+        const uint64_t kFirst = math::Stage2Pairing::giant(D, B1_ + 1), kLast = math::Stage2Pairing::giant(D, B2_);
+        const uint64_t block = p.babySteps + 1;
+        const uint64_t blocks = (kLast >= kFirst) ? (kLast - kFirst + block) / block : 0;
+        p.transforms = PolyStage2::initTransforms(D) + double(blocks) * PolyStage2::blockTransforms(D);
+    }
+    return p;
+}
+
+Stage2Plan Stage2Planner::plan(uint64_t budget, bool forcePoly) const {
+    Stage2Plan best;
+    bool found = false;
+    auto consider = [&](const Stage2Plan& p) {
+        if (uint64_t(p.registers) * regBytes_ > budget) return;
+        if (!found || p.transforms < best.transforms) { best = p; found = true; }
+    };
+
+    for (const uint64_t D : PolyStage2::candidates()) consider(make(Stage2Plan::Algo::Polynomial, D));
+    if (!forcePoly || !found)
+        for (const uint64_t D : math::Stage2Pairing::candidates()) consider(make(Stage2Plan::Algo::BabyGiant, D));
+    if (!found) best = make(Stage2Plan::Algo::BabyGiant, math::Stage2Pairing::candidates().front());
+    return best;
+}
+
+double Stage2Planner::secondsPerTransform(const engine& eng, engine::Reg r) {
+    using clock = std::chrono::steady_clock;
+    // The read of the register waits for the queue, its cost cancels in the difference.
+    mpz_t z; mpz_init(z);
+    auto run = [&](int squarings) {
+        const auto t0 = clock::now();
+        for (int i = 0; i < squarings; ++i) eng.square_mul(r);
+        eng.get_mpz(z, r);
+        return std::chrono::duration<double>(clock::now() - t0).count();
+    };
+    eng.set(r, 3u);
+    run(2);
+    const double shortRun = run(8), longRun = run(72);
+    mpz_clear(z);
+    return std::max(0.0, (longRun - shortRun) / (64 * 2));
+}
+
+std::string Stage2Planner::describe(const Stage2Plan& plan, uint64_t budget, double secondsPerTransform) const {
+    const double GiB = double(uint64_t(1) << 30);
+    std::ostringstream oss;
+    oss << "Stage 2 plan: ";
+    if (plan.algo == Stage2Plan::Algo::BabyGiant) oss << "baby-step giant-step, D = " << plan.D << ", " << plan.babySteps << " baby steps";
+    else oss << "polynomial evaluation, D = " << plan.D << ", degree " << plan.babySteps;
+    oss << ", " << plan.registers << " registers (" << std::fixed << std::setprecision(2)
+        << double(plan.registers) * double(regBytes_) / GiB << " GiB of " << double(budget) / GiB << " GiB), "
+        << std::scientific << std::setprecision(3) << plan.transforms << " transforms";
+    if (secondsPerTransform > 0) {
+        const uint64_t s = uint64_t(plan.transforms * secondsPerTransform);
+        oss << ", about " << s / 3600 << "h " << (s % 3600) / 60 << "m " << s % 60 << "s";
+    }
+    return oss.str();
+}
+
+} // namespace core
@@ -0,0 +1,77 @@
+/*
+ * Mersenne OpenCL Primality Test Host Code
+ *
+ * This code is inspired by:
+ *   - "mersenne.cpp" by Yves Gallot (Copyright 2020, Yves Gallot) based on
+ *     Nick Craig-Wood's IOCCC 2012 entry (https://github.com/ncw/ioccc2012).
+ *   - The Armprime project, explained at:
+ *         https://www.craig-wood.com/nick/armprime/
+ *     and available on GitHub at:
+ *         https://github.com/ncw/
+ *   - Yves Gallot (https://github.com/galloty), author of Genefer 
+ *     (https://github.com/galloty/genefer22), who helped clarify the NTT and IDBWT concepts.
+ *   - The GPUOwl project (https://github.com/preda/gpuowl), which performs Mersenne
+ *     searches using FFT and double-precision arithmetic.
+ * This code performs a Mersenne prime search using integer arithmetic and an IDBWT via an NTT,
+ * executed on the GPU through OpenCL.
+ *
+ * Author: Cherubrock
+ *
+ * This code is released as free software. 
+ */
+
+// src/io/Checkpoint.cpp
+#include "io/Checkpoint.hpp"
+#include "util/Crc32.hpp"
+
+namespace io {
+
+bool CheckpointReader::open(const std::string& file) {
+    sections_.clear();
+    if (!file_.open(file)) return false;
+    const char* p = reinterpret_cast<const char*>(file_.data());
+    const size_t size = file_.size();
+    if (size < ckpt::HeaderSize) return false;
+
+    uint32_t header[4];
+    std::memcpy(header, p, sizeof(header));
+    if (header[0] != ckpt::Magic || header[1] != ckpt::Version) return false;
+    if (computeCRC32(header, 3 * sizeof(uint32_t)) != header[3]) return false;
+
+    size_t pos = ckpt::HeaderSize;
+    for (uint32_t k = 0; k < header[2]; ++k) {
+        if (size - pos < ckpt::SectionHead) return false;
+        uint32_t tag = 0, crc = 0; uint64_t len = 0;
+        std::memcpy(&tag, p + pos, sizeof(tag));
+        std::memcpy(&crc, p + pos + 4, sizeof(crc));
+        std::memcpy(&len, p + pos + 8, sizeof(len));
+        pos += ckpt::SectionHead;
+        if (size - pos < len) return false;
+        if (computeCRC32(p + pos, len) != crc) return false;
+        sections_.emplace(tag, std::span<const char>(p + pos, len));
+        pos += len;
+    }
+    return true;
+}
+
+std::span<const char> CheckpointReader::section(uint32_t tag) const {
+    auto it = sections_.find(tag);
+    return (it == sections_.end()) ? std::span<const char>() : it->second;
+}
+
+bool CheckpointReader::getBytes(uint32_t tag, std::vector<char>& out) const {
+    auto it = sections_.find(tag);
+    if (it == sections_.end()) return false;
+    out.assign(it->second.begin(), it->second.end());
+    return true;
+}
+
+bool CheckpointReader::getMpz(uint32_t tag, mpz_class& z) const {
+    auto it = sections_.find(tag);
+    if (it == sections_.end()) return false;
+    // little-endian bytes, as written by CheckpointWriter::Snapshot::putMpz
+    mpz_import(z.get_mpz_t(), it->second.size(), -1, 1, 0, 0, it->second.data());
+    return true;
+}
+
+} // namespace io
@@ -0,0 +1,140 @@
+/*
+ * Mersenne OpenCL Primality Test Host Code
+ *
+ * This code is inspired by:
+ *   - "mersenne.cpp" by Yves Gallot (Copyright 2020, Yves Gallot) based on
+ *     Nick Craig-Wood's IOCCC 2012 entry (https://github.com/ncw/ioccc2012).
+ *   - The Armprime project, explained at:
+ *         https://www.craig-wood.com/nick/armprime/
+ *     and available on GitHub at:
+ *         https://github.com/ncw/
+ *   - Yves Gallot (https://github.com/galloty), author of Genefer 
+ *     (https://github.com/galloty/genefer22), who helped clarify the NTT and IDBWT concepts.
+ *   - The GPUOwl project (https://github.com/preda/gpuowl), which performs Mersenne
+ *     searches using FFT and double-precision arithmetic.
+ * This code performs a Mersenne prime search using integer arithmetic and an IDBWT via an NTT,
+ * executed on the GPU through OpenCL.
+ *
+ * Author: Cherubrock
+ *
+ * This code is released as free software. 
+ */
+// src/io/CheckpointWriter.cpp
+#include "io/CheckpointWriter.hpp"
+#include "marin/file.h"
+#include "util/Crc32.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace io {
+
+void CheckpointWriter::Snapshot::put(uint32_t tag, const void* p, size_t size) {
+    const size_t off = bytes_.size();
+    const uint32_t crc = 0;
+    const uint64_t len = size;
+    bytes_.resize(off + ckpt::SectionHead + size);
+    std::memcpy(bytes_.data() + off, &tag, sizeof(tag));
+    std::memcpy(bytes_.data() + off + 4, &crc, sizeof(crc));
+    std::memcpy(bytes_.data() + off + 8, &len, sizeof(len));
+    if (size != 0) std::memcpy(bytes_.data() + off + ckpt::SectionHead, p, size);
+    ++count_;
+}
+
+void CheckpointWriter::Snapshot::putMpz(uint32_t tag, const mpz_class& z) {
+    std::vector<char> bytes((mpz_sizeinbase(z.get_mpz_t(), 2) + 7) / 8);
+    size_t count = 0;
+    mpz_export(bytes.data(), &count, -1, 1, 0, 0, z.get_mpz_t());
+    put(tag, bytes.data(), count);
+}
+
+CheckpointWriter::CheckpointWriter()
+    : worker_([this] { run(); }) {}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+}
+
+CheckpointWriter::Snapshot& CheckpointWriter::next() {
+    Snapshot& s = buffers_[fill_];
+    s.bytes_.clear();
+    s.count_ = 0;
+    return s;
+}
+
+void CheckpointWriter::submit(const std::string& file, bool keepOld) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !queued_; });
+    file_ = file;
+    keepOld_ = keepOld;
+    queued_ = true;
+    fill_ ^= 1;   // the writer owns the submitted buffer, the loop gets the other one
+    cv_.notify_all();
+}
+
+bool CheckpointWriter::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !queued_; });
+    return ok_;
+}
+
+void CheckpointWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return stop_ || queued_; });
+        if (!queued_) return;
+        Snapshot& s = buffers_[fill_ ^ 1];
+        const std::string file = file_;
+        const bool keepOld = keepOld_;
+        lock.unlock();
+
+        const bool ok = write(s, file, keepOld);
+
+        lock.lock();
+        ok_ = ok;
+        queued_ = false;
+        cv_.notify_all();
+    }
+}
+
+bool CheckpointWriter::write(Snapshot& s, const std::string& file, bool keepOld) {
+    uint32_t header[4] = {ckpt::Magic, ckpt::Version, s.count_, 0};
+    header[3] = computeCRC32(header, 3 * sizeof(uint32_t));
+    for (size_t pos = 0; pos < s.bytes_.size(); ) {
+        uint64_t len = 0;
+        std::memcpy(&len, s.bytes_.data() + pos + 8, sizeof(len));
+        const uint32_t crc = computeCRC32(s.bytes_.data() + pos + ckpt::SectionHead, len);
+        std::memcpy(s.bytes_.data() + pos + 4, &crc, sizeof(crc));
+        pos += ckpt::SectionHead + len;
+    }
+
+    const std::string oldf = file + ".old", newf = file + ".new";
+    {
+        File f(newf, "wb");
+        if (!f.exists()) return false;
+        if (!f.write(reinterpret_cast<const char*>(header), sizeof(header))) return false;
+        if (!f.write(s.bytes_.data(), s.bytes_.size())) return false;
+        if (!f.sync()) {
+            std::cerr << "Cannot sync checkpoint file: " << newf << std::endl;
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::remove(oldf, ec);
+    if (std::filesystem::exists(file, ec)) {
+        std::filesystem::rename(file, oldf, ec);
+        if (ec) return false;
+    }
+    std::filesystem::rename(newf, file, ec);
+    if (ec) return false;
+    if (!keepOld) std::filesystem::remove(oldf, ec);
+    return true;
+}
+
+} // namespace io
@@ -58,6 +58,15 @@ void printUsage(const char* progName) {
     std::cout << "  -pm1                 : (Optional) Run factoring P-1" << std::endl;
     std::cout << "  -b1                  : (Optional) B1 for factoring P-1" << std::endl;
     std::cout << "  -b2                  : (Optional) B2 for factoring P-1" << std::endl;
+    std::cout << "  -s1keep              : (Optional) keep the completed P-1 stage 1, a later run with a larger -b1 extends it" << std::endl;
+    std::cout << "  -s1resume <file>     : (Optional) P-1 stage 2 from the stage 1 of a GMP-ECM resume file or a Prime95 save file" << std::endl;
+    std::cout << "  -s2poly              : (Optional) force the polynomial P-1 stage 2 (by default the cheaper of it and baby-step giant-step)" << std::endl;
+    std::cout << "  -s2mem <MiB>         : (Optional) GPU memory for the P-1 stage 2 tables (default: 7/8 of the device memory)" << std::endl;
+    std::cout << "  -s2range <lo> <hi>   : (Optional) P-1 stage 2 of the primes of [lo, hi) only, the accumulator is written to pm1_s2_m_<p>_<lo>_<hi>.part" << std::endl;
+    std::cout << "  -s2merge <f1,f2,...> : (Optional) multiply the partial P-1 stage 2 accumulators and run the final GCD" << std::endl;
+    std::cout << "  -pm1bounds           : (Optional) choose B1 and B2 of P-1 from the factor probability and the cost of each stage" << std::endl;
+    std::cout << "  -tf <bits>           : (Optional) trial-factoring depth for -pm1bounds (default: the usual depth of the exponent)" << std::endl;
+    std::cout << "  -saved <tests>       : (Optional) primality tests saved by a factor, for -pm1bounds (default: 1)" << std::endl;
     std::cout << "  -K <value>           : Exponent K for the n^K variant of P-1 stage 2" << std::endl;
     std::cout << "  -nmax <value>        : Maximum value of n for the n^K variant of P-1 stage 2" << std::endl;
     std::cout << "  -t <seconds>         : (Optional) Specify backup interval in seconds (default: 120)" << std::endl;
@@ -99,6 +108,8 @@ void printUsage(const char* progName) {
     
     std::cout << "  -maxe <value>         : (Optional) Max bits for each E chunk (in MiB). If set to 0, defaults to 10000 bits. Example: -maxe 64 → 64 MiB = 536870912 bits. By default if no -maxe you it is set to 32 Mib." << std::endl;
     std::cout << "  -memtest              : GPU Memory & Stability test (OpenCL)" << std::endl;
+    std::cout << "  -cert <squarings>     : Certify a PRP proof: square the starting residue <squarings> times and report its SHA3 hash" << std::endl;
+    std::cout << "  -certfile <path>      : (Optional) Starting residue for -cert, raw little-endian bytes (default: cert_<p>.bin)" << std::endl;
 
     //std::cout << "  -throttle_low        : (Optional) Enable CL_QUEUE_THROTTLE_LOW_KHR if OpenCL >= 2.2 (default: disabled)" << std::endl;
     //std::cout << "  -tune               : (Optional) Automatically determine the best pacing (iterForce) and how often to call clFinish() to synchronize kernels (default: disabled)" << std::endl;
@@ -172,6 +183,14 @@ CliOptions CliParser::parse(int argc, char** argv ) {
             //opts.marin = false;
             //opts.proof = false;
         }
+        else if (std::strcmp(argv[i], "-cert") == 0 && i + 1 < argc) {
+            opts.mode = "cert";
+            opts.certSquarings = std::strtoull(argv[++i], nullptr, 10);
+            opts.proof = false;
+        }
+        else if (std::strcmp(argv[i], "-certfile") == 0 && i + 1 < argc) {
+            opts.certFile = argv[++i];
+        }
         else if (std::strcmp(argv[i], "-bsgs") == 0) {
             opts.bsgs = true;
         }
@@ -268,6 +287,38 @@ CliOptions CliParser::parse(int argc, char** argv ) {
             opts.K = std::strtoull(argv[i + 1], nullptr, 10);  // base 10
             ++i;
         }
+        else if (std::strcmp(argv[i], "-s1keep") == 0) {
+            opts.s1keep = true;
+        }
+        else if (std::strcmp(argv[i], "-s1resume") == 0 && i + 1 < argc) {
+            opts.s1resume = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "-s2poly") == 0) {
+            opts.s2poly = true;
+        }
+        else if (std::strcmp(argv[i], "-s2mem") == 0 && i + 1 < argc) {
+            opts.s2mem = std::strtoull(argv[i + 1], nullptr, 10);  // base 10
+            ++i;
+        }
+        else if (std::strcmp(argv[i], "-s2range") == 0 && i + 2 < argc) {
+            opts.s2lo = std::strtoull(argv[i + 1], nullptr, 10);  // base 10
+            opts.s2hi = std::strtoull(argv[i + 2], nullptr, 10);
+            i += 2;
+        }
+        else if (std::strcmp(argv[i], "-s2merge") == 0 && i + 1 < argc) {
+            opts.s2merge = util::split(argv[++i], ',');
+        }
+        else if (std::strcmp(argv[i], "-pm1bounds") == 0) {
+            opts.pm1bounds = true;
+        }
+        else if (std::strcmp(argv[i], "-tf") == 0 && i + 1 < argc) {
+            opts.tfBits = std::strtod(argv[i + 1], nullptr);
+            ++i;
+        }
+        else if (std::strcmp(argv[i], "-saved") == 0 && i + 1 < argc) {
+            opts.testsSaved = std::strtod(argv[i + 1], nullptr);
+            ++i;
+        }
         else if (std::strcmp(argv[i], "-nmax") == 0 && i + 1 < argc) {
             opts.nmax = std::strtoull(argv[i + 1], nullptr, 10);  // base 10
             ++i;
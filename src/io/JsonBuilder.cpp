@@ -23,6 +23,7 @@
 #include "io/CliParser.hpp"          // for CliOptions
 #include "math/Cofactor.hpp"
 #include "util/GmpUtils.hpp"
+#include "util/BitPack.hpp"
 #include "core/Version.hpp"
 #ifndef CL_TARGET_OPENCL_VERSION
 #define CL_TARGET_OPENCL_VERSION 300
@@ -176,39 +177,19 @@ std::vector<uint32_t> JsonBuilder::compactBits(
     const std::vector<int>&      digit_width,
     uint32_t                     E
 ) {
-    uint32_t digitCount = static_cast<uint32_t>(x.size());
-    uint32_t totalWords = (E - 1) / 32 + 1;
+    const size_t digitCount = x.size();
+    const size_t totalWords = (E - 1) / 32 + 1;
     std::vector<uint32_t> out(totalWords, 0u);
 
-    int      carry    = 0;
-    uint32_t outWord  = 0;
-    int      haveBits = 0;
-    uint32_t o        = 0;
-
-    for (uint32_t p = 0; p < digitCount; ++p) {
-        int      w   = digit_width[p];
-        uint64_t v64 = uint64_t(carry) + x[p];
-        carry        = int(v64 >> w);
-        uint32_t v   = uint32_t(v64 & ((1ULL << w) - 1));
-
-        int topBits = 32 - haveBits;
-        outWord |= v << haveBits;
-        if (w >= topBits) {
-            out[o++]   = outWord;
-            outWord    = (w > topBits) ? (v >> topBits) : 0;
-            haveBits   = w - topBits;
-        } else {
-            haveBits  += w;
-        }
-    }
+    // Carries first, so every digit fits its width, then a single bit-packing pass
+    std::vector<uint64_t> v(x);
+    uint64_t carry = util::normalizeCarries(v.data(), digit_width.data(), digitCount);
+    util::packBits(v.data(), digit_width.data(), digitCount, out.data(), totalWords);
 
-    if (haveBits > 0 || carry) {
-        out[o++] = outWord;
-        for (uint32_t i = 1; carry && i < o; ++i) {
-            uint64_t sum = static_cast<uint64_t>(out[i]) + static_cast<uint64_t>(carry);
-            out[i]       = uint32_t(sum & 0xFFFFFFFFu);
-            carry        = int(sum >> 32);
-        }
+    for (size_t i = 1; carry && i < totalWords; ++i) {
+        const uint64_t sum = static_cast<uint64_t>(out[i]) + carry;
+        out[i] = uint32_t(sum & 0xFFFFFFFFu);
+        carry  = sum >> 32;
     }
 
     return out;
@@ -219,33 +200,8 @@ std::vector<uint64_t> JsonBuilder::expandBits(
     const std::vector<int>&      digit_width/*,
     uint32_t [[maybe_unused]] E*/
 ) {
-    uint32_t digitCount = static_cast<uint32_t>(digit_width.size());
-    std::vector<uint64_t> out(digitCount, 0);
-    
-    // Bit buffer for extracting variable-width values
-    uint64_t bitBuffer = 0;
-    int      availableBits = 0;
-    uint32_t wordIndex = 0;
-    
-    for (uint32_t p = 0; p < digitCount; ++p) {
-        int w = digit_width[p];
-        
-        // Fill buffer if we don't have enough bits
-        while (availableBits < w && wordIndex < compactWords.size()) {
-            bitBuffer |= (uint64_t(compactWords[wordIndex]) << availableBits);
-            availableBits += 32;
-            wordIndex++;
-        }
-        
-        // Extract w bits as the value
-        uint64_t mask = (1ULL << w) - 1;
-        out[p] = bitBuffer & mask;
-        
-        // Remove extracted bits from buffer
-        bitBuffer >>= w;
-        availableBits -= w;
-    }
-    
+    std::vector<uint64_t> out(digit_width.size(), 0);
+    util::unpackBits(compactWords.data(), compactWords.size(), digit_width.data(), digit_width.size(), out.data());
     return out;
 }
 
@@ -476,6 +432,63 @@ std::string JsonBuilder::generate(const CliOptions& opts,
         return oss.str();
     }
 
+    if (opts.mode == "cert") {
+        std::ostringstream oss;
+        oss << "{"
+            << "\"status\":\"C\","
+            << "\"exponent\":" << opts.exponent << ","
+            << "\"worktype\":\"Cert\","
+            << "\"sha3-hash\":" << jsonEscape(opts.certHash) << ","
+            << "\"squarings\":" << opts.certSquarings << ","
+            << "\"res64\":" << jsonEscape(res64) << ","
+            << "\"shift-count\":0,"
+            << "\"fft-length\":" << transform_size << ","
+            << "\"program\":{"
+                << "\"name\":\"prmers\","
+                << "\"version\":" << jsonEscape(core::PRMERS_VERSION) << ","
+                << "\"port\":" << opts.portCode
+            << "},"
+            << "\"os\":{"
+                << "\"os\":" << jsonEscape(opts.osName) << ","
+                << "\"architecture\":" << jsonEscape(opts.osArch)
+            << "},"
+            << "\"timestamp\":" << jsonEscape(timestampBuf) << ","
+            << "\"user\":" << jsonEscape(opts.user.empty() ? "prmers" : opts.user);
+        if (!opts.computer_name.empty())
+            oss << ",\"computer\":" << jsonEscape(opts.computer_name);
+        if (!opts.aid.empty())
+            oss << ",\"aid\":" << jsonEscape(opts.aid);
+
+        std::string prefix = oss.str();
+
+        std::ostringstream canon;
+        canon << opts.exponent << ";CERT;";
+        canon << "" << ";";
+        canon << "" << ";";
+        canon << toLower(opts.certHash) << ";";
+        canon << opts.certSquarings << ";";
+        canon << "" << ";";
+        canon << transform_size << ";";
+        canon << "" << ";";
+        canon << "prmers" << ";";
+        canon << core::PRMERS_VERSION << ";";
+        canon << "" << ";";
+        canon << "" << ";";
+        canon << opts.osName << ";";
+        canon << opts.osArch << ";";
+        canon << timestampBuf;
+
+        unsigned int crc = computeCRC32(canon.str());
+        std::ostringstream hex;
+        hex << std::uppercase << std::hex << std::setw(8) << std::setfill('0') << crc;
+
+        oss.str(""); oss.clear();
+        oss << prefix
+            << ",\"checksum\":{\"version\":1,\"checksum\":\"" << hex.str() << "\"}"
+            << "}";
+        return oss.str();
+    }
+
     std::string status = isPrime ? "P" : "C";
     int residueType = opts.knownFactors.empty() ? 1 : 5;
 
@@ -118,7 +118,8 @@ std::optional<WorktodoEntry> WorktodoParser::parse() {
         bool isLL   = (top[0] == "Test" || top[0] == "DoubleCheck");
         bool isPF   = (top[0] == "PFactor");
         bool isPM1  = (top[0] == "Pminus1");
-        if (!(isPRP || isLL || isPF || isPM1)) continue;
+        bool isCert = (top[0] == "Cert");
+        if (!(isPRP || isLL || isPF || isPM1 || isCert)) continue;
 
         auto parts = splitRespectingQuotes(top[1], ',');
         if (!parts.empty() && (parts[0].empty() || parts[0] == "N/A"))
@@ -135,6 +136,28 @@ std::optional<WorktodoEntry> WorktodoParser::parse() {
 
         try {
 
+            // Cert=AID,1,2,n,-1,squarings
+            if (isCert) {
+                if (parts.size() < 5) continue;
+                if (parts[0] != "1" || parts[1] != "2" || parts[3] != "-1") continue;
+
+                uint32_t exp = static_cast<uint32_t>(std::stoul(parts[2]));
+                if (exp == 0) continue;
+
+                WorktodoEntry entry;
+                entry.certTest      = true;
+                entry.exponent      = exp;
+                entry.rawLine       = line;
+                entry.aid           = aid;
+                entry.certSquarings = static_cast<uint64_t>(std::stoull(parts[4]));
+                if (entry.certSquarings == 0) continue;
+
+                std::cout << "Loaded entry: Cert exponent=" << entry.exponent
+                          << " squarings=" << entry.certSquarings
+                          << (aid.empty() ? "" : " (AID=" + aid + ")") << "\n";
+                return entry;
+            }
+
             if (isPF) {
                 if (parts.size() < 6) continue;
                 if (parts[0] != "1" || parts[1] != "2" || parts[3] != "-1") continue;
@@ -148,8 +171,9 @@ std::optional<WorktodoEntry> WorktodoParser::parse() {
                 entry.rawLine   = line;
                 entry.aid       = aid;
 
-                entry.B1 = static_cast<uint64_t>(std::stoull(parts[4]));
-                entry.B2 = static_cast<uint64_t>(std::stod(parts[5])); // "1.3" accepté
+                // how_far_factored, tests_saved ("1.3" accepté): the bounds are chosen from them
+                entry.tfBits     = std::stod(parts[4]);
+                entry.testsSaved = std::stod(parts[5]);
 
                 if (parts.size() >= 7) {
                     std::vector<std::string> kf;
@@ -169,7 +193,7 @@ std::optional<WorktodoEntry> WorktodoParser::parse() {
                 }
 
                 std::cout << "Loaded entry: PFactor exponent=" << entry.exponent
-                          << " B1=" << entry.B1 << " B2=" << entry.B2
+                          << " TF=" << entry.tfBits << " tests saved=" << entry.testsSaved
                           << (aid.empty() ? "" : " (AID=" + aid + ")") << "\n";
                 if (!entry.knownFactors.empty()) {
                     std::cout << "Known factors: ";
@@ -27,6 +27,7 @@
  // GpuOwl Mersenne primality tester; Copyright (C) 2017-2018 Mihai Preda.
 
 #include "io/common.h"
+#include "util/Crc32.hpp"
 #include <sstream>
 #include <iomanip>
 #include <cassert>
@@ -46,27 +47,7 @@ std::string rstripNewline(std::string s) {
     return s;
 }
 
-/*
- * A nibble-based CRC32 approach
- * We process each byte in two 4-bit steps.
- */
 u32 crc32(const void *data, size_t size) {
-    static const u32 table[16] = {
-        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
-        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
-        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
-        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
-    };
-
-    const unsigned char *p = static_cast<const unsigned char*>(data);
-    u32 crc = ~0U;
-
-    for (size_t i = 0; i < size; i++) {
-        // Process low nibble
-        crc = table[(crc ^  p[i]) & 0x0F] ^ (crc >> 4);
-        // Process high nibble
-        crc = table[(crc ^ (p[i] >> 4)) & 0x0F] ^ (crc >> 4);
-    }
-    return ~crc;
+    return updateCRC32(0, data, size);
 }
 } // namespace io
\ No newline at end of file
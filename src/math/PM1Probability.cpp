@@ -0,0 +1,74 @@
+#include "math/PM1Probability.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace math {
+
+namespace {
+
+constexpr size_t kSteps = 256;      // table steps for a unit of u
+constexpr size_t kMaxU = 40;        // rho(40) < 1e-60, taken as 0 beyond
+
+// u rho(u) = integral of rho over [u - 1, u], by the trapezoidal rule: all the terms are
+// positive, the tail keeps its relative precision where integrating rho' would cancel.
+const std::vector<double>& rhoTable() {
+    static const std::vector<double> table = [] {
+        std::vector<double> t(kMaxU * kSteps + 1, 1.0);
+        const double h = 1.0 / double(kSteps);
+        double inner = double(kSteps - 1);      // t[i - kSteps + 1] + ... + t[i - 1]
+        for (size_t i = kSteps + 1; i < t.size(); ++i) {
+            inner += t[i - 1] - t[i - kSteps];
+            t[i] = h * (0.5 * t[i - kSteps] + inner) / (double(i) * h - 0.5 * h);
+        }
+        return t;
+    }();
+    return table;
+}
+
+} // namespace
+
+double PM1Probability::rho(double u) {
+    if (u <= 1) return 1.0;
+    if (u >= double(kMaxU)) return 0.0;
+    const std::vector<double>& t = rhoTable();
+    const double x = u * double(kSteps);
+    const size_t i = size_t(x);
+    const double f = x - double(i);
+    return t[i] + f * (t[i + 1] - t[i]);
+}
+
+double PM1Probability::smooth(double bits, uint64_t B1, uint64_t B2) {
+    if (bits <= 0) return 1.0;
+    const double lnN = bits * std::log(2.0), lnB1 = std::log(double(B1));
+    double p = rho(lnN / lnB1);
+
+    // one prime t of (B1, B2], at most N: Simpson's rule on x = ln t
+    const double a = lnB1, b = std::min(std::log(double(B2)), lnN);
+    if (B2 > B1 && b > a) {
+        constexpr int n = 64;
+        const double h = (b - a) / n;
+        double s = 0;
+        for (int i = 0; i <= n; ++i) {
+            const double x = a + h * i;
+            const double w = (i == 0 || i == n) ? 1.0 : ((i % 2) ? 4.0 : 2.0);
+            s += w * rho((lnN - x) / lnB1) / x;
+        }
+        p += s * h / 3;
+    }
+    return std::min(p, 1.0);
+}
+
+double PM1Probability::factor(uint32_t p, double tfBits, uint64_t B1, uint64_t B2) {
+    // q = 2kp + 1 between 2^b and 2^(b+1): k has about b + 1/2 - log2(2p) bits
+    const double kShift = std::log2(2.0 * double(p));
+    double sum = 0;
+    for (double b = std::floor(tfBits); b < double(p) / 2; b += 1) {
+        const double term = smooth(b + 0.5 - kShift, B1, B2) / b;
+        sum += term;
+        if (term < 1e-12 * sum) break;
+    }
+    return sum;
+}
+
+} // namespace math
@@ -0,0 +1,154 @@
+#include "math/PrimeSieve.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <thread>
+
+namespace math {
+
+namespace {
+
+// Residues coprime to 30: bit j of a byte is the integer base + kWheel[j]
+constexpr uint8_t kWheel[8] = { 1, 7, 11, 13, 17, 19, 23, 29 };
+constexpr int8_t kBit[30] = { -1, 0, -1, -1, -1, -1, -1, 1, -1, -1, -1, 2, -1, 3, -1, -1,
+                              -1, 4, -1, 5, -1, -1, -1, 6, -1, -1, -1, -1, -1, 7 };
+
+// 256 KiB: about 7.9 million integers, the sieve array stays in L2
+constexpr size_t kSegmentBytes = size_t(1) << 18;
+
+uint64_t isqrt(uint64_t n) {
+    uint64_t r = uint64_t(std::sqrt(double(n)));
+    while (r * r > n) --r;
+    while ((r + 1) * (r + 1) <= n) ++r;
+    return r;
+}
+
+} // namespace
+
+PrimeSieve::PrimeSieve(uint64_t lo, uint64_t hi, unsigned threads)
+    : lo_(lo), hi_(hi), threads_(threads) {
+    if (threads_ == 0) threads_ = std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+    nextBase_ = lo_ - lo_ % 30;
+    if (hi_ < lo_) { small_ = 3; nextBase_ = hi_ + 1; return; }
+
+    // odd sieve of [3, sqrt(hi)], primes 2, 3 and 5 are the wheel
+    const uint64_t r = isqrt(hi_);
+    std::vector<uint8_t> odd(size_t(r / 2 + 1), 1);
+    for (uint64_t i = 3; i * i <= r; i += 2)
+        if (odd[size_t(i / 2)])
+            for (uint64_t j = i * i; j <= r; j += 2 * i) odd[size_t(j / 2)] = 0;
+    for (uint64_t i = 7; i <= r; i += 2)
+        if (odd[size_t(i / 2)]) sievingPrimes_.push_back(uint32_t(i));
+}
+
+PrimeSieve::~PrimeSieve() {
+    if (ahead_.valid()) ahead_.wait();
+}
+
+void PrimeSieve::sieveSegment(Segment& seg) const {
+    uint8_t* const bits = seg.bits.data();
+    const size_t bytes = seg.bits.size();
+    const uint64_t start = seg.base, end = seg.base + 30 * uint64_t(bytes);
+    std::fill(seg.bits.begin(), seg.bits.end(), uint8_t(0xff));
+    if (start == 0) bits[0] &= uint8_t(~1u);   // 1 is not prime
+
+    for (const uint32_t p32 : sievingPrimes_) {
+        const uint64_t p = p32;
+        if (p * p >= end) break;
+        // multiples p * k, k >= p coprime to 30: the 8 classes of k mod 30 are
+        // arithmetic progressions of step 30p, i.e. p bytes at a fixed bit
+        const uint64_t k0 = std::max(p, (std::max(start, p * p) + p - 1) / p);
+        for (uint64_t k = k0; k < k0 + 30; ++k) {
+            if (kBit[k % 30] < 0) continue;
+            const uint64_t m = p * k;
+            if (m >= end) continue;
+            const uint8_t mask = uint8_t(~(1u << kBit[m % 30]));
+            for (size_t i = size_t((m - start) / 30); i < bytes; i += size_t(p)) bits[i] &= mask;
+        }
+    }
+
+    // bounds of the interval inside the first and last bytes
+    for (size_t i = 0; i < bytes && start + 30 * i < lo_; ++i)
+        for (int j = 0; j < 8; ++j)
+            if (start + 30 * i + kWheel[j] < lo_) bits[i] &= uint8_t(~(1u << j));
+    for (size_t i = bytes; i-- > 0 && start + 30 * i + 29 > hi_; )
+        for (int j = 0; j < 8; ++j)
+            if (start + 30 * i + kWheel[j] > hi_) bits[i] &= uint8_t(~(1u << j));
+}
+
+PrimeSieve::Batch PrimeSieve::sieveBatch(uint64_t from) const {
+    Batch batch;
+    for (unsigned t = 0; t < threads_; ++t) {
+        const uint64_t base = from + uint64_t(t) * kSegmentBytes * 30;
+        if (base > hi_) break;
+        Segment seg;
+        seg.base = base;
+        seg.bits.resize(size_t(std::min<uint64_t>(kSegmentBytes, (hi_ - base) / 30 + 1)));
+        batch.push_back(std::move(seg));
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < batch.size(); ++i)
+        workers.emplace_back([this, &batch, i] { sieveSegment(batch[i]); });
+    if (!batch.empty()) sieveSegment(batch[0]);
+    for (auto& w : workers) w.join();
+    return batch;
+}
+
+// Make the next batch current and start sieving the one after it
+bool PrimeSieve::advance() {
+    const uint64_t span = uint64_t(threads_) * kSegmentBytes * 30;
+    Batch batch;
+    if (ahead_.valid()) batch = ahead_.get();
+    else if (nextBase_ <= hi_) { batch = sieveBatch(nextBase_); nextBase_ += span; }
+    if (batch.empty()) return false;
+
+    batch_ = std::move(batch);
+    segIndex_ = 0; byteIndex_ = 0;
+    if (nextBase_ <= hi_) {
+        const uint64_t from = nextBase_;
+        nextBase_ += span;
+        ahead_ = std::async(std::launch::async, [this, from] { return sieveBatch(from); });
+    }
+    return true;
+}
+
+uint64_t PrimeSieve::next() {
+    static constexpr uint64_t wheelPrimes[3] = { 2, 3, 5 };
+    while (small_ < 3) {
+        const uint64_t p = wheelPrimes[small_++];
+        if (p >= lo_ && p <= hi_) return p;
+    }
+
+    for (;;) {
+        if (pending_ != 0) {
+            const int j = std::countr_zero(pending_);
+            pending_ &= uint8_t(pending_ - 1);
+            return byteBase_ + kWheel[j];
+        }
+        if (segIndex_ == batch_.size()) {
+            if (!advance()) return 0;
+            continue;
+        }
+        const Segment& seg = batch_[segIndex_];
+        const size_t bytes = seg.bits.size();
+        while (byteIndex_ < bytes && seg.bits[byteIndex_] == 0) ++byteIndex_;
+        if (byteIndex_ == bytes) { ++segIndex_; byteIndex_ = 0; continue; }
+        pending_ = seg.bits[byteIndex_];
+        byteBase_ = seg.base + 30 * uint64_t(byteIndex_);
+        ++byteIndex_;
+    }
+}
+
+uint64_t PrimeSieve::count(uint64_t lo, uint64_t hi, unsigned threads) {
+    PrimeSieve sieve(lo, hi, threads);
+    uint64_t n = 0;
+    for (const uint64_t p : { 2u, 3u, 5u }) n += (p >= lo && p <= hi) ? 1 : 0;
+    sieve.small_ = 3;
+    while (sieve.advance())
+        for (const Segment& seg : sieve.batch_)
+            for (const uint8_t b : seg.bits) n += uint64_t(std::popcount(b));
+    return n;
+}
+
+} // namespace math
@@ -0,0 +1,60 @@
+#include "math/Stage2Pairing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace math {
+
+Stage2Pairing::Stage2Pairing(uint64_t D, uint64_t lo, uint64_t hi)
+    : D_(D), baby_(babySteps(D)), index_(size_t(D / 2), -1), used_(baby_.size(), 0), sieve_(lo, hi) {
+    for (size_t i = 0; i < baby_.size(); ++i) index_[baby_[i]] = int32_t(i);
+    pending_ = sieve_.next();
+}
+
+bool Stage2Pairing::next(uint64_t& k, std::vector<uint32_t>& pairs) {
+    pairs.clear();
+    while (pending_ != 0 && pairs.empty()) {
+        k = giant(D_, pending_);
+        const uint64_t kD = k * D_;
+        uint64_t q = pending_;
+        for (; q != 0 && giant(D_, q) == k; q = sieve_.next()) {
+            const uint64_t j = (q > kD) ? q - kD : kD - q;
+            if (j >= index_.size() || index_[j] < 0) continue;   // q divides D
+            ++primes_;
+            const uint32_t b = uint32_t(index_[j]);
+            if (!used_[b]) { used_[b] = 1; pairs.push_back(b); }
+        }
+        pending_ = q;
+    }
+    std::sort(pairs.begin(), pairs.end());
+    for (const uint32_t b : pairs) used_[b] = 0;
+    pairs_ += pairs.size();
+    return !pairs.empty();
+}
+
+std::vector<uint32_t> Stage2Pairing::babySteps(uint64_t D) {
+    std::vector<uint32_t> js;
+    for (uint64_t j = 1; j < D / 2; ++j)
+        if (std::gcd(j, D) == 1) js.push_back(uint32_t(j));
+    return js;
+}
+
+std::span<const uint64_t> Stage2Pairing::candidates() {
+    static constexpr uint64_t Ds[] = { 210, 2310, 30030 };
+    return Ds;
+}
+
+double Stage2Pairing::transforms(uint64_t D, uint64_t B1, uint64_t B2) {
+    if (B2 <= B1) return 0;
+    const double range = double(B2 - B1), lnB2 = std::log(double(B2));
+    const double primes = range / lnB2;
+
+    // Transforms: a multiplication by a multiplicand is 2, setting the multiplicand is 1.
+    // Baby steps cost 5 for each odd j < D/2, a giant step 5, a pair 3. The partner
+    // kD -/+ j of a prime is prime with probability about (D / phi(D)) / ln(q).
+    const size_t nb = babySteps(D).size();
+    const double paired = std::min(1.0, double(D) / double(2 * nb) / lnB2);
+    return 5.0 * double(D) / 4 + 5.0 * range / double(D) + 3.0 * primes * (1.0 - paired / 2);
+}
+
+} // namespace math
@@ -0,0 +1,265 @@
+/*
+ * Mersenne OpenCL Primality Test Host Code
+ *
+ * PRP-CERT: certification of a PRP proof uploaded by another user.
+ * The server hands out a starting residue A and a number of squarings k;
+ * we compute A^(2^k) mod Mp with the Marin engine and report the SHA3-256
+ * hash of the result.
+ *
+ * Author: Cherubrock
+ *
+ * This code is released as free software.
+ */
+#include "core/App.hpp"
+#include "core/AlgoUtils.hpp"
+#include "core/Printer.hpp"
+#include "io/WorktodoParser.hpp"
+#include "io/WorktodoManager.hpp"
+#include "io/JsonBuilder.hpp"
+#include "io/Sha3Hash.h"
+#include "io/CheckpointWriter.hpp"
+#include "marin/engine.h"
+#include "marin/file.h"
+#include "ui/WebGuiServer.hpp"
+#include <sys/stat.h>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <gmp.h>
+#include <gmpxx.h>
+
+using namespace core;
+using namespace std::chrono;
+using core::algo::interrupted;
+using core::algo::restart_self;
+
+namespace {
+
+// Starting residue: raw little-endian bytes, as served by PrimeNet for CERT work.
+bool read_cert_residue(const std::string& path, uint32_t p, mpz_t r)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const size_t nBytes = (size_t(p) + 7) / 8;
+    if (bytes.empty() || bytes.size() > nBytes) return false;
+    mpz_import(r, bytes.size(), -1, 1, 0, 0, bytes.data());
+    mpz_class Mp = (mpz_class(1) << p) - 1;
+    mpz_mod(r, r, Mp.get_mpz_t());
+    return mpz_sgn(r) != 0;
+}
+
+std::string cert_sha3_hex(uint32_t p, const mpz_t r)
+{
+    const size_t nBytes = (size_t(p) + 7) / 8;
+    std::vector<unsigned char> bytes(nBytes, 0);
+    size_t count = 0;
+    mpz_export(bytes.data(), &count, -1, 1, 0, 0, r);
+    io::SHA3 hasher;
+    hasher.update(bytes.data(), static_cast<uint32_t>(nBytes));
+    auto h = std::move(hasher).finish();
+    const unsigned char* hb = reinterpret_cast<const unsigned char*>(h.data());
+    std::ostringstream oss;
+    for (size_t i = 0; i < sizeof(h); ++i)
+        oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<unsigned>(hb[i]);
+    return oss.str();
+}
+
+} // namespace
+
+int App::runCertMarin()
+{
+    if (guiServer_) {
+        guiServer_->setProgress(0, 100, "Started");
+        guiServer_->setStatus("PRP-CERT");
+    }
+    const uint32_t p = static_cast<uint32_t>(options.exponent);
+    const uint64_t totalIters = options.certSquarings;
+    const bool verbose = true;//options.debug;
+    if (p == 0 || totalIters == 0) {
+        std::cerr << "CERT: exponent and number of squarings are required.\n";
+        if (guiServer_) { std::ostringstream oss; oss << "CERT: exponent and number of squarings are required."; guiServer_->appendLog(oss.str()); }
+        return -1;
+    }
+
+    engine* eng = engine::create_gpu(p, static_cast<size_t>(1), static_cast<size_t>(options.device_id), verbose);
+    const engine::Reg R0 = 0;
+
+    std::cout << "CERT 2^" << p << " - 1, " << totalIters << " squarings, " << eng->get_size() << " 64-bit words..." << std::endl;
+    if (guiServer_) {
+        std::ostringstream oss;
+        oss << "CERT 2^" << p << " - 1, " << totalIters << " squarings, " << eng->get_size() << " 64-bit words...";
+        guiServer_->setStatus(oss.str());
+        guiServer_->appendLog(oss.str());
+    }
+
+    std::ostringstream ck;
+    ck << "cert_m_" << p << ".ckpt";
+    const std::string ckpt_file = ck.str();
+
+    auto read_legacy_ckpt = [&](const std::string& file, uint64_t& ri, double& et)->int{
+        File f(file);
+        if (!f.exists()) return -1;
+        int version = 0; if (!f.read(reinterpret_cast<char*>(&version), sizeof(version))) return -2;
+        if (version != 1 && version != 2) return -2;
+        uint32_t rp = 0; if (!f.read(reinterpret_cast<char*>(&rp), sizeof(rp))) return -2;
+        if (rp != p) return -2;
+        uint64_t rk = 0; if (!f.read(reinterpret_cast<char*>(&rk), sizeof(rk))) return -2;
+        if (rk != totalIters) return -2;
+        if (!f.read(reinterpret_cast<char*>(&ri), sizeof(ri))) return -2;
+        if (!f.read(reinterpret_cast<char*>(&et), sizeof(et))) return -2;
+        if (version == 1) {
+            const size_t cksz = eng->get_checkpoint_size();
+            std::vector<char> data(cksz);
+            if (!f.read(data.data(), cksz)) return -2;
+            if (!eng->set_checkpoint(data)) return -2;
+        } else {
+            uint64_t cksz = 0; if (!f.read(reinterpret_cast<char*>(&cksz), sizeof(cksz))) return -2;
+            std::vector<char> data(cksz);
+            if (!f.read(data.data(), cksz)) return -2;
+            if (!eng->set_packed_checkpoint({R0}, data)) return -2;
+        }
+        if (!f.check_crc32()) return -2;
+        return 0;
+    };
+
+    const uint32_t TagSquarings = io::ckptTag("SQRS");
+    auto read_ckpt = [&](const std::string& file, uint64_t& ri, double& et)->int{
+        io::CheckpointReader f;
+        if (!f.open(file)) return read_legacy_ckpt(file, ri, et);
+        uint32_t rp = 0; uint64_t rk = 0; std::vector<char> regs;
+        if (!f.get(io::ckpt::Exponent, rp) || rp != p) return -2;
+        if (!f.get(TagSquarings, rk) || rk != totalIters) return -2;
+        if (!f.get(io::ckpt::Iteration, ri) || !f.get(io::ckpt::Elapsed, et)) return -2;
+        if (!f.getBytes(io::ckpt::Registers, regs) || !eng->set_packed_checkpoint({R0}, regs)) return -2;
+        return 0;
+    };
+
+    io::CheckpointWriter ckptWriter;
+    auto save_ckpt = [&](uint64_t i, double et){
+        auto& s = ckptWriter.next();
+        s.put(io::ckpt::Exponent, p); s.put(TagSquarings, totalIters);
+        s.put(io::ckpt::Iteration, i); s.put(io::ckpt::Elapsed, et);
+        auto& data = s.scratch();
+        eng->get_packed_checkpoint(data, {R0});
+        s.put(io::ckpt::Registers, data.data(), data.size());
+        ckptWriter.submit(ckpt_file);
+    };
+
+    uint64_t ri = 0; double restored_time = 0;
+    int r = read_ckpt(ckpt_file, ri, restored_time);
+    if (r < 0) r = read_ckpt(ckpt_file + ".old", ri, restored_time);
+    if (r == 0) {
+        std::cout << "Resuming CERT from a checkpoint at iteration " << ri << "." << std::endl;
+        if (guiServer_) { std::ostringstream oss; oss << "Resuming CERT from a checkpoint at iteration " << ri << "."; guiServer_->appendLog(oss.str()); }
+    } else {
+        ri = 0;
+        restored_time = 0;
+        const std::string startFile = options.certFile.empty() ? ("cert_" + std::to_string(p) + ".bin") : options.certFile;
+        mpz_t A; mpz_init(A);
+        if (!read_cert_residue(startFile, p, A)) {
+            mpz_clear(A);
+            delete eng;
+            std::cerr << "CERT: cannot read starting residue from " << startFile << "\n";
+            if (guiServer_) { std::ostringstream oss; oss << "CERT: cannot read starting residue from " << startFile; guiServer_->appendLog(oss.str()); }
+            return -2;
+        }
+        eng->set_mpz(R0, A);
+        mpz_clear(A);
+    }
+
+    const auto start_clock = high_resolution_clock::now();
+    auto lastBackup = start_clock;
+    auto lastDisplay = start_clock;
+    for (uint64_t iter = ri; iter < totalIters; ++iter) {
+        if (interrupted) {
+            const double elapsed_time = duration<double>(high_resolution_clock::now() - start_clock).count() + restored_time;
+            save_ckpt(iter, elapsed_time);
+            ckptWriter.wait();
+            delete eng;
+            std::cout << "\nInterrupted by user, CERT state saved at iteration " << iter << std::endl;
+            if (guiServer_) { std::ostringstream oss; oss << "\nInterrupted by user, CERT state saved at iteration " << iter; guiServer_->appendLog(oss.str()); }
+            return 0;
+        }
+        auto now0 = high_resolution_clock::now();
+        if (now0 - lastBackup >= seconds(options.backup_interval)) {
+            const double elapsed_time = duration<double>(now0 - start_clock).count() + restored_time;
+            save_ckpt(iter, elapsed_time);
+            lastBackup = now0;
+            std::cout << "\nBackup CERT at iteration " << iter << " done." << std::endl;
+            if (guiServer_) { std::ostringstream oss; oss << "Backup CERT at iteration " << iter << " done."; guiServer_->appendLog(oss.str()); }
+        }
+        eng->square_mul(R0);
+        auto now = high_resolution_clock::now();
+        if (duration_cast<seconds>(now - lastDisplay).count() >= 10) {
+            const double elapsed = duration<double>(now - start_clock).count();
+            const double done = static_cast<double>(iter + 1 - ri);
+            const double ips = elapsed > 0 ? done / elapsed : 0.0;
+            const double eta = ips > 0 ? static_cast<double>(totalIters - iter - 1) / ips : 0.0;
+            const double percent = 100.0 * static_cast<double>(iter + 1) / static_cast<double>(totalIters);
+            std::cout << "CERT progress: " << std::fixed << std::setprecision(2) << percent << "% | Iter: " << (iter + 1) << "/" << totalIters
+                      << " | IPS: " << std::setprecision(2) << ips << " | ETA: " << std::setprecision(0) << eta << "s" << std::endl;
+            if (guiServer_) {
+                std::ostringstream oss;
+                oss << "CERT progress: " << std::fixed << std::setprecision(2) << percent << "% | Iter: " << (iter + 1) << "/" << totalIters
+                    << " | IPS: " << std::setprecision(2) << ips << " | ETA: " << std::setprecision(0) << eta << "s";
+                guiServer_->appendLog(oss.str());
+                guiServer_->setProgress(iter + 1, totalIters, "");
+            }
+            lastDisplay = now;
+        }
+    }
+
+    mpz_t z; mpz_init(z);
+    eng->get_mpz(z, R0);
+    mpz_class Mp = (mpz_class(1) << p) - 1;
+    mpz_mod(z, z, Mp.get_mpz_t());
+    options.certHash = cert_sha3_hex(p, z);
+    mpz_class res64;
+    mpz_mod_2exp(res64.get_mpz_t(), z, 64);
+    mpz_clear(z);
+    delete eng;
+
+    const double elapsed_time = duration<double>(high_resolution_clock::now() - start_clock).count() + restored_time;
+    std::ostringstream res64hex;
+    res64hex << std::hex << std::setfill('0') << std::setw(16) << res64.get_ui();
+    std::cout << "CERT 2^" << p << " - 1 done, res64 = " << res64hex.str() << ", sha3 = " << options.certHash
+              << ", time = " << std::fixed << std::setprecision(2) << elapsed_time << " s." << std::endl;
+    if (guiServer_) {
+        std::ostringstream oss;
+        oss << "CERT 2^" << p << " - 1 done, res64 = " << res64hex.str() << ", sha3 = " << options.certHash
+            << ", time = " << std::fixed << std::setprecision(2) << elapsed_time << " s.";
+        guiServer_->appendLog(oss.str());
+    }
+
+    std::string json = io::JsonBuilder::generate(options, static_cast<int>(context.getTransformSize()), false, res64hex.str(), "");
+    std::cout << "Manual submission JSON:\n" << json << "\n";
+    io::WorktodoManager wm(options);
+    wm.saveIndividualJson(options.exponent, options.mode, json);
+    wm.appendToResultsTxt(json);
+
+    ckptWriter.wait();
+    std::remove(ckpt_file.c_str());
+    std::remove((ckpt_file + ".old").c_str());
+    std::remove((ckpt_file + ".new").c_str());
+
+    if (hasWorktodoEntry_) {
+        if (worktodoParser_->removeFirstProcessed()) {
+            std::cout << "Entry removed from " << options.worktodo_path << " and saved to worktodo_save.txt\n";
+            if (guiServer_) { std::ostringstream oss; oss << "Entry removed from " << options.worktodo_path << " and saved to worktodo_save.txt\n"; guiServer_->appendLog(oss.str()); }
+            std::ifstream f(options.worktodo_path);
+            std::string l; bool more = false; while (std::getline(f, l)) { if (!l.empty() && l[0] != '#') { more = true; break; } }
+            f.close();
+            if (more) { std::cout << "Restarting for next entry in worktodo.txt\n"; if (guiServer_) { std::ostringstream oss; oss << "Restarting for next entry in worktodo.txt\n"; guiServer_->appendLog(oss.str()); } restart_self(argc_, argv_); }
+            else { std::cout << "No more entries in worktodo.txt, exiting.\n"; if (guiServer_) { std::ostringstream oss; oss << "No more entries in worktodo.txt, exiting.\n"; guiServer_->appendLog(oss.str()); } if (!options.gui) {std::exit(0);} }
+        } else {
+            std::cerr << "Failed to update " << options.worktodo_path << "\n"; if (guiServer_) { std::ostringstream oss; oss << "Failed to update " << options.worktodo_path << "\n"; guiServer_->appendLog(oss.str()); } if (!options.gui) {std::exit(-1);}
+        }
+    }
+    return 0;
+}
@@ -7,10 +7,12 @@
 #include "core/ProofSet.hpp"
 #include "core/ProofSetMarin.hpp"
 #include "math/Carry.hpp"
+#include "math/PrimeSieve.hpp"
 #include "util/GmpUtils.hpp"
 #include "io/WorktodoParser.hpp"
 #include "io/WorktodoManager.hpp"
 #include "io/CurlClient.hpp"
+#include "io/CheckpointWriter.hpp"
 #include "marin/engine.h"
 #include "marin/file.h"
 #include "ui/WebGuiServer.hpp"
@@ -90,7 +92,7 @@ using core::algo::hex_to_le_bytes_pad4;
 using core::algo::buildE2;
 using core::algo::product_prefix_fit_u64;
 using core::algo::product_tree_range_u64;
-using core::algo::compute_X_with_dots;
+using core::algo::compute_X;
 using core::algo::gcd_with_dots;
 
 int App::runECMMarin()
@@ -187,17 +189,17 @@ int App::runECMMarin()
             std::cout<<" done\n";
         });
         uint64_t b = B1;
-        vector<uint8_t> sieve(b/2+1, 1);
-        for (uint64_t i=3;i*i<=b;i+=2) if (sieve[i>>1]) for (uint64_t j=i*i;j<=b;j+=i<<1) sieve[j>>1]=0;
         auto apply_prime = [&](uint64_t q){ uint64_t pw=q; while (pw <= b / q) pw *= q; mpz_class t; mpz_set_ui(t.get_mpz_t(), (unsigned long)pw); K *= t; ++primesB1; };
-        apply_prime(2);
-        for (uint64_t q=3;q<=b;q+=2) if (sieve[q>>1]) apply_prime(q);
+        math::PrimeSieve primes(2, b);
+        for (uint64_t q; (q = primes.next()) != 0; ) apply_prime(q);
         done.store(true, std::memory_order_relaxed);
         ticker.join();
     }
     size_t nb = mpz_sizeinbase(K.get_mpz_t(), 2);
 
-    std::vector<uint32_t> primesS2;
+    // Stage 2 primes are streamed by each curve, only their count and bounds are kept
+    uint32_t nPrimesS2 = 0;
+    uint64_t firstS2 = 0, lastS2 = 0;
     if (B2 > B1) {
         std::atomic<bool> done{false};
         std::thread ticker([&]{
@@ -211,11 +213,12 @@ int App::runECMMarin()
             }
             std::cout<<" done\n";
         });
-        uint64_t b = B2;
-        vector<uint8_t> sieve(b/2+1, 1);
-        for (uint64_t i=3;i*i<=b;i+=2) if (sieve[i>>1]) for (uint64_t j=i*i;j<=b;j+=i<<1) sieve[j>>1]=0;
-        if (B1 < 2 && 2 <= B2) primesS2.push_back(2);
-        for (uint64_t q=3;q<=B2;q+=2) if (sieve[q>>1] && q > B1) primesS2.push_back((uint32_t)q);
+        nPrimesS2 = (uint32_t)math::PrimeSieve::count(B1 + 1, B2);
+        firstS2 = math::PrimeSieve(B1 + 1, B2).next();
+        for (uint64_t w = 4096; lastS2 == 0 && firstS2 != 0; w *= 2) {
+            math::PrimeSieve tail(std::max(B1 + 1, B2 > w ? B2 - w : 0), B2);
+            for (uint64_t q; (q = tail.next()) != 0; ) lastS2 = q;
+        }
         done.store(true, std::memory_order_relaxed);
         ticker.join();
     }
@@ -224,9 +227,9 @@ int App::runECMMarin()
         std::ostringstream hdr;
         hdr<<"[ECM] N=M_"<<p<<"  B1="<<B1<<"  B2="<<B2<<"  curves="<<curves<<"\n";
         hdr<<"[ECM] Stage1: product of prime powers up to B1, primes used="<<primesB1<<", K_bits="<<nb<<"\n";
-        if (!primesS2.empty()) {
-            hdr<<"[ECM] Stage2: primes in ("<<B1<<","<<B2<<"], count="<<primesS2.size();
-            hdr<<", first="<<(primesS2.size()?primesS2.front():0)<<", last="<<(primesS2.size()?primesS2.back():0)<<"\n";
+        if (nPrimesS2 != 0) {
+            hdr<<"[ECM] Stage2: primes in ("<<B1<<","<<B2<<"], count="<<nPrimesS2;
+            hdr<<", first="<<firstS2<<", last="<<lastS2<<"\n";
         } else {
             hdr<<"[ECM] Stage2: disabled\n";
         }
@@ -240,6 +243,9 @@ int App::runECMMarin()
     size_t transform_size_once = 0;
     const int backup_period = options.backup_interval > 0 ? options.backup_interval : 10;
 
+    io::CheckpointWriter ckptWriter;
+    const uint32_t TagBits = io::ckptTag("NBIT"), TagPrimes = io::ckptTag("NPRM");
+    const uint32_t TagB1 = io::ckptTag("BND1"), TagB2 = io::ckptTag("BND2");
     for (uint64_t c = 0; c < curves; ++c)
     {
         engine* eng = engine::create_gpu(p, static_cast<size_t>(18), static_cast<size_t>(options.device_id), verbose);
@@ -255,11 +261,16 @@ int App::runECMMarin()
         const std::string ckpt2     = ck2.str();
 
         auto save_ckpt = [&](uint32_t i, double et){
-            const std::string oldf = ckpt_file + ".old", newf = ckpt_file + ".new";
-            { File f(newf, "wb"); int version = 1; if (!f.write(reinterpret_cast<const char*>(&version), sizeof(version))) return; if (!f.write(reinterpret_cast<const char*>(&p), sizeof(p))) return; if (!f.write(reinterpret_cast<const char*>(&i), sizeof(i))) return; uint32_t nbb = (uint32_t)nb; if (!f.write(reinterpret_cast<const char*>(&nbb), sizeof(nbb))) return; if (!f.write(reinterpret_cast<const char*>(&B1), sizeof(B1))) return; if (!f.write(reinterpret_cast<const char*>(&et), sizeof(et))) return; const size_t cksz = eng->get_checkpoint_size(); std::vector<char> data(cksz); if (!eng->get_checkpoint(data)) return; if (!f.write(data.data(), cksz)) return; f.write_crc32(); }
-            std::error_code ec; fs::remove(ckpt_file + ".old", ec); fs::rename(ckpt_file, ckpt_file + ".old", ec); fs::rename(ckpt_file + ".new", ckpt_file, ec); fs::remove(ckpt_file + ".old", ec);
+            auto& s = ckptWriter.next();
+            uint32_t nbb = (uint32_t)nb;
+            s.put(io::ckpt::Exponent, p); s.put(io::ckpt::Iteration, i); s.put(TagBits, nbb); s.put(TagB1, B1); s.put(io::ckpt::Elapsed, et);
+            auto& data = s.scratch();
+            data.resize(eng->get_checkpoint_size());
+            if (!eng->get_checkpoint(data)) return;
+            s.put(io::ckpt::EngineData, data.data(), data.size());
+            ckptWriter.submit(ckpt_file, false);
         };
-        auto read_ckpt = [&](const std::string& file, uint32_t& ri, uint32_t& rnb, double& et)->int{
+        auto read_legacy_ckpt = [&](const std::string& file, uint32_t& ri, uint32_t& rnb, double& et)->int{
             File f(file);
             if (!f.exists()) return -1;
             int version = 0; if (!f.read(reinterpret_cast<char*>(&version), sizeof(version))) return -2;
@@ -278,13 +289,29 @@ int App::runECMMarin()
             if (rnb != nb || rB1 != B1) return -2;
             return 0;
         };
+        auto read_ckpt = [&](const std::string& file, uint32_t& ri, uint32_t& rnb, double& et)->int{
+            io::CheckpointReader f;
+            if (!f.open(file)) return read_legacy_ckpt(file, ri, rnb, et);
+            uint32_t rp = 0; uint64_t rB1 = 0; std::vector<char> data;
+            if (!f.get(io::ckpt::Exponent, rp) || rp != p) return -2;
+            if (!f.get(io::ckpt::Iteration, ri) || !f.get(TagBits, rnb) || !f.get(TagB1, rB1) || !f.get(io::ckpt::Elapsed, et)) return -2;
+            if (rnb != nb || rB1 != B1) return -2;
+            if (!f.getBytes(io::ckpt::EngineData, data) || !eng->set_checkpoint(data)) return -2;
+            return 0;
+        };
 
         auto save_ckpt2 = [&](uint32_t idx, double et){
-            const std::string oldf = ckpt2 + ".old", newf = ckpt2 + ".new";
-            { File f(newf, "wb"); int version = 2; if (!f.write(reinterpret_cast<const char*>(&version), sizeof(version))) return; if (!f.write(reinterpret_cast<const char*>(&p), sizeof(p))) return; if (!f.write(reinterpret_cast<const char*>(&idx), sizeof(idx))) return; uint32_t cnt = (uint32_t)primesS2.size(); if (!f.write(reinterpret_cast<const char*>(&cnt), sizeof(cnt))) return; if (!f.write(reinterpret_cast<const char*>(&B1), sizeof(B1))) return; if (!f.write(reinterpret_cast<const char*>(&B2), sizeof(B2))) return; if (!f.write(reinterpret_cast<const char*>(&et), sizeof(et))) return; const size_t cksz = eng->get_checkpoint_size(); std::vector<char> data(cksz); if (!eng->get_checkpoint(data)) return; if (!f.write(data.data(), cksz)) return; f.write_crc32(); }
-            std::error_code ec; fs::remove(ckpt2 + ".old", ec); fs::rename(ckpt2, ckpt2 + ".old", ec); fs::rename(ckpt2 + ".new", ckpt2, ec); fs::remove(ckpt2 + ".old", ec);
+            auto& s = ckptWriter.next();
+            uint32_t cnt = nPrimesS2;
+            s.put(io::ckpt::Exponent, p); s.put(io::ckpt::Iteration, idx); s.put(TagPrimes, cnt);
+            s.put(TagB1, B1); s.put(TagB2, B2); s.put(io::ckpt::Elapsed, et);
+            auto& data = s.scratch();
+            data.resize(eng->get_checkpoint_size());
+            if (!eng->get_checkpoint(data)) return;
+            s.put(io::ckpt::EngineData, data.data(), data.size());
+            ckptWriter.submit(ckpt2, false);
         };
-        auto read_ckpt2 = [&](const std::string& file, uint32_t& idx, uint32_t& cnt, double& et)->int{
+        auto read_legacy_ckpt2 = [&](const std::string& file, uint32_t& idx, uint32_t& cnt, double& et)->int{
             File f(file);
             if (!f.exists()) return -1;
             int version = 0; if (!f.read(reinterpret_cast<char*>(&version), sizeof(version))) return -2;
@@ -300,7 +327,18 @@ int App::runECMMarin()
             if (!f.read(data.data(), cksz)) return -2;
             if (!eng->set_checkpoint(data)) return -2;
             if (!f.check_crc32()) return -2;
-            if (cnt != primesS2.size() || b1s != B1 || b2s != B2) return -2;
+            if (cnt != nPrimesS2 || b1s != B1 || b2s != B2) return -2;
+            return 0;
+        };
+        auto read_ckpt2 = [&](const std::string& file, uint32_t& idx, uint32_t& cnt, double& et)->int{
+            io::CheckpointReader f;
+            if (!f.open(file)) return read_legacy_ckpt2(file, idx, cnt, et);
+            uint32_t rp = 0; uint64_t b1s = 0, b2s = 0; std::vector<char> data;
+            if (!f.get(io::ckpt::Exponent, rp) || rp != p) return -2;
+            if (!f.get(io::ckpt::Iteration, idx) || !f.get(TagPrimes, cnt) || !f.get(io::ckpt::Elapsed, et)) return -2;
+            if (!f.get(TagB1, b1s) || !f.get(TagB2, b2s)) return -2;
+            if (cnt != nPrimesS2 || b1s != B1 || b2s != B2) return -2;
+            if (!f.getBytes(io::ckpt::EngineData, data) || !eng->set_checkpoint(data)) return -2;
             return 0;
         };
 
@@ -454,6 +492,7 @@ int App::runECMMarin()
                 if (interrupted) {
                     double elapsed = duration<double>(now - t0).count() + saved_et;
                     save_ckpt((uint32_t)(i + 1), elapsed);
+                    ckptWriter.wait();
                     std::cout<<"\n[ECM] Interrupted at curve "<<(c+1)<<", bit "<<(i+1)<<"/"<<nb<<"\n";
                     if (guiServer_) { std::ostringstream oss; oss<<"[ECM] Interrupted at curve "<<(c+1)<<", bit "<<(i+1)<<"/"<<nb; guiServer_->appendLog(oss.str()); }
                     delete eng;
@@ -461,9 +500,10 @@ int App::runECMMarin()
                 }
             }
             std::cout<<std::endl;
+            ckptWriter.wait();
 
             std::cout<<"[ECM] Curve "<<(c+1)<<"/"<<curves<<" | GCD after Stage1..."<<std::endl;
-            mpz_class Zfin = compute_X_with_dots(eng, (engine::Reg)1, N);
+            mpz_class Zfin = compute_X(eng, (engine::Reg)1, N);
             mpz_class gg = gcd_with_dots(Zfin, N);
             bool found = (gg > 1 && gg < N);
 
@@ -484,14 +524,14 @@ int App::runECMMarin()
         }
         else
         {
-            std::ostringstream s2r; s2r<<"[ECM] Curve "<<(c+1)<<"/"<<curves<<" | Resuming Stage2 at index "<<s2_idx<<"/"<<primesS2.size()<<" ("<<fixed<<setprecision(2)<<(primesS2.empty()?0.0: (100.0*double(s2_idx)/double(primesS2.size())))<<"%)";
+            std::ostringstream s2r; s2r<<"[ECM] Curve "<<(c+1)<<"/"<<curves<<" | Resuming Stage2 at index "<<s2_idx<<"/"<<nPrimesS2<<" ("<<fixed<<setprecision(2)<<(nPrimesS2 == 0?0.0: (100.0*double(s2_idx)/double(nPrimesS2)))<<"%)";
             std::cout<<s2r.str()<<std::endl; if (guiServer_) guiServer_->appendLog(s2r.str());
         }
 
         if (B2 > B1) {
             bool use_bsgs = options.bsgs ? true : false;
             uint32_t brent_deg = 1; if (options.brent > 1) brent_deg = (uint32_t)options.brent; else if (options.brent) brent_deg = 2;
-            if (!resume_stage2) { std::ostringstream s2h; s2h<<"[ECM] Curve "<<(c+1)<<"/"<<curves<<" | Stage2 start, primes="<<primesS2.size(); if (use_bsgs) s2h<<" | bsgs"; if (brent_deg>1) s2h<<" | brent_deg="<<brent_deg; std::cout<<s2h.str()<<std::endl; if (guiServer_) guiServer_->appendLog(s2h.str()); }
+            if (!resume_stage2) { std::ostringstream s2h; s2h<<"[ECM] Curve "<<(c+1)<<"/"<<curves<<" | Stage2 start, primes="<<nPrimesS2; if (use_bsgs) s2h<<" | bsgs"; if (brent_deg>1) s2h<<" | brent_deg="<<brent_deg; std::cout<<s2h.str()<<std::endl; if (guiServer_) guiServer_->appendLog(s2h.str()); }
 
             auto ladder_mul_small = [&](size_t Xin,size_t Zin, uint64_t m, size_t Xout,size_t Zout){
                 eng->set((engine::Reg)0, 1u);
@@ -583,8 +623,10 @@ int App::runECMMarin()
             uint64_t Macc = 1;
             uint32_t in_block = 0;
 
-            for (uint32_t i = start_idx; i < (uint32_t)primesS2.size(); ++i) {
-                uint64_t q = primesS2[i];
+            math::PrimeSieve primes(B1 + 1, B2);
+            for (uint32_t i = 0; i < start_idx; ++i) primes.next();
+            for (uint32_t i = start_idx; i < nPrimesS2; ++i) {
+                uint64_t q = primes.next();
                 uint64_t mexp = q;
                 bool big = false;
                 if (brent_deg > 1) {
@@ -630,13 +672,13 @@ int App::runECMMarin()
                 }
 
                 auto now2 = high_resolution_clock::now();
-                if (duration_cast<milliseconds>(now2 - last2_ui).count() >= 400 || i+1 == primesS2.size()) {
-                    double done = double(i + 1), total = double(primesS2.size());
+                if (duration_cast<milliseconds>(now2 - last2_ui).count() >= 400 || i+1 == nPrimesS2) {
+                    double done = double(i + 1), total = double(nPrimesS2);
                     double elapsed = duration<double>(now2 - t2_0).count() + saved_et2;
                     double ips = done / std::max(1e-9, elapsed);
                     double eta = (total > done && ips > 0.0) ? (total - done) / ips : 0.0;
                     std::ostringstream line;
-                    line<<"\r[ECM] Curve "<<(c+1)<<"/"<<curves<<" | Stage2 "<<(i+1)<<"/"<<primesS2.size()<<" ("<<fixed<<setprecision(2)<<(total? (done*100.0/total):100.0)<<"%)"
+                    line<<"\r[ECM] Curve "<<(c+1)<<"/"<<curves<<" | Stage2 "<<(i+1)<<"/"<<nPrimesS2<<" ("<<fixed<<setprecision(2)<<(total? (done*100.0/total):100.0)<<"%)"
                         <<" | ETA "<<fmt_hms(eta);
                     std::cout<<line.str()<<std::flush;
                     last2_ui = now2;
@@ -664,8 +706,9 @@ int App::runECMMarin()
                     }
                     double elapsed = duration<double>(high_resolution_clock::now() - t2_0).count() + saved_et2;
                     save_ckpt2((uint32_t)(i + 1), elapsed);
-                    std::cout<<"\n[ECM] Interrupted at Stage2 curve "<<(c+1)<<" index "<<(i+1)<<"/"<<primesS2.size()<<"\n";
-                    if (guiServer_) { std::ostringstream oss; oss<<"[ECM] Interrupted at Stage2 curve "<<(c+1)<<" index "<<(i+1)<<"/"<<primesS2.size(); guiServer_->appendLog(oss.str()); }
+                    ckptWriter.wait();
+                    std::cout<<"\n[ECM] Interrupted at Stage2 curve "<<(c+1)<<" index "<<(i+1)<<"/"<<nPrimesS2<<"\n";
+                    if (guiServer_) { std::ostringstream oss; oss<<"[ECM] Interrupted at Stage2 curve "<<(c+1)<<" index "<<(i+1)<<"/"<<nPrimesS2; guiServer_->appendLog(oss.str()); }
                     delete eng;
                     return 0;
                 }
@@ -676,9 +719,10 @@ int App::runECMMarin()
                 eng->copy((engine::Reg)Zcur, (engine::Reg)8);
             }
             std::cout<<std::endl;
+            ckptWriter.wait();
 
             std::cout<<"[ECM] Curve "<<(c+1)<<"/"<<curves<<" | GCD after Stage2..."<<std::endl;
-            mpz_class Zfin2 = compute_X_with_dots(eng, (engine::Reg)Zcur, N);
+            mpz_class Zfin2 = compute_X(eng, (engine::Reg)Zcur, N);
             mpz_class gg2 = gcd_with_dots(Zfin2, N);
             bool found2 = (gg2 > 1 && gg2 < N);
 
@@ -11,6 +11,7 @@
 #include "io/WorktodoParser.hpp"
 #include "io/WorktodoManager.hpp"
 #include "io/CurlClient.hpp"
+#include "io/CheckpointWriter.hpp"
 #include "marin/engine.h"
 #include "marin/file.h"
 #include "ui/WebGuiServer.hpp"
@@ -90,7 +91,7 @@ using core::algo::hex_to_le_bytes_pad4;
 using core::algo::buildE2;
 using core::algo::product_prefix_fit_u64;
 using core::algo::product_tree_range_u64;
-using core::algo::compute_X_with_dots;
+using core::algo::compute_X;
 using core::algo::gcd_with_dots;
 
 int App::runLlSafeMarinDoubling()
@@ -122,42 +123,52 @@ int App::runLlSafeMarinDoubling()
     std::ostringstream ck; ck << "llsafe_m_" << p << ".ckpt";
     const std::string ckpt_file = ck.str();
 
-    auto read_ckpt = [&](const std::string& file, uint32_t& ri, double& et)->int{
+    // Registers a checkpoint must hold: RV and RU; the check copies are rebuilt on resume
+    const std::vector<engine::Reg> liveRegs = {0, 1};
+    auto read_legacy_ckpt = [&](const std::string& file, uint32_t& ri, double& et)->int{
         File f(file);
         if (!f.exists()) return -1;
         int version = 0; if (!f.read(reinterpret_cast<char*>(&version), sizeof(version))) return -2;
-        if (version != 1) return -2;
+        if (version != 1 && version != 2) return -2;
         uint32_t rp = 0; if (!f.read(reinterpret_cast<char*>(&rp), sizeof(rp))) return -2;
         if (rp != p) return -2;
         if (!f.read(reinterpret_cast<char*>(&ri), sizeof(ri))) return -2;
         if (!f.read(reinterpret_cast<char*>(&et), sizeof(et))) return -2;
-        const size_t cksz = eng->get_checkpoint_size();
-        std::vector<char> data(cksz);
-        if (!f.read(data.data(), cksz)) return -2;
-        if (!eng->set_checkpoint(data)) return -2;
+        if (version == 1) {
+            // all registers in transform layout
+            const size_t cksz = eng->get_checkpoint_size();
+            std::vector<char> data(cksz);
+            if (!f.read(data.data(), cksz)) return -2;
+            if (!eng->set_checkpoint(data)) return -2;
+        } else {
+            // live registers only, packed
+            uint64_t cksz = 0; if (!f.read(reinterpret_cast<char*>(&cksz), sizeof(cksz))) return -2;
+            std::vector<char> data(cksz);
+            if (!f.read(data.data(), cksz)) return -2;
+            if (!eng->set_packed_checkpoint(liveRegs, data)) return -2;
+        }
         if (!f.check_crc32()) return -2;
         return 0;
     };
 
+    auto read_ckpt = [&](const std::string& file, uint32_t& ri, double& et)->int{
+        io::CheckpointReader f;
+        if (!f.open(file)) return read_legacy_ckpt(file, ri, et);
+        uint32_t rp = 0; std::vector<char> regs;
+        if (!f.get(io::ckpt::Exponent, rp) || rp != p) return -2;
+        if (!f.get(io::ckpt::Iteration, ri) || !f.get(io::ckpt::Elapsed, et)) return -2;
+        if (!f.getBytes(io::ckpt::Registers, regs) || !eng->set_packed_checkpoint(liveRegs, regs)) return -2;
+        return 0;
+    };
+
+    io::CheckpointWriter ckptWriter;
     auto save_ckpt = [&](uint32_t i, double et){
-        const std::string oldf = ckpt_file + ".old", newf = ckpt_file + ".new";
-        {
-            File f(newf, "wb");
-            int version = 1;
-            if (!f.write(reinterpret_cast<const char*>(&version), sizeof(version))) return;
-            if (!f.write(reinterpret_cast<const char*>(&p), sizeof(p))) return;
-            if (!f.write(reinterpret_cast<const char*>(&i), sizeof(i))) return;
-            if (!f.write(reinterpret_cast<const char*>(&et), sizeof(et))) return;
-            const size_t cksz = eng->get_checkpoint_size();
-            std::vector<char> data(cksz);
-            if (!eng->get_checkpoint(data)) return;
-            if (!f.write(data.data(), cksz)) return;
-            f.write_crc32();
-        }
-        std::remove(oldf.c_str());
-        struct stat s;
-        if ((stat(ckpt_file.c_str(), &s) == 0) && (std::rename(ckpt_file.c_str(), oldf.c_str()) != 0)) return;
-        std::rename(newf.c_str(), ckpt_file.c_str());
+        auto& s = ckptWriter.next();
+        s.put(io::ckpt::Exponent, p); s.put(io::ckpt::Iteration, i); s.put(io::ckpt::Elapsed, et);
+        auto& data = s.scratch();
+        eng->get_packed_checkpoint(data, liveRegs);
+        s.put(io::ckpt::Registers, data.data(), data.size());
+        ckptWriter.submit(ckpt_file);
     };
 
     const size_t RV = 0, RU = 1, RVC = 2, RUC = 3, RTMP = 4, RVCHK = 5, RUCHK = 6, RSCR [[maybe_unused]] = 7;
@@ -213,6 +224,7 @@ int App::runLlSafeMarinDoubling()
         if (interrupted) {
             const double elapsed_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_clock).count() + restored_time;
             save_ckpt((uint32_t)iter, elapsed_time);
+            ckptWriter.wait();
             delete eng;
             std::cout << "\nInterrupted by user, state saved at iteration " << iter << std::endl;
             if (guiServer_) {
@@ -395,7 +407,7 @@ int App::runLlSafeMarin()
     std::ostringstream ck; ck << "llsafe_m_" << p << ".ckpt";
     const std::string ckpt_file = ck.str();
 
-    auto read_ckpt = [&](const std::string& file, uint64_t& iter_done, uint64_t& itersave, uint64_t& jsave, double& et)->int{
+    auto read_legacy_ckpt = [&](const std::string& file, uint64_t& iter_done, uint64_t& itersave, uint64_t& jsave, double& et)->int{
         File f(file);
         if (!f.exists()) return -1;
         int version = 1; if (!f.read(reinterpret_cast<char*>(&version), sizeof(version))) return -2;
@@ -419,27 +431,28 @@ int App::runLlSafeMarin()
         return 0;
     };
 
+    const uint32_t TagIterSave = io::ckptTag("GSAV"), TagJSave = io::ckptTag("GJSV");
+    auto read_ckpt = [&](const std::string& file, uint64_t& iter_done, uint64_t& itersave, uint64_t& jsave, double& et)->int{
+        io::CheckpointReader f;
+        if (!f.open(file)) return read_legacy_ckpt(file, iter_done, itersave, jsave, et);
+        uint32_t rp = 0; std::vector<char> data;
+        if (!f.get(io::ckpt::Exponent, rp) || rp != p) return -2;
+        if (!f.get(io::ckpt::Iteration, iter_done) || !f.get(io::ckpt::Elapsed, et)) return -2;
+        if (!f.get(TagIterSave, itersave) || !f.get(TagJSave, jsave)) return -2;
+        if (!f.getBytes(io::ckpt::EngineData, data) || !eng->set_checkpoint(data)) return -2;
+        return 0;
+    };
+
+    io::CheckpointWriter ckptWriter;
     auto save_ckpt = [&](uint64_t iter_done, uint64_t itersave, uint64_t jsave, double et){
-        const std::string oldf = ckpt_file + ".old", newf = ckpt_file + ".new";
-        {
-            File f(newf, "wb");
-            int version = 2;
-            if (!f.write(reinterpret_cast<const char*>(&version), sizeof(version))) return;
-            if (!f.write(reinterpret_cast<const char*>(&p), sizeof(p))) return;
-            if (!f.write(reinterpret_cast<const char*>(&iter_done), sizeof(iter_done))) return;
-            if (!f.write(reinterpret_cast<const char*>(&et), sizeof(et))) return;
-            if (!f.write(reinterpret_cast<const char*>(&itersave), sizeof(itersave))) return;
-            if (!f.write(reinterpret_cast<const char*>(&jsave), sizeof(jsave))) return;
-            const size_t cksz = eng->get_checkpoint_size();
-            std::vector<char> data(cksz);
-            if (!eng->get_checkpoint(data)) return;
-            if (!f.write(data.data(), cksz)) return;
-            f.write_crc32();
-        }
-        std::remove(oldf.c_str());
-        struct stat s;
-        if ((stat(ckpt_file.c_str(), &s) == 0) && (std::rename(ckpt_file.c_str(), oldf.c_str()) != 0)) return;
-        std::rename(newf.c_str(), ckpt_file.c_str());
+        auto& s = ckptWriter.next();
+        s.put(io::ckpt::Exponent, p); s.put(io::ckpt::Iteration, iter_done); s.put(io::ckpt::Elapsed, et);
+        s.put(TagIterSave, itersave); s.put(TagJSave, jsave);
+        auto& data = s.scratch();
+        data.resize(eng->get_checkpoint_size());
+        if (!eng->get_checkpoint(data)) return;
+        s.put(io::ckpt::EngineData, data.data(), data.size());
+        ckptWriter.submit(ckpt_file);
     };
 
     const size_t RRES_A=0, RRES_B=1, RACC_A=2, RACC_B=3, RCHK_A=4, RCHK_B=5, RSAVE_R_A=6, RSAVE_R_B=7, RSAVE_F_A=8, RSAVE_F_B=9, RBASE_A=10, RBASE_B=11, RTa=12, RTb=13, RM0=14, RM1=15, RPREV_A=16, RPREV_B=17;
@@ -549,6 +562,7 @@ int App::runLlSafeMarin()
         if (interrupted) {
             const double elapsed_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_clock).count() + restored_time;
             save_ckpt(iter, itersave, jsave, elapsed_time);
+            ckptWriter.wait();
             std::cout << "\nInterrupted by user, state saved at iteration " << iter << " j=" << j << std::endl;
             if (guiServer_) { std::ostringstream oss; oss << "Interrupted by user, state saved at iteration " << iter << " j=" << j; guiServer_->appendLog(oss.str()); }
             spinner.displayBackupInfo((uint32_t)iter, (uint32_t)totalIters, timer.elapsed(), res64_x, guiServer_ ? guiServer_.get() : nullptr);
@@ -90,7 +90,7 @@ using core::algo::hex_to_le_bytes_pad4;
 using core::algo::buildE2;
 using core::algo::product_prefix_fit_u64;
 using core::algo::product_tree_range_u64;
-using core::algo::compute_X_with_dots;
+using core::algo::compute_X;
 using core::algo::gcd_with_dots;
 
 int core::App::runMemtestOpenCL() {
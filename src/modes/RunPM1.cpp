@@ -6,17 +6,25 @@
 #include "core/Printer.hpp"
 #include "core/ProofSet.hpp"
 #include "core/ProofSetMarin.hpp"
+#include "core/PM1BoundsOptimizer.hpp"
+#include "core/PolyStage2.hpp"
+#include "core/Stage2Planner.hpp"
 #include "math/Carry.hpp"
+#include "math/PrimeSieve.hpp"
+#include "math/Stage2Pairing.hpp"
 #include "util/GmpUtils.hpp"
 #include "io/WorktodoParser.hpp"
 #include "io/WorktodoManager.hpp"
 #include "io/CurlClient.hpp"
+#include "io/CheckpointWriter.hpp"
 #include "marin/engine.h"
+#include "marin/ibdwt.h"
 #include "marin/file.h"
 #include "ui/WebGuiServer.hpp"
 #include "core/Version.hpp"
 #include <sys/stat.h>
 #include <cstdio>
+#include <algorithm>
 #include <map>
 #include <future>
 #ifndef CL_TARGET_OPENCL_VERSION
@@ -44,6 +52,7 @@
 #include <memory>
 #include <optional>
 #include <cmath>
+#include <bit>
 #include <thread>
 #include <gmp.h>
 #include <cstddef>
@@ -76,6 +85,7 @@ using core::algo::mpz_to_lower_hex;
 using core::algo::ecm_checksum_pminus1;
 using core::algo::CHKSUMMOD;
 using core::algo::write_prime95_s1_from_bytes;
+using core::algo::read_prime95_s1;
 using core::algo::checksum_prime95_s1;
 using core::algo::hex_to_bytes_reversed_pad8;
 using core::algo::parse_ecm_resume_line;
@@ -90,9 +100,151 @@ using core::algo::hex_to_le_bytes_pad4;
 using core::algo::buildE2;
 using core::algo::product_prefix_fit_u64;
 using core::algo::product_tree_range_u64;
-using core::algo::compute_X_with_dots;
+using core::algo::compute_X;
 using core::algo::gcd_with_dots;
 
+namespace {
+
+// Sections of the stage-1 checkpoint pm1_m_<p>.ckpt besides the common ones
+constexpr uint32_t TagCheckPass   = io::ckptTag("GCHK");
+constexpr uint32_t TagBlocks      = io::ckptTag("GBLK");
+constexpr uint32_t TagBitsInBlock = io::ckptTag("GBIB");
+constexpr uint32_t TagBlockLen    = io::ckptTag("GBLN");
+constexpr uint32_t TagInLot       = io::ckptTag("GLOT");
+constexpr uint32_t TagExpAcc      = io::ckptTag("EACC");
+constexpr uint32_t TagWindowBits  = io::ckptTag("WBIT");
+constexpr uint32_t TagChunkIndex  = io::ckptTag("CIDX");
+constexpr uint32_t TagChunkStart  = io::ckptTag("CSTP");
+constexpr uint32_t TagFirstChunk  = io::ckptTag("CFST");
+constexpr uint32_t TagProcessed   = io::ckptTag("CBIT");
+constexpr uint32_t TagChunkBits   = io::ckptTag("CLEN");
+constexpr uint32_t TagPassB1      = io::ckptTag("S1B1");
+constexpr uint32_t TagPassFrom    = io::ckptTag("S1B0");
+constexpr uint32_t TagPassTwo     = io::ckptTag("S1P2");
+
+// Bounds of the stage-2 checkpoint pm1_s2_m_<p>.ckpt
+constexpr uint32_t TagStage2B1    = io::ckptTag("BND1");
+constexpr uint32_t TagStage2B2    = io::ckptTag("BND2");
+
+// Partial stage-2 accumulator pm1_s2_m_<p>_<lo>_<hi>.part: B1, the primes [first, last] it
+// covers and the accumulator, a residue mod 2^p - 1
+constexpr uint32_t TagPartB1      = io::ckptTag("BND1");
+constexpr uint32_t TagPartFirst   = io::ckptTag("S2LO");
+constexpr uint32_t TagPartLast    = io::ckptTag("S2HI");
+constexpr uint32_t TagPartAcc     = io::ckptTag("S2AC");
+
+// Stage 2 only needs the registers of the stage-1 checkpoint.
+// Returns 1 if the file is not a container, so the caller tries the legacy layout.
+int readStage1Engine(engine* e, const std::string& file, uint32_t p) {
+    io::CheckpointReader f;
+    if (!f.open(file)) return 1;
+    uint32_t rp = 0; std::vector<char> data;
+    if (!f.get(io::ckpt::Exponent, rp) || rp != p) return -2;
+    if (!f.getBytes(io::ckpt::EngineData, data) || !e->set_checkpoint(data)) return -2;
+    return 0;
+}
+
+// Registers of the stage-1 engine, runPM1Marin
+constexpr size_t kStage1Regs = 11;
+
+// H, register 0 of the stage-1 registers data, to register dst of e: stage 2 reads it into
+// its own engine rather than a second one beside it on the device.
+bool setStage1State(const engine* e, engine::Reg dst, const std::vector<char>& data) {
+    // the engines of an exponent share the register layout, H is copied as it is
+    const size_t bytes = e->get_register_data_size();
+    if (data.size() != kStage1Regs * bytes) return false;
+    const std::vector<char> reg(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(bytes));
+    return e->set_data(dst, reg);
+}
+
+// As readStage1Engine, H only
+int readStage1State(const engine* e, engine::Reg dst, const std::string& file, uint32_t p) {
+    io::CheckpointReader f;
+    if (!f.open(file)) return 1;
+    uint32_t rp = 0; std::vector<char> data;
+    if (!f.get(io::ckpt::Exponent, rp) || rp != p) return -2;
+    if (!f.getBytes(io::ckpt::EngineData, data) || !setStage1State(e, dst, data)) return -2;
+    return 0;
+}
+
+// A stage 1 done elsewhere, for -s1resume: a GMP-ECM resume line (METHOD=P-1, N=2^p-1)
+// or a Prime95 save file. H = x0^E mod 2^p - 1, stage 2 needs neither x0 nor E.
+// Returns -1 if the file cannot be read, -2 if it holds no stage 1 of 2^p - 1,
+// -3 if the checksum of the resume line is wrong.
+int readStage1Resume(const std::string& file, uint32_t p, uint64_t& B1, mpz_class& H) {
+    const mpz_class Mp = (mpz_class(1) << p) - 1;
+    std::string txt;
+    if (!read_text_file(file, txt)) return -1;
+    if (txt.find("METHOD=P-1") != std::string::npos) {
+        // GMP-ECM appends a line per run, the first valid one of p is taken
+        std::istringstream lines(txt);
+        std::string line;
+        int rc = -2;
+        while (std::getline(lines, line)) {
+            if (line.find("METHOD=P-1") == std::string::npos) continue;
+            try {
+                uint64_t lineB1 = 0; uint32_t lp = 0; std::string hexX;
+                const size_t iC = line.find("CHECKSUM=");
+                mpz_class X;
+                if (!parse_ecm_resume_line(line, lineB1, lp, hexX) || lp != p || iC == std::string::npos || X.set_str(hexX, 16) != 0) continue;
+                if (std::stoul(line.substr(iC + 9)) != ecm_checksum_pminus1(lineB1, p, X)) { rc = -3; continue; }
+                B1 = lineB1;
+                H = X % Mp;
+                return (H > 1) ? 0 : -2;
+            } catch (const std::exception&) {}
+        }
+        return rc;
+    }
+    uint32_t rp = 0; std::vector<uint8_t> data;
+    if (!read_prime95_s1(file, rp, B1, data) || rp != p) return -2;
+    mpz_import(H.get_mpz_t(), data.size(), -1, 1, 0, 0, data.data());
+    H %= Mp;
+    return (H > 1) ? 0 : -2;
+}
+
+} // namespace
+
+bool App::pm1Stage1Complete(const std::string& file, uint32_t p, uint64_t B1) {
+    io::CheckpointReader f;
+    if (!f.open(file)) return true;     // legacy layout, taken as complete
+    uint32_t rp = 0, ri = 0; uint64_t bitsInChunk = 0, passB1 = 0;
+    if (!f.get(io::ckpt::Exponent, rp) || rp != p) return false;
+    if (!f.get(io::ckpt::Iteration, ri) || !f.get(TagChunkBits, bitsInChunk)) return false;
+    // saved at iteration 0 once complete, older checkpoints have no bound
+    if (ri != 0 || bitsInChunk != 0) return false;
+    return !f.get(TagPassB1, passB1) || passB1 >= B1;
+}
+
+bool App::pm1Stage2Resumable(const std::string& file, uint32_t p, uint64_t B1, uint64_t B2) {
+    io::CheckpointReader f;
+    if (!f.open(file)) return false;
+    uint32_t rp = 0; uint64_t s2B1 = 0, s2B2 = 0;
+    return f.get(io::ckpt::Exponent, rp) && rp == p
+        && f.get(TagStage2B1, s2B1) && s2B1 == B1 && f.get(TagStage2B2, s2B2) && s2B2 == B2;
+}
+
+void App::choosePM1Bounds() {
+    const uint32_t pexp = static_cast<uint32_t>(options.exponent);
+    const double tfBits = (options.tfBits > 0) ? options.tfBits : core::PM1BoundsOptimizer::defaultTfBits(pexp);
+    const double testsSaved = (options.testsSaved > 0) ? options.testsSaved : 1.0;
+    // The registers of stage 2 and its memory, as runPM1Stage2Marin will plan it
+    const size_t regBytes = ibdwt::transform_size(pexp) * sizeof(uint64_t);
+    const uint64_t regBudget = (options.s2mem > 0) ? options.s2mem << 20
+                             : core::Stage2Planner::deviceBudget(context.getGlobalMemSize(), context.getMaxMemAllocSize());
+    const core::PM1BoundsOptimizer optimizer(pexp, tfBits, testsSaved, regBytes, 11, regBudget);
+    const core::PM1Choice c = optimizer.optimize();
+
+    engine* eng = engine::create_gpu(pexp, 1, static_cast<size_t>(options.device_id), false);
+    const double spt = core::Stage2Planner::secondsPerTransform(*eng, static_cast<engine::Reg>(0));
+    delete eng;
+
+    options.B1 = c.B1;
+    options.B2 = c.B2;
+    const std::string desc = optimizer.describe(c, spt);
+    std::cout << desc << std::endl;
+    if (guiServer_) guiServer_->appendLog(desc);
+}
+
 int App::runPM1Stage2() {
     using namespace std::chrono;
     bool debug = false;
@@ -189,17 +341,17 @@ int App::runPM1Stage2() {
     buffers->Hq = clCreateBuffer(context.getContext(), CL_MEM_READ_WRITE, limbBytes, nullptr, &err);
     nttEngine->copy(buffers->Hbuf, buffers->input, limbBytes);
 
-    mpz_class p_prev;
-    mpz_class p;
-    mpz_nextprime(p_prev.get_mpz_t(), B1.get_mpz_t());
-    p = p_prev;
+    math::PrimeSieve primes(options.B1 + 1, options.B2);
+    const uint64_t firstPrime = primes.next();
+    uint64_t p_prev = firstPrime;
+    uint64_t p = firstPrime;
 
-    size_t bitlen = mpz_sizeinbase(p.get_mpz_t(), 2);
+    size_t bitlen = size_t(std::bit_width(p));
     for (int64_t i = static_cast<int64_t>(bitlen) - 2; i >= 0; --i) {
         nttEngine->forward(buffers->input, 0);
         nttEngine->inverse(buffers->input, 0);
         carry.carryGPU(buffers->input, buffers->blockCarryBuf, limbBytes);
-        if (mpz_tstbit(p.get_mpz_t(), static_cast<mp_bitcnt_t>(i))) {
+        if ((p >> i) & 1) {
             nttEngine->mulInPlace(buffers->input, buffers->Hbuf, carry, limbBytes);
         }
     }
@@ -215,12 +367,12 @@ int App::runPM1Stage2() {
     //uint64_t resumeIdx = 0;
     uint64_t resumeIdx = backupManager.loadStatePM1S2(buffers->Hq, buffers->Qbuf, limbBytes);
 
-    mpz_nextprime(p_prev.get_mpz_t(), B1.get_mpz_t());
-    p = p_prev;
+    p_prev = firstPrime;
+    p = firstPrime;
     idx = 0;
     for (; idx < resumeIdx; ++idx) {
         p_prev = p;
-        mpz_nextprime(p.get_mpz_t(), p.get_mpz_t());
+        p = primes.next();
     }
 
 
@@ -236,10 +388,9 @@ int App::runPM1Stage2() {
     auto lastDisplay = start;
     //auto lastBackup  = start;
 
-    for (; p <= B2; ++idx) {
+    for (; p != 0; ++idx) {
         if (idx) {
-            mpz_class d = p - p_prev;
-            unsigned long idxGap = mpz_get_ui(d.get_mpz_t()) / 2 - 1;
+            unsigned long idxGap = static_cast<unsigned long>((p - p_prev) / 2 - 1);
             ensureEvenPow(idxGap);
             
             nttEngine->forward_simple(buffers->Hq, 0);
@@ -272,7 +423,7 @@ int App::runPM1Stage2() {
             int minutes = (static_cast<int>(etaSec) % 3600) / 60;
             int seconds = static_cast<int>(etaSec) % 60;
             std::cout << "Progress: " << std::fixed << std::setprecision(2) << percent << "% | "
-                      << "prime: " << p.get_ui() << " | "
+                      << "prime: " << p << " | "
                       << "Iter: " << (idx + 1) << " | "
                       << "Elapsed: " << std::fixed << std::setprecision(2) << elapsedSec << "s | "
                       << "IPS: " << std::fixed << std::setprecision(2) << ips << " | "
@@ -281,7 +432,7 @@ int App::runPM1Stage2() {
             if (guiServer_) {
                                 std::ostringstream oss;
                                 oss << "Progress: " << std::fixed << std::setprecision(2) << percent << "% | "
-                      << "prime: " << p.get_ui() << " | "
+                      << "prime: " << p << " | "
                       << "Iter: " << (idx + 1) << " | "
                       << "Elapsed: " << std::fixed << std::setprecision(2) << elapsedSec << "s | "
                       << "IPS: " << std::fixed << std::setprecision(2) << ips << " | "
@@ -302,7 +453,7 @@ int App::runPM1Stage2() {
 
 
         p_prev = p;
-        mpz_nextprime(p.get_mpz_t(), p.get_mpz_t());
+        p = primes.next();
         /*if (interrupted) {
             clFinish(context.getQueue());
             backupManager.saveStatePM1S2(Hq, Qbuf, idx, limbBytes);
@@ -718,10 +869,29 @@ int App::runPM1() {
     return 1;
 }
 
-int App::runPM1Stage2Marin() {
+int App::runPM1Stage2Marin(const std::function<bool()>& cancelled) {
     using namespace std::chrono;
     if (guiServer_) { std::ostringstream oss; oss << "P-1 factoring stage 2"; guiServer_->setStatus(oss.str()); }
-    bool debug = true;//options.debug;
+    const bool debug = options.debug;
+    // -s1resume: B1 is the bound of the stage 1 of the file
+    mpz_class resumeH;
+    if (!options.s1resume.empty()) {
+        uint64_t resumeB1 = 0;
+        const int rc = readStage1Resume(options.s1resume, static_cast<uint32_t>(options.exponent), resumeB1, resumeH);
+        if (rc != 0) {
+            std::ostringstream oss;
+            oss << "Stage 2: " << options.s1resume << ": "
+                << (rc == -1 ? "cannot read the file" : rc == -3 ? "wrong checksum" : "no valid P-1 stage 1 of this exponent");
+            std::cerr << oss.str() << std::endl;
+            if (guiServer_) guiServer_->appendLog(oss.str());
+            return -2;
+        }
+        options.B1 = resumeB1;
+        std::ostringstream oss;
+        oss << "Stage 1 to B1 = " << resumeB1 << " loaded from " << options.s1resume;
+        std::cout << oss.str() << std::endl;
+        if (guiServer_) guiServer_->appendLog(oss.str());
+    }
     uint64_t B1u = options.B1, B2u = options.B2;
     mpz_class B1(static_cast<unsigned long>(B1u)), B2(static_cast<unsigned long>(B2u));
     if (B2 <= B1) {
@@ -732,71 +902,104 @@ int App::runPM1Stage2Marin() {
     std::cout << "\nStart a P-1 factoring : Stage 2 Bounds: B1 = " << B1 << ", B2 = " << B2 << std::endl;
     if (guiServer_) { std::ostringstream oss; oss << "\nStart a P-1 factoring : Stage 2 Bounds: B1 = " << B1 << ", B2 = " << B2 << std::endl; guiServer_->appendLog(oss.str()); }
     uint32_t pexp = static_cast<uint32_t>(options.exponent);
+    // The primes [qFirst, qLast] of this run: all of (B1, B2], or with -s2range the part of
+    // [lo, hi) in it, whose accumulator is written for -s2merge instead of the GCD
+    const bool partial = (options.s2hi > 0);
+    uint64_t qFirst = B1u + 1, qLast = B2u;
+    std::string rangeSuffix;
+    if (partial) {
+        qFirst = std::max(qFirst, options.s2lo);
+        qLast = std::min(qLast, options.s2hi - 1);
+        if (qFirst > qLast) {
+            std::cerr << "Stage 2: the range [" << options.s2lo << ", " << options.s2hi << ") has no prime of (B1, B2].\n";
+            if (guiServer_) { std::ostringstream oss; oss << "Stage 2: the range [" << options.s2lo << ", " << options.s2hi << ") has no prime of (B1, B2]."; guiServer_->appendLog(oss.str()); }
+            return -1;
+        }
+        rangeSuffix = "_" + std::to_string(options.s2lo) + "_" + std::to_string(options.s2hi);
+        std::cout << "Stage 2 on the primes of [" << qFirst << ", " << qLast << "] only" << std::endl;
+        if (guiServer_) { std::ostringstream oss; oss << "Stage 2 on the primes of [" << qFirst << ", " << qLast << "] only"; guiServer_->appendLog(oss.str()); }
+    }
     const bool verbose = true;//options.debug;
     const size_t baseRegs = 11;
-    const size_t RSTATE=0, RACC_L=1, RACC_R=2, /*RCHK=3,*/ RPOW=4, RTMP=5;
-    std::ostringstream ck2; ck2 << "pm1_s2_m_" << pexp << ".ckpt";
+    // H, the accumulator, the giant step G_k = H^((kD)^2), its ratio R_k = H^((2k+1)D^2) and
+    // the multiplicand S = H^(2D^2) of the ratio. The baby steps H^(j^2) follow baseRegs.
+    const size_t RSTATE=0, RACC_L=1, RGIANT=2, RRATIO=3, RSTEP=4, RTMP=5, RDIFF=6, RCUR=7, RINC=8, RINC8=9;
+    std::ostringstream ck2; ck2 << "pm1_s2_m_" << pexp << rangeSuffix << ".ckpt";
     const std::string ckpt_file_s2 = ck2.str();
-    auto read_ckpt_s2 = [&](engine* e, const std::string& file, uint64_t& saved_p, uint64_t& saved_idx, double& et, uint64_t& sB1, uint64_t& sB2)->int{
-        File f(file);
-        if (!f.exists()) return -1;
-        int version = 0; if (!f.read(reinterpret_cast<char*>(&version), sizeof(version))) return -2;
-        if (version != 1) return -2;
-        uint32_t rp = 0; if (!f.read(reinterpret_cast<char*>(&rp), sizeof(rp))) return -2;
-        if (rp != pexp) return -2;
-        if (!f.read(reinterpret_cast<char*>(&sB1), sizeof(sB1))) return -2;
-        if (!f.read(reinterpret_cast<char*>(&sB2), sizeof(sB2))) return -2;
-        if (!f.read(reinterpret_cast<char*>(&saved_p), sizeof(saved_p))) return -2;
-        if (!f.read(reinterpret_cast<char*>(&saved_idx), sizeof(saved_idx))) return -2;
-        if (!f.read(reinterpret_cast<char*>(&et), sizeof(et))) return -2;
-        const size_t cksz = e->get_checkpoint_size();
-        std::vector<char> data(cksz);
-        if (!f.read(data.data(), cksz)) return -2;
-        if (!e->set_checkpoint(data)) return -2;
-        if (!f.check_crc32()) return -2;
-        return 0;
-    };
-    auto save_ckpt_s2 = [&](engine* e, uint64_t cur_p, uint64_t cur_idx, double et){
-        const std::string oldf = ckpt_file_s2 + ".old", newf = ckpt_file_s2 + ".new";
-        {
-            File f(newf, "wb");
-            int version = 1;
-            if (!f.write(reinterpret_cast<const char*>(&version), sizeof(version))) return;
-            if (!f.write(reinterpret_cast<const char*>(&pexp), sizeof(pexp))) return;
-            if (!f.write(reinterpret_cast<const char*>(&B1u), sizeof(B1u))) return;
-            if (!f.write(reinterpret_cast<const char*>(&B2u), sizeof(B2u))) return;
-            if (!f.write(reinterpret_cast<const char*>(&cur_p), sizeof(cur_p))) return;
-            if (!f.write(reinterpret_cast<const char*>(&cur_idx), sizeof(cur_idx))) return;
-            if (!f.write(reinterpret_cast<const char*>(&et), sizeof(et))) return;
-            const size_t cksz = e->get_checkpoint_size();
-            std::vector<char> data(cksz);
-            if (!e->get_checkpoint(data)) return;
-            if (!f.write(data.data(), cksz)) return;
-            f.write_crc32();
-        }
-        std::remove(oldf.c_str());
-        struct stat s;
-        if ((stat(ckpt_file_s2.c_str(), &s) == 0) && (std::rename(ckpt_file_s2.c_str(), oldf.c_str()) != 0)) return;
-        std::rename(newf.c_str(), ckpt_file_s2.c_str());
+    const uint32_t TagB1 = TagStage2B1, TagB2 = TagStage2B2, TagPrime = io::ckptTag("PRIM"), TagD = io::ckptTag("BSGD");
+    const uint32_t TagAlgo = io::ckptTag("S2AL");
+    core::Stage2Plan plan;
+    std::vector<engine::Reg> liveRegs;
+    io::CheckpointWriter ckptWriter;
+    // next_p: the primes below are done; k: the next giant step, in RGIANT and RRATIO for BSGS
+    auto save_ckpt_s2 = [&](engine* e, uint64_t D, uint64_t next_p, uint64_t k, double et){
+        auto& s = ckptWriter.next();
+        s.put(io::ckpt::Exponent, pexp); s.put(TagB1, B1u); s.put(TagB2, B2u); s.put(TagD, D); s.put(TagAlgo, static_cast<uint32_t>(plan.algo));
+        s.put(TagPrime, next_p); s.put(io::ckpt::Iteration, k); s.put(io::ckpt::Elapsed, et);
+        auto& data = s.scratch();
+        e->get_packed_checkpoint(data, liveRegs);
+        s.put(io::ckpt::Registers, data.data(), data.size());
+        ckptWriter.submit(ckpt_file_s2);
     };
-    unsigned long nbEven = evenGapBound(B2);
-    if (nbEven == 0) nbEven = 1;
-    size_t regCount = baseRegs + nbEven + 2;
-    engine* eng = engine::create_gpu(pexp, regCount, static_cast<size_t>(options.device_id), verbose);
-    const size_t REVEN = baseRegs;
-    const size_t RSAVE_Q = baseRegs + nbEven;
-    const size_t RSAVE_HQ = baseRegs + nbEven + 1;
-    uint64_t resume_idx = 0;
-    uint64_t resume_p_u64 = 0;
+
+    // The plan is made before the engine is created, the baby steps or the polynomials are
+    // its registers. A resumed stage 2 keeps the algorithm and the D of its checkpoint.
+    const size_t regBytes = ibdwt::transform_size(pexp) * sizeof(uint64_t);
+    const uint64_t regBudget = (options.s2mem > 0) ? options.s2mem << 20
+                             : core::Stage2Planner::deviceBudget(context.getGlobalMemSize(), context.getMaxMemAllocSize());
+    const core::Stage2Planner planner(qFirst - 1, qLast, regBytes, baseRegs);
+    plan = planner.plan(regBudget, options.s2poly);
+    if (options.s2poly && plan.algo != core::Stage2Plan::Algo::Polynomial)
+        std::cout << "Stage 2: not enough memory for the polynomial stage 2, using baby-step giant-step" << std::endl;
+    uint64_t resume_p = 0, resume_k = 0;
     double restored_time = 0.0;
-    uint64_t s2B1=0, s2B2=0;
-    int rs2 = read_ckpt_s2(eng, ckpt_file_s2, resume_p_u64, resume_idx, restored_time, s2B1, s2B2);
-    bool resumed_s2 = (rs2 == 0) && (s2B1 == B1u) && (s2B2 == B2u);
-    if (!resumed_s2) {
-        engine* eng_load = engine::create_gpu(pexp, baseRegs, static_cast<size_t>(options.device_id), verbose);
+    io::CheckpointReader s2f;
+    bool resumed_s2 = false;
+    if (s2f.open(ckpt_file_s2)) {
+        uint32_t rp = 0, s2Algo = 0; uint64_t s2B1 = 0, s2B2 = 0, s2D = 0;
+        if (!s2f.get(TagAlgo, s2Algo)) s2Algo = 0;
+        resumed_s2 = s2f.get(io::ckpt::Exponent, rp) && rp == pexp
+                  && s2f.get(TagB1, s2B1) && s2B1 == B1u && s2f.get(TagB2, s2B2) && s2B2 == B2u
+                  && s2f.get(TagD, s2D)
+                  && ((s2Algo == 0 && std::ranges::count(math::Stage2Pairing::candidates(), s2D) != 0)
+                      || (s2Algo == 1 && std::ranges::count(core::PolyStage2::candidates(), s2D) != 0))
+                  && s2f.get(TagPrime, resume_p) && s2f.get(io::ckpt::Iteration, resume_k)
+                  && s2f.get(io::ckpt::Elapsed, restored_time) && s2f.has(io::ckpt::Registers);
+        if (resumed_s2) plan = planner.make(static_cast<core::Stage2Plan::Algo>(s2Algo), s2D);
+    }
+    const uint64_t D = plan.D;
+    const bool polyS2 = (plan.algo == core::Stage2Plan::Algo::Polynomial);
+    if (polyS2) liveRegs = { RSTATE, RACC_L };
+    else liveRegs = { RSTATE, RACC_L, RGIANT, RRATIO };
+    const std::vector<uint32_t> babySteps = polyS2 ? std::vector<uint32_t>() : math::Stage2Pairing::babySteps(D);
+    const size_t nBaby = babySteps.size();
+    const size_t RBABY = baseRegs;
+    const size_t regCount = plan.registers;
+    engine* eng = engine::create_gpu(pexp, regCount, static_cast<size_t>(options.device_id), verbose);
+    {
+        const double spt = core::Stage2Planner::secondsPerTransform(*eng, static_cast<engine::Reg>(RTMP));
+        const std::string desc = planner.describe(plan, regBudget, spt);
+        std::cout << desc << std::endl;
+        if (guiServer_) guiServer_->appendLog(desc);
+    }
+    if (resumed_s2) {
+        std::vector<char> regs;
+        resumed_s2 = s2f.getBytes(io::ckpt::Registers, regs) && eng->set_packed_checkpoint(liveRegs, regs);
+    }
+    if (!resumed_s2 && !options.s1resume.empty()) {
+        mpz_t H; mpz_init_set(H, resumeH.get_mpz_t());
+        eng->set_mpz(static_cast<engine::Reg>(RSTATE), H);
+        mpz_clear(H);
+        eng->set(static_cast<engine::Reg>(RACC_L), 1);
+    }
+    else if (!resumed_s2) {
         std::ostringstream ck; ck << "pm1_m_" << pexp << ".ckpt";
         const std::string ckpt_file = ck.str();
         auto read_ckpt = [&](engine* e, const std::string& file)->int{
+            // an unfinished stage 1, or one of a lower B1, would give a stage 2 of other bounds
+            if (File(file).exists() && !pm1Stage1Complete(file, pexp, B1u)) return -3;
+            const int rc = readStage1State(e, static_cast<engine::Reg>(RSTATE), file, pexp);
+            if (rc <= 0) return rc;
             File f(file);
             if (!f.exists()) return -1;
             int version = 0; if (!f.read(reinterpret_cast<char*>(&version), sizeof(version))) return -2;
@@ -806,10 +1009,8 @@ int App::runPM1Stage2Marin() {
             uint32_t ri = 0; double et = 0.0;
             if (!f.read(reinterpret_cast<char*>(&ri), sizeof(ri))) return -2;
             if (!f.read(reinterpret_cast<char*>(&et), sizeof(et))) return -2;
-            const size_t cksz = e->get_checkpoint_size();
-            std::vector<char> data(cksz);
-            if (!f.read(data.data(), cksz)) return -2;
-            if (!e->set_checkpoint(data)) return -2;
+            std::vector<char> data(kStage1Regs * e->get_register_data_size());
+            if (!f.read(data.data(), data.size())) return -2;
             uint64_t tmp64;
             if (!f.read(reinterpret_cast<char*>(&tmp64), sizeof(tmp64))) return -2;
             if (!f.read(reinterpret_cast<char*>(&tmp64), sizeof(tmp64))) return -2;
@@ -827,127 +1028,191 @@ int App::runPM1Stage2Marin() {
             if (!f.read(reinterpret_cast<char*>(&processedBits), sizeof(processedBits))) return -2;
             if (!f.read(reinterpret_cast<char*>(&bitsInChunk), sizeof(bitsInChunk))) return -2;
             if (!f.check_crc32()) return -2;
-            return 0;
+            return setStage1State(e, static_cast<engine::Reg>(RSTATE), data) ? 0 : -2;
         };
-        int rr = read_ckpt(eng_load, ckpt_file);
-        if (rr < 0) rr = read_ckpt(eng_load, ckpt_file + ".old");
-        if (rr != 0) { delete eng_load; delete eng; std::cerr << "Stage 2: cannot load pm1 stage1 checkpoint.\n"; if (guiServer_) { std::ostringstream oss; oss << "Stage 2: cannot load pm1 stage1 checkpoint.\n"; guiServer_->appendLog(oss.str()); } return -2; }
-        mpz_t H; mpz_init(H); eng_load->get_mpz(H, static_cast<engine::Reg>(RSTATE)); delete eng_load;
-        eng->set_mpz(static_cast<engine::Reg>(RSTATE), H);
-        mpz_clear(H);
-        std::cout << "Precomputing H even powers..." << std::endl;
-        if (guiServer_) { std::ostringstream oss; oss << "Precomputing H even powers..."; guiServer_->appendLog(oss.str()); }
-        eng->copy(static_cast<engine::Reg>(REVEN + 0), static_cast<engine::Reg>(RSTATE));
-        eng->square_mul(static_cast<engine::Reg>(REVEN + 0));
-        int pct = -1;
-        for (unsigned long k = 1; k < nbEven; ++k) {
-            eng->copy(static_cast<engine::Reg>(REVEN + k), static_cast<engine::Reg>(REVEN + k - 1));
-            eng->set_multiplicand(static_cast<engine::Reg>(RTMP), static_cast<engine::Reg>(REVEN + 0));
-            eng->mul(static_cast<engine::Reg>(REVEN + k), static_cast<engine::Reg>(RTMP));
-            int newPct = int((k + 1) * 100 / nbEven);
-            if (newPct > pct) {
-                pct = newPct;
-                std::cout << "\rPrecomputing H powers: " << pct << "%" << std::flush;
-                if (guiServer_) { std::ostringstream oss; oss << "Precomputing H powers: " << pct << "%"; guiServer_->appendLog(oss.str()); }
-            }
-        }
-        for (unsigned long k = 0; k < nbEven; ++k) {
-            eng->set_multiplicand(static_cast<engine::Reg>(RTMP), static_cast<engine::Reg>(REVEN + k));
-            eng->copy(static_cast<engine::Reg>(REVEN + k), static_cast<engine::Reg>(RTMP));
+        int rr = read_ckpt(eng, ckpt_file);
+        if (rr < 0 && rr != -3) rr = read_ckpt(eng, ckpt_file + ".old");
+        if (rr == -3) {
+            delete eng;
+            std::ostringstream oss; oss << "Stage 2: " << ckpt_file << " is not a completed stage 1 to B1 = " << B1u << ", run stage 1 first.";
+            std::cerr << oss.str() << std::endl;
+            if (guiServer_) guiServer_->appendLog(oss.str());
+            return -2;
         }
-        std::cout << "\n";
+        if (rr != 0) { delete eng; std::cerr << "Stage 2: cannot load pm1 stage1 checkpoint.\n"; if (guiServer_) { std::ostringstream oss; oss << "Stage 2: cannot load pm1 stage1 checkpoint.\n"; guiServer_->appendLog(oss.str()); } return -2; }
         eng->set(static_cast<engine::Reg>(RACC_L), 1);
     }
+
     auto t0 = high_resolution_clock::now();
     auto start_clock = high_resolution_clock::now();
     auto lastBackup = start_clock;
     auto lastDisplay = start_clock;
-    mpz_class p_prev; mpz_nextprime(p_prev.get_mpz_t(), B1.get_mpz_t());
-    mpz_class p = p_prev;
-    uint64_t idx = 0;
     if (resumed_s2) {
-        mpz_set_ui(p.get_mpz_t(), static_cast<unsigned long>(resume_p_u64));
-        idx = resume_idx;
-        std::cout << "Resuming Stage 2 from checkpoint at prime " << p.get_ui() << " (idx=" << idx << ")\n";
-        if (guiServer_) { std::ostringstream oss; oss << "Resuming Stage 2 from checkpoint at prime " << p.get_ui() << " (idx=" << idx << ")"; guiServer_->appendLog(oss.str()); }
+        std::cout << "Resuming Stage 2 from checkpoint at prime " << resume_p << " (giant step " << resume_k << ")\n";
+        if (guiServer_) { std::ostringstream oss; oss << "Resuming Stage 2 from checkpoint at prime " << resume_p << " (giant step " << resume_k << ")"; guiServer_->appendLog(oss.str()); }
         t0 = high_resolution_clock::now() - duration_cast<high_resolution_clock::duration>(duration<double>(restored_time));
         start_clock = high_resolution_clock::now();
         lastBackup = start_clock;
         lastDisplay = start_clock;
-    } else {
-        mpz_class p0 = p_prev;
-        eng->pow(static_cast<engine::Reg>(RACC_R), static_cast<engine::Reg>(RSTATE), mpz_get_ui(p0.get_mpz_t()));
-        if (debug) {
-            mpz_t zh, zhq, zq; mpz_inits(zh, zhq, zq, nullptr);
-            eng->get_mpz(zh, static_cast<engine::Reg>(RSTATE));
-            eng->get_mpz(zhq, static_cast<engine::Reg>(RACC_R));
-            eng->get_mpz(zq, static_cast<engine::Reg>(RACC_L));
-            std::cout << "[DEBUG S2] H=" << mpz_class(zh) << std::endl;
-            std::cout << "[DEBUG S2] p0=" << p0.get_ui() << std::endl;
-            std::cout << "[DEBUG S2] H^p0=" << mpz_class(zhq) << std::endl;
-            std::cout << "[DEBUG S2] Q0=" << mpz_class(zq) << std::endl;
-            mpz_clears(zh, zhq, zq, nullptr);
-        }
     }
-    size_t totalPrimes = primeCountApprox(B1, B2);
+    const uint64_t kFirst = math::Stage2Pairing::giant(D, qFirst), kLast = math::Stage2Pairing::giant(D, qLast);
+    uint64_t kResume = 0;
+    uint64_t idx = 0;
     auto start = high_resolution_clock::now();
-    uint64_t primes_since_check = 0;
-    //uint64_t checkpasslevel = options.checklevel > 0 ? options.checklevel : std::max<uint64_t>(1, (uint64_t)std::sqrt((double)std::max<size_t>(1, totalPrimes)));
-    eng->copy(static_cast<engine::Reg>(RSAVE_Q), static_cast<engine::Reg>(RACC_L));
-    eng->copy(static_cast<engine::Reg>(RSAVE_HQ), static_cast<engine::Reg>(RACC_R));
-    mpz_class blockStartP = p;
     auto start_sys = std::chrono::system_clock::now();
 
-    for (;; ++idx) {
-        if (p > B2) break;
-        eng->copy(static_cast<engine::Reg>(RTMP), static_cast<engine::Reg>(RACC_R));
-        eng->sub(static_cast<engine::Reg>(RTMP), 1);
-        eng->set_multiplicand(static_cast<engine::Reg>(RPOW), static_cast<engine::Reg>(RTMP));
-        eng->mul(static_cast<engine::Reg>(RACC_L), static_cast<engine::Reg>(RPOW));
-        mpz_class nextp = p; mpz_nextprime(nextp.get_mpz_t(), nextp.get_mpz_t());
-        if (nextp > B2) { ++idx; break; }
-        mpz_class dgap = nextp - p;
-        uint64_t gap = mpz_get_ui(dgap.get_mpz_t());
-        uint64_t idxGap = (gap >> 1) - 1;
-        //eng->set_multiplicand(static_cast<engine::Reg>(RTMP), static_cast<engine::Reg>(REVEN + idxGap));
-        eng->mul(static_cast<engine::Reg>(RACC_R), static_cast<engine::Reg>(REVEN + idxGap));
-        p = nextp;
-        ++primes_since_check;
+    // Display, backup and interruption once the giant steps up to kDone are done: the primes
+    // below next_p are in the accumulator and kNext is the giant step to resume from.
+    // True if interrupted, the state is saved.
+    auto step_done = [&](uint64_t kDone, uint64_t next_p, uint64_t kNext, const char* unit, uint64_t count) -> bool {
+        ++idx;
         auto now = high_resolution_clock::now();
         if (duration_cast<seconds>(now - lastDisplay).count() >= 3) {
-            double done = static_cast<double>(idx + 1);
-            double percent = totalPrimes ? done / static_cast<double>(totalPrimes) * 100.0 : 0.0;
+            double done = static_cast<double>(kDone + 1 - kFirst), total = static_cast<double>(kLast + 1 - kFirst);
+            double percent = total > 0 ? std::min(done / total, 1.0) * 100.0 : 0.0;
             double elapsedSec = duration<double>(now - start).count();
-            double ips = done > 0 ? done / elapsedSec : 0.0;
-            double remaining = totalPrimes > done ? static_cast<double>(totalPrimes) - done : 0.0;
+            double ips = elapsedSec > 0 ? static_cast<double>(kDone + 1 - kResume) / elapsedSec : 0.0;
+            double remaining = total > done ? total - done : 0.0;
             double etaSec = ips > 0.0 ? remaining / ips : 0.0;
             int days = static_cast<int>(etaSec) / 86400;
             int hours = (static_cast<int>(etaSec) % 86400) / 3600;
             int minutes = (static_cast<int>(etaSec) % 3600) / 60;
             int seconds = static_cast<int>(etaSec) % 60;
-            std::cout << "Progress: " << std::fixed << std::setprecision(2) << percent << "% | prime: " << p.get_ui() << " | Iter: " << (idx + 1) << " | Elapsed: " << std::fixed << std::setprecision(2) << elapsedSec << "s | IPS: " << std::fixed << std::setprecision(2) << ips << " | ETA: " << days << "d " << hours << "h " << minutes << "m " << seconds << "s\r" << std::endl;
-            if (guiServer_) { std::ostringstream oss; oss << "Progress: " << std::fixed << std::setprecision(2) << percent << "% | prime: " << p.get_ui() << " | Iter: " << (idx + 1) << " | Elapsed: " << std::fixed << std::setprecision(2) << elapsedSec << "s | IPS: " << std::fixed << std::setprecision(2) << ips << " | ETA: " << days << "d " << hours << "h " << minutes << "m " << seconds << "s\r"; guiServer_->appendLog(oss.str()); 
-                              guiServer_->setProgress(done, totalPrimes, "");
+            std::cout << "Progress: " << std::fixed << std::setprecision(2) << percent << "% | prime: " << next_p << " | Giant: " << kDone << "/" << kLast << " | " << unit << ": " << count << " | Elapsed: " << std::fixed << std::setprecision(2) << elapsedSec << "s | ETA: " << days << "d " << hours << "h " << minutes << "m " << seconds << "s\r" << std::endl;
+            if (guiServer_) { std::ostringstream oss; oss << "Progress: " << std::fixed << std::setprecision(2) << percent << "% | prime: " << next_p << " | Giant: " << kDone << "/" << kLast << " | " << unit << ": " << count << " | Elapsed: " << std::fixed << std::setprecision(2) << elapsedSec << "s | ETA: " << days << "d " << hours << "h " << minutes << "m " << seconds << "s\r"; guiServer_->appendLog(oss.str()); 
+                              guiServer_->setProgress(std::min(done, total), total, "");
             }
             lastDisplay = now;
         }
         auto now0 = high_resolution_clock::now();
         if (now0 - lastBackup >= std::chrono::seconds(options.backup_interval)) {
             double et = duration<double>(now0 - t0).count();
-            std::cout << "\nBackup Stage 2 at prime " << p.get_ui() << " idx=" << idx << " start...\n";
-            save_ckpt_s2(eng, static_cast<uint64_t>(p.get_ui()), idx, et);
+            std::cout << "\nBackup Stage 2 at prime " << next_p << " giant=" << kNext << " start...\n";
+            save_ckpt_s2(eng, D, next_p, kNext, et);
             lastBackup = now0;
             std::cout << "Backup Stage 2 done.\n";
-            if (guiServer_) { std::ostringstream oss; oss << "Backup Stage 2 at prime " << p.get_ui() << " idx=" << idx; guiServer_->appendLog(oss.str()); }
+            if (guiServer_) { std::ostringstream oss; oss << "Backup Stage 2 at prime " << next_p << " giant=" << kNext; guiServer_->appendLog(oss.str()); }
         }
-        if (options.iterforce2 > 0 && (idx + 1) % options.iterforce2 == 0) { eng->copy(static_cast<engine::Reg>(RTMP), static_cast<engine::Reg>(RSTATE)); }
+        if (options.iterforce2 > 0 && idx % options.iterforce2 == 0) { eng->copy(static_cast<engine::Reg>(RTMP), static_cast<engine::Reg>(RSTATE)); }
         if (interrupted) {
             double et = duration<double>(high_resolution_clock::now() - t0).count();
-            save_ckpt_s2(eng, static_cast<uint64_t>(p.get_ui()), idx, et);
-            delete eng;
-            std::cout << "\nInterrupted by user, Stage 2 state saved at prime " << p.get_ui() << " idx=" << idx << std::endl;
-            if (guiServer_) { std::ostringstream oss; oss << "\nInterrupted by user, Stage 2 state saved at prime " << p.get_ui() << " idx=" << idx; guiServer_->appendLog(oss.str()); }
-            return 0;
+            save_ckpt_s2(eng, D, next_p, kNext, et);
+            ckptWriter.wait();
+            std::cout << "\nInterrupted by user, Stage 2 state saved at prime " << next_p << " giant=" << kNext << std::endl;
+            if (guiServer_) { std::ostringstream oss; oss << "\nInterrupted by user, Stage 2 state saved at prime " << next_p << " giant=" << kNext; guiServer_->appendLog(oss.str()); }
+            return true;
+        }
+        return false;
+    };
+
+    // Stops without a checkpoint: a factor was found elsewhere, this stage 2 is not needed
+    auto stop_cancelled = [&]() {
+        ckptWriter.wait();
+        delete eng;
+        std::remove(ckpt_file_s2.c_str());
+        std::remove((ckpt_file_s2 + ".old").c_str());
+        std::remove((ckpt_file_s2 + ".new").c_str());
+        std::cout << "\nStage 2 cancelled, a factor was found." << std::endl;
+        if (guiServer_) guiServer_->appendLog("Stage 2 cancelled, a factor was found.");
+        return 1;
+    };
+    auto is_cancelled = [&]() { return cancelled && cancelled(); };
+    if (is_cancelled()) return stop_cancelled();
+
+    if (polyS2) {
+        // f(x_k) for blocks of m + 1 consecutive giant steps, see core::PolyStage2
+        core::PolyStage2 poly(*eng, D, static_cast<engine::Reg>(RBABY));
+        std::cout << "Stage 2: polynomial evaluation, D = " << D << ", degree " << core::PolyStage2::degree(D) << ", " << regCount << " registers, blocks of "
+                  << poly.blockSize() << " giant steps up to " << kLast << std::endl;
+        if (guiServer_) { std::ostringstream oss; oss << "Stage 2: polynomial evaluation, D = " << D << ", blocks of " << poly.blockSize() << " giant steps"; guiServer_->appendLog(oss.str()); }
+        kResume = resumed_s2 ? resume_k : kFirst;
+        poly.init(static_cast<engine::Reg>(RSTATE), kResume);
+        if (is_cancelled()) return stop_cancelled();
+        if (debug) std::cout << "[DEBUG S2] polynomial of degree " << core::PolyStage2::degree(D) << " built, first giant step k=" << kResume << std::endl;
+        start = high_resolution_clock::now();
+        while (poly.nextGiant() <= kLast) {
+            poly.evaluateBlock(static_cast<engine::Reg>(RACC_L));
+            const uint64_t kNext = poly.nextGiant();
+            if (step_done(kNext - 1, kNext * D - D / 2, kNext, "Blocks", (kNext - kFirst) / poly.blockSize())) { delete eng; return 0; }
+            if (is_cancelled()) return stop_cancelled();
+        }
+    } else {
+        // Baby steps H^(j^2) for the odd j < D/2 prime to D: (j+2)^2 = j^2 + 4(j+1), the
+        // increment H^(4(j+1)) itself grows by H^8.
+        std::cout << "Stage 2: D = " << D << ", " << nBaby << " baby steps, giant steps up to " << kLast << std::endl;
+        if (guiServer_) { std::ostringstream oss; oss << "Stage 2: D = " << D << ", " << nBaby << " baby steps"; guiServer_->appendLog(oss.str()); }
+        {
+            eng->copy(static_cast<engine::Reg>(RCUR), static_cast<engine::Reg>(RSTATE));
+            eng->copy(static_cast<engine::Reg>(RINC), static_cast<engine::Reg>(RSTATE));
+            for (int i = 0; i < 3; ++i) eng->square_mul(static_cast<engine::Reg>(RINC));
+            eng->set_multiplicand(static_cast<engine::Reg>(RINC8), static_cast<engine::Reg>(RINC));
+            int pct = -1;
+            size_t b = 0;
+            for (uint64_t j = 1; b < nBaby; j += 2) {
+                if (j == babySteps[b]) eng->copy(static_cast<engine::Reg>(RBABY + b++), static_cast<engine::Reg>(RCUR));
+                if (b == nBaby) break;
+                eng->set_multiplicand(static_cast<engine::Reg>(RTMP), static_cast<engine::Reg>(RINC));
+                eng->mul(static_cast<engine::Reg>(RCUR), static_cast<engine::Reg>(RTMP));
+                eng->mul(static_cast<engine::Reg>(RINC), static_cast<engine::Reg>(RINC8));
+                int newPct = int(b * 100 / nBaby);
+                if (newPct > pct) {
+                    pct = newPct;
+                    std::cout << "\rPrecomputing baby steps: " << pct << "%" << std::flush;
+                    if (guiServer_) { std::ostringstream oss; oss << "Precomputing baby steps: " << pct << "%"; guiServer_->appendLog(oss.str()); }
+                    if (is_cancelled()) return stop_cancelled();
+                }
+            }
+            std::cout << "\rPrecomputing baby steps: 100%" << std::endl;
+        }
+        // S = H^(2D^2), as a multiplicand; T = H^(D^2) is left in RDIFF
+        eng->copy(static_cast<engine::Reg>(RTMP), static_cast<engine::Reg>(RSTATE));
+        eng->pow(static_cast<engine::Reg>(RDIFF), static_cast<engine::Reg>(RTMP), D * D);
+        eng->copy(static_cast<engine::Reg>(RSTEP), static_cast<engine::Reg>(RDIFF));
+        eng->square_mul(static_cast<engine::Reg>(RSTEP));
+        eng->set_multiplicand(static_cast<engine::Reg>(RSTEP), static_cast<engine::Reg>(RSTEP));
+
+        math::Stage2Pairing pairing(D, resumed_s2 ? resume_p : qFirst, qLast);
+        std::vector<uint32_t> pairs;
+        uint64_t k = 0;
+        bool more = pairing.next(k, pairs);
+        uint64_t kcur = resume_k;
+        if (!resumed_s2) {
+            // G = H^((kD)^2) = (H^(kD))^(kD), R = T^(2k+1)
+            kcur = more ? k : 0;
+            eng->pow(static_cast<engine::Reg>(RRATIO), static_cast<engine::Reg>(RDIFF), 2 * kcur + 1);
+            eng->copy(static_cast<engine::Reg>(RTMP), static_cast<engine::Reg>(RSTATE));
+            eng->pow(static_cast<engine::Reg>(RGIANT), static_cast<engine::Reg>(RTMP), kcur * D);
+            eng->copy(static_cast<engine::Reg>(RTMP), static_cast<engine::Reg>(RGIANT));
+            eng->pow(static_cast<engine::Reg>(RGIANT), static_cast<engine::Reg>(RTMP), kcur * D);
+            if (debug) std::cout << "[DEBUG S2] first giant step k=" << kcur << ", D=" << D << std::endl;
+        }
+        kResume = kcur;
+        start = high_resolution_clock::now();
+
+        while (more) {
+            for (; kcur < k; ++kcur) {
+                eng->set_multiplicand(static_cast<engine::Reg>(RTMP), static_cast<engine::Reg>(RRATIO));
+                eng->mul(static_cast<engine::Reg>(RGIANT), static_cast<engine::Reg>(RTMP));
+                eng->mul(static_cast<engine::Reg>(RRATIO), static_cast<engine::Reg>(RSTEP));
+            }
+            // one factor G_k - B_j for the primes kD - j and kD + j
+            for (const uint32_t b : pairs) {
+                eng->copy(static_cast<engine::Reg>(RDIFF), static_cast<engine::Reg>(RGIANT));
+                eng->sub_reg(static_cast<engine::Reg>(RDIFF), static_cast<engine::Reg>(RBABY + b));
+                eng->set_multiplicand(static_cast<engine::Reg>(RDIFF), static_cast<engine::Reg>(RDIFF));
+                eng->mul(static_cast<engine::Reg>(RACC_L), static_cast<engine::Reg>(RDIFF));
+            }
+            // k * D + D/2: first prime of the giant step k + 1
+            if (step_done(k, k * D + D / 2, kcur, "Pairs", pairing.pairs())) { delete eng; return 0; }
+            if (is_cancelled()) return stop_cancelled();
+            more = pairing.next(k, pairs);
+        }
+        if (pairing.primes() != 0) {
+            std::ostringstream oss;
+            oss << "Stage 2: " << pairing.primes() << " primes in " << pairing.pairs() << " products ("
+                << std::fixed << std::setprecision(1) << 100.0 * double(2 * (pairing.primes() - pairing.pairs())) / double(pairing.primes()) << "% paired)";
+            std::cout << "\n" << oss.str() << std::endl;
+            if (guiServer_) guiServer_->appendLog(oss.str());
         }
     }
     auto end_sys = std::chrono::system_clock::now();
@@ -974,37 +1239,40 @@ int App::runPM1Stage2Marin() {
     auto t1 = high_resolution_clock::now();
     double elapsed = duration<double>(t1 - t0).count();
     mpz_class Mp = (mpz_class(1) << options.exponent) - 1;
-    mpz_class X  = compute_X_with_dots(eng, static_cast<engine::Reg>(RACC_L), Mp);
+    mpz_class X  = compute_X(eng, static_cast<engine::Reg>(RACC_L), Mp);
+    if (partial) {
+        // the GCD is left to -s2merge, once the accumulators of all the ranges are known
+        const std::string partFile = "pm1_s2_m_" + std::to_string(pexp) + rangeSuffix + ".part";
+        auto& s = ckptWriter.next();
+        s.put(io::ckpt::Exponent, pexp); s.put(TagPartB1, B1u); s.put(TagPartFirst, qFirst); s.put(TagPartLast, qLast);
+        s.put(io::ckpt::Elapsed, elapsed);
+        s.putMpz(TagPartAcc, X);
+        ckptWriter.submit(partFile, false);
+        const bool written = ckptWriter.wait();
+        std::cout << "\nElapsed time (stage 2) = " << std::fixed << std::setprecision(2) << elapsed << " s." << std::endl;
+        std::ostringstream oss;
+        if (written) oss << "Stage 2 accumulator of the primes of [" << qFirst << ", " << qLast << "] written to " << partFile << ", merge the ranges with -s2merge";
+        else oss << "Stage 2: cannot write " << partFile;
+        (written ? std::cout : std::cerr) << oss.str() << std::endl;
+        if (guiServer_) guiServer_->appendLog(oss.str());
+        if (written) {
+            std::remove(ckpt_file_s2.c_str());
+            std::remove((ckpt_file_s2 + ".old").c_str());
+            std::remove((ckpt_file_s2 + ".new").c_str());
+        }
+        delete eng;
+        return written ? 1 : -2;
+    }
     if (options.resume) { writeEcmResumeLine("resume_p" + std::to_string(options.exponent) + "_B1_" + std::to_string(options.B1) +  "_B2_" + std::to_string(options.B2) + ".save", options.B1, options.exponent, X); convertEcmResumeToPrime95("resume_p" + std::to_string(options.exponent) + "_B1_" + std::to_string(options.B1) +  "_B2_" + std::to_string(options.B2) + ".save", "resume_p" + std::to_string(options.exponent) + "_B1_" + std::to_string(options.B1) +  "_B2_" + std::to_string(options.B2) + ".p95", ds, de); }
     mpz_class g = gcd_with_dots(X, Mp);
-    bool found = g != 1 && g != Mp;
     std::cout << "\nElapsed time (stage 2) = " << std::fixed << std::setprecision(2) << elapsed << " s." << std::endl;
     if (guiServer_) { std::ostringstream oss; oss << "Elapsed time (stage 2) = " << std::fixed << std::setprecision(2) << elapsed << " s."; guiServer_->appendLog(oss.str()); }
-    std::string filename = "stage2_result_B2_" + B2.get_str() + "_p_" + std::to_string(options.exponent) + ".txt";
-    if (found) {
-        char* s = mpz_get_str(nullptr, 10, g.get_mpz_t());
-        writeStageResult(filename, "B2=" + B2.get_str() + "  factor=" + std::string(s));
-        std::cout << "\n>>>  Factor P-1 (stage 2) found : " << s << '\n';
-        if (guiServer_) { std::ostringstream oss; oss << "\n>>>  Factor P-1 (stage 2) found : " << s << '\n'; guiServer_->appendLog(oss.str()); }
-        options.knownFactors.push_back(std::string(s));
-        std::free(s);
-    } else {
-        writeStageResult(filename, "No factor P-1 up to B2=" + B2.get_str());
-        std::cout << "\nNo factor P-1 (stage 2) until B2 = " << B2 << '\n';
-        if (guiServer_) { std::ostringstream oss; oss << "\nNo factor P-1 (stage 2) until B2 = " << B2 << '\n'; guiServer_->appendLog(oss.str()); }
-    }
-    
+    const bool found = reportPM1Stage2(g);
+
+    ckptWriter.wait();
     std::remove(ckpt_file_s2.c_str());
     std::remove((ckpt_file_s2 + ".old").c_str());
     std::remove((ckpt_file_s2 + ".new").c_str());
-    
-    
-    std::string json = io::JsonBuilder::generate(options, static_cast<int>(context.getTransformSize()), false, "", "");
-    std::cout << "Manual submission JSON:\n" << json << "\n";
-    io::WorktodoManager wm(options);
-   // wm.saveIndividualJson(options.exponent, options.mode, json);
-    wm.saveIndividualJson(options.exponent, std::string(options.mode) + "_stage2", json);
-    wm.appendToResultsTxt(json);
    /* if (hasWorktodoEntry_) {
         if (worktodoParser_->removeFirstProcessed()) {
             std::cout << "Entry removed from " << options.worktodo_path << " and saved to worktodo_save.txt\n";
@@ -1023,6 +1291,84 @@ int App::runPM1Stage2Marin() {
     return found ? 0 : 1;
 }
 
+bool App::reportPM1Stage2(const mpz_class& g) {
+    const mpz_class Mp = (mpz_class(1) << options.exponent) - 1;
+    const std::string B2 = std::to_string(options.B2);
+    const bool found = g != 1 && g != Mp;
+    std::string filename = "stage2_result_B2_" + B2 + "_p_" + std::to_string(options.exponent) + ".txt";
+    if (found) {
+        char* s = mpz_get_str(nullptr, 10, g.get_mpz_t());
+        writeStageResult(filename, "B2=" + B2 + "  factor=" + std::string(s));
+        std::cout << "\n>>>  Factor P-1 (stage 2) found : " << s << '\n';
+        if (guiServer_) { std::ostringstream oss; oss << "\n>>>  Factor P-1 (stage 2) found : " << s << '\n'; guiServer_->appendLog(oss.str()); }
+        options.knownFactors.push_back(std::string(s));
+        std::free(s);
+    } else {
+        writeStageResult(filename, "No factor P-1 up to B2=" + B2);
+        std::cout << "\nNo factor P-1 (stage 2) until B2 = " << B2 << '\n';
+        if (guiServer_) { std::ostringstream oss; oss << "\nNo factor P-1 (stage 2) until B2 = " << B2 << '\n'; guiServer_->appendLog(oss.str()); }
+    }
+
+    std::string json = io::JsonBuilder::generate(options, static_cast<int>(context.getTransformSize()), false, "", "");
+    std::cout << "Manual submission JSON:\n" << json << "\n";
+    io::WorktodoManager wm(options);
+    wm.saveIndividualJson(options.exponent, std::string(options.mode) + "_stage2", json);
+    wm.appendToResultsTxt(json);
+    return found;
+}
+
+int App::runPM1Stage2Merge() {
+    const uint32_t pexp = static_cast<uint32_t>(options.exponent);
+    const mpz_class Mp = (mpz_class(1) << options.exponent) - 1;
+    struct Part { uint64_t first, last; std::string file; };
+    std::vector<Part> parts;
+    uint64_t B1u = 0;
+    double elapsed = 0.0;
+    mpz_class X = 1;
+    for (const std::string& file : options.s2merge) {
+        io::CheckpointReader f;
+        uint32_t rp = 0; uint64_t b1 = 0; Part part{0, 0, file}; mpz_class acc; double et = 0.0;
+        if (!f.open(file) || !f.get(io::ckpt::Exponent, rp) || !f.get(TagPartB1, b1) || !f.get(TagPartFirst, part.first)
+            || !f.get(TagPartLast, part.last) || !f.getMpz(TagPartAcc, acc)) {
+            std::cerr << "Stage 2 merge: " << file << " is not a partial stage 2 accumulator.\n";
+            return -2;
+        }
+        if (rp != pexp || (B1u != 0 && b1 != B1u)) {
+            std::cerr << "Stage 2 merge: " << file << " is for p=" << rp << ", B1=" << b1 << ", the others for p=" << pexp << ", B1=" << B1u << ".\n";
+            return -2;
+        }
+        f.get(io::ckpt::Elapsed, et);
+        B1u = b1;
+        elapsed += et;
+        parts.push_back(part);
+        X *= acc;
+        X %= Mp;
+        std::cout << "Stage 2 merge: " << file << ", primes of [" << part.first << ", " << part.last << "]" << std::endl;
+    }
+    if (parts.empty()) { std::cerr << "Stage 2 merge: no file.\n"; return -1; }
+
+    // The ranges may overlap, the stage 2 is done up to the first prime not covered
+    std::sort(parts.begin(), parts.end(), [](const Part& a, const Part& b) { return a.first < b.first; });
+    uint64_t covered = B1u;
+    for (const Part& part : parts) {
+        if (part.first > covered + 1) {
+            std::cout << "Stage 2 merge: the primes of (" << covered << ", " << part.first << ") are missing, the result is up to B2=" << covered << std::endl;
+            if (guiServer_) { std::ostringstream oss; oss << "Stage 2 merge: the primes of (" << covered << ", " << part.first << ") are missing"; guiServer_->appendLog(oss.str()); }
+            break;
+        }
+        covered = std::max(covered, part.last);
+    }
+    if (covered <= B1u) { std::cerr << "Stage 2 merge: no range starts at B1 + 1 = " << B1u + 1 << ".\n"; return -1; }
+    options.B1 = B1u;
+    options.B2 = covered;
+    std::cout << "Stage 2 merge: " << parts.size() << " ranges, B1 = " << B1u << ", B2 = " << covered
+              << ", " << std::fixed << std::setprecision(2) << elapsed << " s of stage 2" << std::endl;
+    if (guiServer_) { std::ostringstream oss; oss << "Stage 2 merge: " << parts.size() << " ranges, B1 = " << B1u << ", B2 = " << covered; guiServer_->appendLog(oss.str()); }
+
+    const mpz_class g = gcd_with_dots(X, Mp);
+    return reportPM1Stage2(g) ? 0 : 1;
+}
+
 
 
 /* ===== n^K Stage-2 (Topics in advanced scientific computation. by: Crandall, Richard E) ===== */
@@ -1041,6 +1387,8 @@ int App::runPM1Stage2MarinNKVersion() {
     engine* eng_s1 = engine::create_gpu(pexp, 11, (size_t)options.device_id, options.debug);
     std::ostringstream ck; ck << "pm1_m_" << pexp << ".ckpt";
     auto read_ckpt_s1 = [&](engine* e, const std::string& file)->int{
+        const int rc = readStage1Engine(e, file, pexp);
+        if (rc <= 0) return rc;
         File f(file);
         if (!f.exists()) return -1;
         int version = 0; if (!f.read(reinterpret_cast<char*>(&version), sizeof(version))) return -2;
@@ -1219,12 +1567,27 @@ int App::runPM1Marin() {
     const size_t RSTATE=0, RACC_L=1, RACC_R=2, RCHK=3, RPOW=4, RTMP=5, RSTART=6, RSAVE_S=7, RSAVE_L=8, RSAVE_R=9, RBASE=10;
     std::ostringstream ck; ck << "pm1_m_" << p << ".ckpt";
     const std::string ckpt_file = ck.str();
+    // The state holds the prime powers up to passFrom, the current pass raises it to those up
+    // to passB1. A larger B1 than the one of the checkpoint is a new pass from the old bound,
+    // whose first chunk brings the extra powers of 2 (passTwo).
+    uint64_t passB1 = B1, passFrom = 0;
+    bool passTwo = false;
+    io::CheckpointWriter ckptWriter;
     auto save_ckpt = [&](uint32_t i, double et, uint64_t chk, uint64_t blks, uint64_t bib, uint64_t cbl, uint8_t inlot, const mpz_class& ceacc, const mpz_class& cwbits, uint64_t chunkIdx, uint64_t startP, uint8_t first, uint64_t processedBits, uint64_t bitsInChunk){
-        const std::string oldf = ckpt_file + ".old", newf = ckpt_file + ".new";
-        { File f(newf, "wb"); int version = 3; if (!f.write(reinterpret_cast<const char*>(&version), sizeof(version))) return; if (!f.write(reinterpret_cast<const char*>(&p), sizeof(p))) return; if (!f.write(reinterpret_cast<const char*>(&i), sizeof(i))) return; if (!f.write(reinterpret_cast<const char*>(&et), sizeof(et))) return; const size_t cksz = eng->get_checkpoint_size(); std::vector<char> data(cksz); if (!eng->get_checkpoint(data)) return; if (!f.write(data.data(), cksz)) return; if (!f.write(reinterpret_cast<const char*>(&chk), sizeof(chk))) return; if (!f.write(reinterpret_cast<const char*>(&blks), sizeof(blks))) return; if (!f.write(reinterpret_cast<const char*>(&bib), sizeof(bib))) return; if (!f.write(reinterpret_cast<const char*>(&cbl), sizeof(cbl))) return; if (!f.write(reinterpret_cast<const char*>(&inlot), sizeof(inlot))) return; char* eacc_hex_c = mpz_get_str(nullptr, 16, ceacc.get_mpz_t()); uint32_t eacc_len = eacc_hex_c ? (uint32_t)std::strlen(eacc_hex_c) : 0; if (!f.write(reinterpret_cast<const char*>(&eacc_len), sizeof(eacc_len))) { if (eacc_hex_c) std::free(eacc_hex_c); return; } if (eacc_len && !f.write(eacc_hex_c, eacc_len)) { std::free(eacc_hex_c); return; } if (eacc_hex_c) std::free(eacc_hex_c); char* wbits_hex_c = mpz_get_str(nullptr, 16, cwbits.get_mpz_t()); uint32_t wbits_len = wbits_hex_c ? (uint32_t)std::strlen(wbits_hex_c) : 0; if (!f.write(reinterpret_cast<const char*>(&wbits_len), sizeof(wbits_len))) { if (wbits_hex_c) std::free(wbits_hex_c); return; } if (wbits_len && !f.write(wbits_hex_c, wbits_len)) { std::free(wbits_hex_c); return; } if (wbits_hex_c) std::free(wbits_hex_c); if (!f.write(reinterpret_cast<const char*>(&chunkIdx), sizeof(chunkIdx))) return; if (!f.write(reinterpret_cast<const char*>(&startP), sizeof(startP))) return; if (!f.write(reinterpret_cast<const char*>(&first), sizeof(first))) return; if (!f.write(reinterpret_cast<const char*>(&processedBits), sizeof(processedBits))) return; if (!f.write(reinterpret_cast<const char*>(&bitsInChunk), sizeof(bitsInChunk))) return; f.write_crc32(); }
-        std::error_code ec; fs::remove(oldf, ec); fs::rename(ckpt_file, oldf, ec); fs::rename(ckpt_file + ".new", ckpt_file, ec); fs::remove(oldf, ec);
+        auto& s = ckptWriter.next();
+        s.put(io::ckpt::Exponent, p); s.put(io::ckpt::Iteration, i); s.put(io::ckpt::Elapsed, et);
+        auto& data = s.scratch();
+        data.resize(eng->get_checkpoint_size());
+        if (!eng->get_checkpoint(data)) return;
+        s.put(io::ckpt::EngineData, data.data(), data.size());
+        s.put(TagCheckPass, chk); s.put(TagBlocks, blks); s.put(TagBitsInBlock, bib); s.put(TagBlockLen, cbl); s.put(TagInLot, inlot);
+        s.putMpz(TagExpAcc, ceacc); s.putMpz(TagWindowBits, cwbits);
+        s.put(TagChunkIndex, chunkIdx); s.put(TagChunkStart, startP); s.put(TagFirstChunk, first);
+        s.put(TagProcessed, processedBits); s.put(TagChunkBits, bitsInChunk);
+        s.put(TagPassB1, passB1); s.put(TagPassFrom, passFrom); s.put(TagPassTwo, uint8_t(passTwo ? 1 : 0));
+        ckptWriter.submit(ckpt_file, false);
     };
-    auto read_ckpt = [&](const std::string& file, uint32_t& ri, double& et, uint64_t& chk, uint64_t& blks, uint64_t& bib, uint64_t& cbl, uint8_t& inlot, mpz_class& ceacc, mpz_class& cwbits, uint64_t& chunkIdx, uint64_t& startP, uint8_t& first, uint64_t& processedBits, uint64_t& bitsInChunk)->int{
+    auto read_legacy_ckpt = [&](const std::string& file, uint32_t& ri, double& et, uint64_t& chk, uint64_t& blks, uint64_t& bib, uint64_t& cbl, uint8_t& inlot, mpz_class& ceacc, mpz_class& cwbits, uint64_t& chunkIdx, uint64_t& startP, uint8_t& first, uint64_t& processedBits, uint64_t& bitsInChunk)->int{
         File f(file);
         if (!f.exists()) return -1;
         int version = 0; if (!f.read(reinterpret_cast<char*>(&version), sizeof(version))) return -2;
@@ -1258,6 +1621,25 @@ int App::runPM1Marin() {
         if (!f.check_crc32()) return -2;
         return 0;
     };
+    auto read_ckpt = [&](const std::string& file, uint32_t& ri, double& et, uint64_t& chk, uint64_t& blks, uint64_t& bib, uint64_t& cbl, uint8_t& inlot, mpz_class& ceacc, mpz_class& cwbits, uint64_t& chunkIdx, uint64_t& startP, uint8_t& first, uint64_t& processedBits, uint64_t& bitsInChunk)->int{
+        io::CheckpointReader f;
+        if (!f.open(file)) return read_legacy_ckpt(file, ri, et, chk, blks, bib, cbl, inlot, ceacc, cwbits, chunkIdx, startP, first, processedBits, bitsInChunk);
+        uint32_t rp = 0; std::vector<char> data;
+        if (!f.get(io::ckpt::Exponent, rp) || rp != p) return -2;
+        if (!f.get(io::ckpt::Iteration, ri) || !f.get(io::ckpt::Elapsed, et)) return -2;
+        if (!f.getBytes(io::ckpt::EngineData, data) || !eng->set_checkpoint(data)) return -2;
+        if (!f.get(TagCheckPass, chk) || !f.get(TagBlocks, blks) || !f.get(TagBitsInBlock, bib) || !f.get(TagBlockLen, cbl) || !f.get(TagInLot, inlot)) return -2;
+        if (!f.getMpz(TagExpAcc, ceacc) || !f.getMpz(TagWindowBits, cwbits)) return -2;
+        if (!f.get(TagChunkIndex, chunkIdx) || !f.get(TagChunkStart, startP) || !f.get(TagFirstChunk, first)) return -2;
+        if (!f.get(TagProcessed, processedBits) || !f.get(TagChunkBits, bitsInChunk)) return -2;
+        // older checkpoints have no bound, they are taken at the requested B1
+        uint64_t ckB1 = 0, ckFrom = 0; uint8_t ckTwo = 0;
+        if (f.get(TagPassB1, ckB1) && ckB1 != 0) {
+            f.get(TagPassFrom, ckFrom); f.get(TagPassTwo, ckTwo);
+            passB1 = ckB1; passFrom = ckFrom; passTwo = (ckTwo != 0);
+        }
+        return 0;
+    };
     timer.start();
     timer2.start();
     auto start_clock = std::chrono::high_resolution_clock::now();
@@ -1283,9 +1665,47 @@ int App::runPM1Marin() {
     bool restored = false;
     int rr = read_ckpt(ckpt_file, resumeI_ck, restored_time, gl_checkpass_ck, gl_blocks_since_check_ck, gl_bits_in_block_ck, gl_current_block_len_ck, in_lot_ck, eacc_ck, wbits_ck, chunkIndex, startPrime, firstChunk_ck, processed_total_bits, bits_in_chunk_ck);
     if (rr < 0) rr = read_ckpt(ckpt_file + ".old", resumeI_ck, restored_time, gl_checkpass_ck, gl_blocks_since_check_ck, gl_bits_in_block_ck, gl_current_block_len_ck, in_lot_ck, eacc_ck, wbits_ck, chunkIndex, startPrime, firstChunk_ck, processed_total_bits, bits_in_chunk_ck);
-    if (rr == 0) { restored = true; firstChunk = (firstChunk_ck != 0); }
+    if (rr == 0) {
+        restored = true; firstChunk = (firstChunk_ck != 0);
+        if (passB1 > B1) {
+            std::cout << "The checkpoint is at B1=" << passB1 << ", above the requested bound: stage 1 goes on up to B1=" << passB1 << std::endl;
+            B1 = passB1;
+            options.B1 = B1;
+        } else if (passB1 < B1) {
+            std::cout << "The checkpoint is at B1=" << passB1 << ": stage 1 is extended up to B1=" << B1 << std::endl;
+        }
+    }
     auto start_sys = std::chrono::system_clock::now();
-    while (true) {
+    // Chunked E: the next chunks are built on the host while the device works on this one
+    std::unique_ptr<core::algo::EChunkPipeline> eChunks;
+    auto next_chunk = [&](uint64_t& nextStart) -> mpz_class {
+        if (!eChunks) {
+            std::cout << "Building E-chunks from prime " << startPrime << " ahead of the exponentiation" << std::endl;
+            eChunks = std::make_unique<core::algo::EChunkPipeline>(passB1, startPrime, MAX_E_BITS, firstChunk || passTwo, passFrom);
+        }
+        core::algo::EChunkPipeline::Chunk c;
+        if (!eChunks->pop(c)) { nextStart = 0; return mpz_class(1); }
+        nextStart = c.nextStart;
+        return std::move(c.E);
+    };
+    // Next pass: the state is complete up to passB1, exponentiate by the increment up to B1
+    auto extend_pass = [&]() {
+        passFrom = passB1; passB1 = B1; passTwo = true;
+        firstChunk = false;
+        startPrime = 3;
+        eChunks.reset();
+        estChunks = chunkIndex + std::max<uint64_t>(1, (uint64_t)std::ceil(1.4426950408889634 * (double)(B1 - passFrom) / (double)MAX_E_BITS));
+        std::cout << "Extending stage 1 from B1=" << passFrom << " to B1=" << B1 << std::endl;
+        if (guiServer_) { std::ostringstream oss; oss << "Extending stage 1 from B1=" << passFrom << " to B1=" << B1; guiServer_->appendLog(oss.str()); }
+    };
+    // A completed checkpoint (saved at iteration 0) is either the result or the start of a new pass
+    bool stage1Done = false;
+    if (restored && resumeI_ck == 0 && bits_in_chunk_ck == 0) {
+        restored = false;
+        if (passB1 < B1) { chunkIndex += 1; extend_pass(); }
+        else stage1Done = true;
+    }
+    while (!stage1Done) {
         bool errordone = false;
         bool useFast3Candidate = firstChunk;
         uint64_t nextStart = 0;
@@ -1294,10 +1714,10 @@ int App::runPM1Marin() {
             uint64_t twoe = 2ULL * (uint64_t)options.exponent;
             uint64_t extra = 0; { uint64_t t = twoe; while (t) { extra++; t >>= 1; } if (extra == 0) extra = 1; }
             uint64_t estBits = (uint64_t)std::ceil(L_est_bits) + extra + 8;
-            if (estBits <= MAX_E_BITS) { Echunk = buildE(B1); nextStart = 0; }
-            else { Echunk = buildE2(B1, startPrime, MAX_E_BITS, nextStart, firstChunk); }
+            if (estBits <= MAX_E_BITS) { Echunk = buildE(passB1); nextStart = 0; }
+            else { Echunk = next_chunk(nextStart); }
         } else {
-            Echunk = buildE2(B1, startPrime, MAX_E_BITS, nextStart, firstChunk);
+            Echunk = next_chunk(nextStart);
         }
         if (firstChunk) Echunk *= mpz_class(2) * mpz_class(static_cast<unsigned long>(options.exponent));
         bool useFast3 = useFast3Candidate && (nextStart == 0);
@@ -1355,6 +1775,7 @@ int App::runPM1Marin() {
                 std::cout << "\nInterrupted by user, state saved at iteration " << i << std::endl;
                 if (guiServer_) { std::ostringstream oss; oss << "\nInterrupted signal received\n "; guiServer_->appendLog(oss.str()); }
                 save_ckpt((uint32_t)lastIter, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_clock).count() + restored_time, gl_checkpass, blocks_since_check, bits_in_block, current_block_len, in_lot ? 1 : 0, eacc, wbits, chunkIndex, startPrime, firstChunk ? 1 : 0, processed_total_bits + (bits - i), (uint64_t)bits);
+                ckptWriter.wait();
                 delete eng;
                 return 0;
             }
@@ -1517,9 +1938,11 @@ int App::runPM1Marin() {
         processed_total_bits += bits;
         restored = false;
         firstChunk = false;
-        if (nextStart == 0) break;
-        startPrime = nextStart | 1ULL;
+        passTwo = false;
+        if (nextStart == 0 && passB1 >= B1) break;
         chunkIndex += 1;
+        if (nextStart != 0) startPrime = nextStart | 1ULL;
+        else extend_pass();
     }
     const double elapsed_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_clock).count() + restored_time;
     std::string res64_done;
@@ -1543,7 +1966,7 @@ int App::runPM1Marin() {
     if (guiServer_) { std::ostringstream oss; oss << "Elapsed time = " << std::fixed << std::setprecision(2) << elapsed_time << " s." << std::endl; guiServer_->appendLog(oss.str()); }
     //engine::digit d(eng, RSTATE);
     mpz_class Mp = (mpz_class(1) << options.exponent) - 1;
-    mpz_class X  = compute_X_with_dots(eng, static_cast<engine::Reg>(RSTATE), Mp);
+    mpz_class X  = compute_X(eng, static_cast<engine::Reg>(RSTATE), Mp);
     auto end_sys = std::chrono::system_clock::now();
     auto fmt = [](const std::chrono::system_clock::time_point& tp){
         using namespace std::chrono;
@@ -1565,86 +1988,99 @@ int App::runPM1Marin() {
     std::string ds = fmt(start_sys);
     std::string de = fmt(end_sys);
     if (options.resume) { writeEcmResumeLine("resume_p" + std::to_string(options.exponent) + "_B1_" + std::to_string(options.B1) + ".save", options.B1, options.exponent, X); convertEcmResumeToPrime95("resume_p" + std::to_string(options.exponent) + "_B1_" + std::to_string(options.B1) + ".save", "resume_p" + std::to_string(options.exponent) + "_B1_" + std::to_string(options.B1) + ".p95", ds, de); }
+    // The stage-1 GCD runs on the host from a copy of X - 1 while stage 2 starts on the
+    // device, stage 2 reads H again from the checkpoint. Its result is reported as soon as
+    // it is known, and a factor stops stage 2.
     X -= 1;
-    mpz_class g = gcd_with_dots(X, Mp);
-    bool factorFound = (g != 1) && (g != Mp);
-    std::string filename = "stage1_result_B1_" + std::to_string(B1) + "_p_" + std::to_string(options.exponent) + ".txt";
-    if (factorFound) {
-        char* fstr = mpz_get_str(nullptr, 10, g.get_mpz_t());
-        writeStageResult(filename, "B1=" + std::to_string(B1) + "  factor=" + std::string(fstr));
-        std::cout << "\nP-1 factor stage 1 found: " << fstr << std::endl;
-        if (guiServer_) { std::ostringstream oss; oss << "\nP-1 factor stage 1 found: " << fstr << std::endl; guiServer_->appendLog(oss.str()); }
-        options.knownFactors.push_back(std::string(fstr));
-        std::free(fstr);
-        std::cout << "\n";
-    } else {
-        writeStageResult(filename, "No factor up to B1=" + std::to_string(B1));
-        std::cout << "\nNo P-1 (stage 1) factor up to B1=" << B1 << "\n" << std::endl;
-        if (guiServer_) { std::ostringstream oss; oss << "\nNo P-1 (stage 1) factor up to B1=" << B1 << "\n" << std::endl; guiServer_->appendLog(oss.str()); }
+    std::future<mpz_class> stage1Gcd = std::async(std::launch::async, [X, Mp] {
+        mpz_class g;
+        mpz_gcd(g.get_mpz_t(), X.get_mpz_t(), Mp.get_mpz_t());
+        return g;
+    });
+    bool factorFound = false, stage1Reported = false;
+    const std::vector<std::string> knownBeforeStage2 = options.knownFactors;
+    auto report_stage1 = [&](const mpz_class& g) {
+        factorFound = (g != 1) && (g != Mp);
+        // stage 2 may have added its own factor meanwhile
+        io::CliOptions stage1Options = options;
+        stage1Options.knownFactors = knownBeforeStage2;
+        std::string filename = "stage1_result_B1_" + std::to_string(B1) + "_p_" + std::to_string(options.exponent) + ".txt";
+        if (factorFound) {
+            char* fstr = mpz_get_str(nullptr, 10, g.get_mpz_t());
+            writeStageResult(filename, "B1=" + std::to_string(B1) + "  factor=" + std::string(fstr));
+            std::cout << "\nP-1 factor stage 1 found: " << fstr << std::endl;
+            if (guiServer_) { std::ostringstream oss; oss << "\nP-1 factor stage 1 found: " << fstr << std::endl; guiServer_->appendLog(oss.str()); }
+            options.knownFactors.push_back(std::string(fstr));
+            stage1Options.knownFactors.push_back(std::string(fstr));
+            std::free(fstr);
+            std::cout << "\n";
+        } else {
+            writeStageResult(filename, "No factor up to B1=" + std::to_string(B1));
+            std::cout << "\nNo P-1 (stage 1) factor up to B1=" << B1 << "\n" << std::endl;
+            if (guiServer_) { std::ostringstream oss; oss << "\nNo P-1 (stage 1) factor up to B1=" << B1 << "\n" << std::endl; guiServer_->appendLog(oss.str()); }
+        }
+        std::string json = io::JsonBuilder::generate(stage1Options, static_cast<int>(context.getTransformSize()), false, "", "");
+        std::cout << "Manual submission JSON:\n" << json << "\n";
+        io::WorktodoManager wm(stage1Options);
+        wm.saveIndividualJson(options.exponent, std::string(options.mode) + "_stage1", json);
+        wm.appendToResultsTxt(json);
+        stage1Reported = true;
+    };
+    // Polled by stage 2: reports the GCD once it is done, true if it found a factor
+    auto stage1_factor = [&]() -> bool {
+        if (!stage1Reported && stage1Gcd.wait_for(std::chrono::seconds(0)) == std::future_status::ready) report_stage1(stage1Gcd.get());
+        return factorFound;
+    };
+    auto finish_stage1 = [&]() {
+        if (stage1Reported) return;
+        if (stage1Gcd.wait_for(std::chrono::seconds(0)) != std::future_status::ready) std::cout << "Waiting for the stage 1 GCD..." << std::endl;
+        report_stage1(stage1Gcd.get());
+    };
+    if (options.B2 == 0) finish_stage1();
+
+    // Stage 2 starts from the completed state. With -s1keep it is kept after the run, a later
+    // run with a larger B1 extends it.
+    if (options.B2 > 0 || (options.nmax > 0 && options.K > 0) || options.s1keep) {
+        const double elapsed_time_ck =
+            std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_clock).count()
+            + restored_time;
+
+        save_ckpt(
+            0,                 // i
+            elapsed_time_ck,   // et
+            0,                 // chk
+            0,                 // blks
+            0,                 // bib
+            0,                 // cbl
+            0,                 // inlot
+            mpz_class(0),      // ceacc
+            mpz_class(0),      // cwbits
+            chunkIndex,        // chunkIdx
+            startPrime,        // startP
+            firstChunk ? 1 : 0,// first
+            processed_total_bits, // processedBits
+            0                  // bitsInChunk
+        );
+        ckptWriter.wait();
     }
-    std::string json = io::JsonBuilder::generate(options, static_cast<int>(context.getTransformSize()), false, "", "");
-    std::cout << "Manual submission JSON:\n" << json << "\n";
-    io::WorktodoManager wm(options);
-    wm.saveIndividualJson(options.exponent, std::string(options.mode) + "_stage1", json);
-    wm.appendToResultsTxt(json);
+    // Stage 2 reads H again from the checkpoint: the device memory of the stage-1 engine
+    // goes to the stage-2 tables
+    delete eng;
+    eng = nullptr;
 
     if(options.B2 > 0){
-        {
-            const double elapsed_time_ck =
-                std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_clock).count()
-                + restored_time;
-
-            save_ckpt(
-                0,                 // i
-                elapsed_time_ck,   // et
-                0,                 // chk
-                0,                 // blks
-                0,                 // bib
-                0,                 // cbl
-                0,                 // inlot
-                mpz_class(0),      // ceacc
-                mpz_class(0),      // cwbits
-                chunkIndex,        // chunkIdx
-                startPrime,        // startP
-                firstChunk ? 1 : 0,// first
-                processed_total_bits, // processedBits
-                0                  // bitsInChunk
-            );
-        }
         //options.B2 = 214439;
-        factorFound = runPM1Stage2Marin() || factorFound;
+        const int rc2 = runPM1Stage2Marin(stage1_factor);
+        finish_stage1();
+        factorFound = rc2 || factorFound;
     }
    if(options.nmax > 0 && options.K > 0){
-        {
-            std::cout << "P-1 STAGE 2 IN **** n^K variant  n=" << options.nmax << " K=" << options.K << "******\n";
-    
-            const double elapsed_time_ck =
-                std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_clock).count()
-                + restored_time;
-
-            save_ckpt(
-                0,                 // i
-                elapsed_time_ck,   // et
-                0,                 // chk
-                0,                 // blks
-                0,                 // bib
-                0,                 // cbl
-                0,                 // inlot
-                mpz_class(0),      // ceacc
-                mpz_class(0),      // cwbits
-                chunkIndex,        // chunkIdx
-                startPrime,        // startP
-                firstChunk ? 1 : 0,// first
-                processed_total_bits, // processedBits
-                0                  // bitsInChunk
-            );
-        }
+        std::cout << "P-1 STAGE 2 IN **** n^K variant  n=" << options.nmax << " K=" << options.K << "******\n";
         //options.B2 = 214439;
         factorFound = runPM1Stage2MarinNKVersion() || factorFound;
     }
     //else{
-    delete_checkpoints(options.exponent, options.wagstaff, true, false);
-    delete eng;
+    if (!options.s1keep) delete_checkpoints(options.exponent, options.wagstaff, true, false);
     if (hasWorktodoEntry_) {
         if (worktodoParser_->removeFirstProcessed()) {
             std::cout << "Entry removed from " << options.worktodo_path << " and saved to worktodo_save.txt\n";
@@ -11,6 +11,7 @@
 #include "io/WorktodoParser.hpp"
 #include "io/WorktodoManager.hpp"
 #include "io/CurlClient.hpp"
+#include "io/CheckpointWriter.hpp"
 #include "marin/engine.h"
 #include "marin/file.h"
 #include "ui/WebGuiServer.hpp"
@@ -90,7 +91,7 @@ using core::algo::hex_to_le_bytes_pad4;
 using core::algo::buildE2;
 using core::algo::product_prefix_fit_u64;
 using core::algo::product_tree_range_u64;
-using core::algo::compute_X_with_dots;
+using core::algo::compute_X;
 using core::algo::gcd_with_dots;
 
 
@@ -136,48 +137,59 @@ int App::runPrpOrLlMarin()
                   << std::fixed << std::setprecision(2) << diskUsageGB << "GB of disk space";
             guiServer_->appendLog(oss.str());
         }
+        if (options.mode == "prp") proofManagerMarin.importLegacyCheckpoints();
     }
     std::ostringstream ck;
     if (options.wagstaff) ck << "wagstaff_";
     ck << "m_" << p << ".ckpt";
     const std::string ckpt_file = ck.str();
 
-    auto read_ckpt = [&](const std::string& file, uint32_t& ri, double& et)->int{
+    // Registers a checkpoint must hold: R0 (state) and R1 (Gerbicz accumulator); the others are rebuilt on resume
+    const std::vector<engine::Reg> liveRegs = {0, 1};
+    auto read_legacy_ckpt = [&](const std::string& file, uint32_t& ri, double& et)->int{
         File f(file);
         if (!f.exists()) return -1;
         int version = 0; if (!f.read(reinterpret_cast<char*>(&version), sizeof(version))) return -2;
-        if (version != 1) return -2;
+        if (version != 1 && version != 2) return -2;
         uint32_t rp = 0; if (!f.read(reinterpret_cast<char*>(&rp), sizeof(rp))) return -2;
         if (rp != p) return -2;
         if (!f.read(reinterpret_cast<char*>(&ri), sizeof(ri))) return -2;
         if (!f.read(reinterpret_cast<char*>(&et), sizeof(et))) return -2;
-        const size_t cksz = eng->get_checkpoint_size();
-        std::vector<char> data(cksz);
-        if (!f.read(data.data(), cksz)) return -2;
-        if (!eng->set_checkpoint(data)) return -2;
+        if (version == 1) {
+            // all registers in transform layout
+            const size_t cksz = eng->get_checkpoint_size();
+            std::vector<char> data(cksz);
+            if (!f.read(data.data(), cksz)) return -2;
+            if (!eng->set_checkpoint(data)) return -2;
+        } else {
+            // live registers only, packed
+            uint64_t cksz = 0; if (!f.read(reinterpret_cast<char*>(&cksz), sizeof(cksz))) return -2;
+            std::vector<char> data(cksz);
+            if (!f.read(data.data(), cksz)) return -2;
+            if (!eng->set_packed_checkpoint(liveRegs, data)) return -2;
+        }
         if (!f.check_crc32()) return -2;
         return 0;
     };
 
+    auto read_ckpt = [&](const std::string& file, uint32_t& ri, double& et)->int{
+        io::CheckpointReader f;
+        if (!f.open(file)) return read_legacy_ckpt(file, ri, et);
+        uint32_t rp = 0; std::vector<char> regs;
+        if (!f.get(io::ckpt::Exponent, rp) || rp != p) return -2;
+        if (!f.get(io::ckpt::Iteration, ri) || !f.get(io::ckpt::Elapsed, et)) return -2;
+        if (!f.getBytes(io::ckpt::Registers, regs) || !eng->set_packed_checkpoint(liveRegs, regs)) return -2;
+        return 0;
+    };
+
+    io::CheckpointWriter ckptWriter;
     auto save_ckpt = [&](uint32_t i, double et){
-        const std::string oldf = ckpt_file + ".old", newf = ckpt_file + ".new";
-        {
-            File f(newf, "wb");
-            int version = 1;
-            if (!f.write(reinterpret_cast<const char*>(&version), sizeof(version))) return;
-            if (!f.write(reinterpret_cast<const char*>(&p), sizeof(p))) return;
-            if (!f.write(reinterpret_cast<const char*>(&i), sizeof(i))) return;
-            if (!f.write(reinterpret_cast<const char*>(&et), sizeof(et))) return;
-            const size_t cksz = eng->get_checkpoint_size();
-            std::vector<char> data(cksz);
-            if (!eng->get_checkpoint(data)) return;
-            if (!f.write(data.data(), cksz)) return;
-            f.write_crc32();
-        }
-        std::remove(oldf.c_str());
-        struct stat s;
-        if ((stat(ckpt_file.c_str(), &s) == 0) && (std::rename(ckpt_file.c_str(), oldf.c_str()) != 0)) return;
-        std::rename(newf.c_str(), ckpt_file.c_str());
+        auto& s = ckptWriter.next();
+        s.put(io::ckpt::Exponent, p); s.put(io::ckpt::Iteration, i); s.put(io::ckpt::Elapsed, et);
+        auto& data = s.scratch();
+        eng->get_packed_checkpoint(data, liveRegs);
+        s.put(io::ckpt::Registers, data.data(), data.size());
+        ckptWriter.submit(ckpt_file);
     };
 
     const size_t R0 = 0, R1 = 1, R2 = 2, R3 = 3, R4 = 4, R5 = 5, RBASE = 6, RTMP=7;
@@ -267,6 +279,7 @@ int App::runPrpOrLlMarin()
         {
             const double elapsed_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_clock).count() + restored_time;
             save_ckpt(iter, elapsed_time);
+            ckptWriter.wait();
             delete eng;
             std::cout << "\nInterrupted by user, state saved at iteration " << iter << " j=" << j << std::endl;
             if (guiServer_) {
@@ -546,15 +559,6 @@ int App::runPrpOrLlMarin()
     logger.logEnd(elapsed_time);
 
     if (options.proof) {
-        cl_command_queue queue = context.getQueue();
-        math::Carry carry(
-            context,
-            queue,
-            program->getProgram(),
-            precompute.getN(),
-            precompute.getDigitWidth(),
-            buffers->digitWidthMaskBuf
-        );
         uint32_t proofPower = (options.proofPower);
         for (uint32_t k = proofPower; /*no-cond*/; ) {
             try {
@@ -565,7 +569,8 @@ int App::runPrpOrLlMarin()
                     guiServer_->appendLog(oss.str());
                 }
                 options.proofPower = proofPower;
-                auto proofFilePath = proofManager.proof(context, *nttEngine, carry, proofPower, options.verify);
+                // The test is over: the engine registers are free for the proof tree and its verification.
+                auto proofFilePath = proofManagerMarin.proof(eng, proofPower, options.verify);
                 options.proofFile = proofFilePath.string();
                 std::cout << "Proof file saved: " << proofFilePath << std::endl;
                 if (guiServer_) {
@@ -581,7 +586,7 @@ int App::runPrpOrLlMarin()
                     oss << "Warning: Proof generation failed: " << e.what();
                     guiServer_->appendLog(oss.str());
                 }
-                if (proofPower == 0) break;
+                if (proofPower <= 1) break;
                 --proofPower;
                 std::cout << "Retrying proof generation with reduced power: " << proofPower << std::endl;
                 if (guiServer_) {
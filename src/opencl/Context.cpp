@@ -44,7 +44,7 @@ Context::Context(int deviceIndex, std::size_t enqueueMax, bool cl_queue_throttle
       context_(nullptr), queue_(nullptr),
       queueSize_(0),
       maxWorkGroupSize_(0),
-      localMemSize_(0),
+      localMemSize_(0), globalMemSize_(0), maxMemAllocSize_(0),
       localSize_(0), localSize2_(0), localSize3_(0),
       localSizeCarry_(0), workersCarry_(2), localCarryPropagationDepth_(8),
       evenExponent_(true),
@@ -327,6 +327,10 @@ void Context::queryDeviceCapabilities() {
 
     clGetDeviceInfo(device_, CL_DEVICE_LOCAL_MEM_SIZE,
                     sizeof(localMemSize_), &localMemSize_, nullptr);
+    clGetDeviceInfo(device_, CL_DEVICE_GLOBAL_MEM_SIZE,
+                    sizeof(globalMemSize_), &globalMemSize_, nullptr);
+    clGetDeviceInfo(device_, CL_DEVICE_MAX_MEM_ALLOC_SIZE,
+                    sizeof(maxMemAllocSize_), &maxMemAllocSize_, nullptr);
     if(debug_){
     std::cout << "Max CL_DEVICE_MAX_WORK_GROUP_SIZE = " << maxWorkGroupSize_ << std::endl;
     std::cout << "Max CL_DEVICE_MAX_WORK_ITEM_SIZES = "
@@ -479,6 +483,8 @@ void Context::computeOptimalSizes(std::size_t n,
 std::size_t Context::getMaxWorkGroupSize() const noexcept { return maxWorkGroupSize_; }
 const std::vector<std::size_t>& Context::getMaxWorkItemSizes() const noexcept { return maxWorkItemSizes_; }
 cl_ulong Context::getLocalMemSize() const noexcept { return localMemSize_; }
+cl_ulong Context::getGlobalMemSize() const noexcept { return globalMemSize_; }
+cl_ulong Context::getMaxMemAllocSize() const noexcept { return maxMemAllocSize_; }
 
 std::size_t Context::getLocalSize() const noexcept { return localSize_; }
 std::size_t Context::getLocalSize2() const noexcept { return localSize2_; }
@@ -36,6 +36,7 @@
 
 #include "opencl/Program.hpp"
 #include "opencl/Context.hpp"
+#include "opencl/ProgramCache.hpp"
 #include <fstream>
 #include <sstream>
 #include <vector>
@@ -55,14 +56,6 @@ Program::Program(const prmers::ocl::Context& context, cl_device_id device,
     
 {
     std::string source = loadKernelSource(filePath);
-    const char* src = source.c_str();
-    size_t length = source.size();
-
-    cl_int err;
-    program_ = clCreateProgramWithSource(context.getContext(), 1, &src, &length, &err);
-    if (err != CL_SUCCESS) {
-        throw std::runtime_error("Failed to create OpenCL program from source.");
-    }
 
     // fetch all of our tuning parameters from Context
     cl_uint n          = context.getTransformSize();
@@ -181,14 +174,28 @@ Program::Program(const prmers::ocl::Context& context, cl_device_id device,
     if(debug)
         std::cout << "Building OpenCL program with options: " << buildOptions2 << std::endl;
 
-    
-    err = clBuildProgram(program_, 1, &device, buildOptions2.c_str(), nullptr, nullptr);
-    if (err != CL_SUCCESS) {
-        checkBuildError(program_, device);
-        throw std::runtime_error("Failed to build OpenCL program.");
+    program_ = ProgramCache::load(context.getContext(), device, source, buildOptions2);
+    if (program_) {
+        if(debug)
+            std::cout << "OpenCL program loaded from the binary cache" << std::endl;
+    } else {
+        const char* src = source.c_str();
+        size_t length = source.size();
+
+        cl_int err;
+        program_ = clCreateProgramWithSource(context.getContext(), 1, &src, &length, &err);
+        if (err != CL_SUCCESS) {
+            throw std::runtime_error("Failed to create OpenCL program from source.");
+        }
+        err = clBuildProgram(program_, 1, &device, buildOptions2.c_str(), nullptr, nullptr);
+        if (err != CL_SUCCESS) {
+            checkBuildError(program_, device);
+            throw std::runtime_error("Failed to build OpenCL program.");
+        }
+        if(debug)
+            std::cout << "OpenCL program built successfully from: " << filePath << std::endl;
+        ProgramCache::store(program_, device, source, buildOptions2);
     }
-    if(debug)
-        std::cout << "OpenCL program built successfully from: " << filePath << std::endl;
     cl_uint numKernels = 0;
     clCreateKernelsInProgram(program_, 0, nullptr, &numKernels);
     std::vector<cl_kernel> kernels(numKernels);
@@ -0,0 +1,164 @@
+#define CL_USE_DEPRECATED_OPENCL_1_2_APIS
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 300
+#endif
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+#include "opencl/ProgramCache.hpp"
+#include "util/Crc32.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <system_error>
+#include <vector>
+
+namespace prmers::ocl {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr uint32_t CacheMagic   = 0x4b4d5250;   // "PRMK"
+constexpr uint32_t CacheVersion = 1;
+
+fs::path cacheDir() {
+    if (const char* dir = std::getenv("PRMERS_KERNEL_CACHE")) return dir;
+#ifdef _WIN32
+    if (const char* local = std::getenv("LOCALAPPDATA"); local && *local)
+        return fs::path(local) / "prmers" / "kernels";
+#endif
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return fs::path(xdg) / "prmers" / "kernels";
+    if (const char* home = std::getenv("HOME"); home && *home)
+        return fs::path(home) / ".cache" / "prmers" / "kernels";
+    return {};
+}
+
+std::string deviceString(cl_device_id device, cl_device_info param) {
+    size_t size = 0;
+    if (clGetDeviceInfo(device, param, 0, nullptr, &size) != CL_SUCCESS || size == 0) return {};
+    std::string s(size, '\0');
+    if (clGetDeviceInfo(device, param, size, s.data(), nullptr) != CL_SUCCESS) return {};
+    s.resize(std::strlen(s.c_str()));
+    return s;
+}
+
+// Everything the binary depends on but the source text itself, which is
+// identified by its size and crc32 in the entry header.
+std::string cacheKey(cl_device_id device, const std::string& options) {
+    std::ostringstream ss;
+    ss << deviceString(device, CL_DEVICE_NAME) << '\n'
+       << deviceString(device, CL_DEVICE_VERSION) << '\n'
+       << deviceString(device, CL_DRIVER_VERSION) << '\n'
+       << options;
+    return ss.str();
+}
+
+uint64_t fnv1a(uint64_t h, const std::string& s) {
+    for (char c : s) { h ^= uint8_t(c); h *= 0x100000001b3ull; }
+    return h;
+}
+
+fs::path entryPath(const fs::path& dir, const std::string& key, const std::string& source) {
+    const uint64_t h = fnv1a(fnv1a(0xcbf29ce484222325ull, key), source);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(h));
+    return dir / name;
+}
+
+// Entry: this header, then the key and the binary
+struct EntryHeader {
+    uint32_t magic, version;
+    uint64_t keySize, sourceSize;
+    uint32_t sourceCrc, binaryCrc;
+    uint64_t binarySize;
+};
+
+} // namespace
+
+cl_program ProgramCache::load(cl_context context, cl_device_id device,
+                              const std::string& source, const std::string& options) {
+    const fs::path dir = cacheDir();
+    if (dir.empty()) return nullptr;
+    const std::string key = cacheKey(device, options);
+
+    const fs::path path = entryPath(dir, key, source);
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return nullptr;
+    EntryHeader h{};
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h))) return nullptr;
+    if (h.magic != CacheMagic || h.version != CacheVersion || h.keySize != key.size()
+        || h.sourceSize != source.size() || h.sourceCrc != computeCRC32(source)) return nullptr;
+
+    std::string storedKey(key.size(), '\0');
+    if (!in.read(storedKey.data(), std::streamsize(storedKey.size())) || storedKey != key) return nullptr;
+    // a truncated or damaged entry must not size the allocation
+    std::error_code ec;
+    const uintmax_t fileSize = fs::file_size(path, ec);
+    if (ec || fileSize < sizeof(h) + key.size() || h.binarySize != fileSize - sizeof(h) - key.size()) return nullptr;
+    std::vector<unsigned char> binary(h.binarySize);
+    if (binary.empty() || !in.read(reinterpret_cast<char*>(binary.data()), std::streamsize(binary.size()))) return nullptr;
+    if (computeCRC32(binary.data(), binary.size()) != h.binaryCrc) return nullptr;
+
+    const unsigned char* bin = binary.data();
+    const size_t size = binary.size();
+    cl_int status = CL_SUCCESS, err = CL_SUCCESS;
+    cl_program program = clCreateProgramWithBinary(context, 1, &device, &size, &bin, &status, &err);
+    if (err != CL_SUCCESS || status != CL_SUCCESS) {
+        if (program) clReleaseProgram(program);
+        return nullptr;
+    }
+    if (clBuildProgram(program, 1, &device, options.c_str(), nullptr, nullptr) != CL_SUCCESS) {
+        clReleaseProgram(program);
+        return nullptr;
+    }
+    return program;
+}
+
+void ProgramCache::store(cl_program program, cl_device_id device,
+                         const std::string& source, const std::string& options) {
+    const fs::path dir = cacheDir();
+    if (dir.empty()) return;
+
+    cl_uint numDevices = 0;
+    if (clGetProgramInfo(program, CL_PROGRAM_NUM_DEVICES, sizeof(numDevices), &numDevices, nullptr) != CL_SUCCESS
+        || numDevices != 1) return;
+    size_t size = 0;
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size), &size, nullptr) != CL_SUCCESS || size == 0) return;
+    std::vector<unsigned char> binary(size);
+    unsigned char* bin = binary.data();
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(bin), &bin, nullptr) != CL_SUCCESS) return;
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) return;
+
+    const std::string key = cacheKey(device, options);
+    const EntryHeader h{ CacheMagic, CacheVersion, key.size(), source.size(), computeCRC32(source),
+                         computeCRC32(binary.data(), binary.size()), binary.size() };
+
+    // Written aside then renamed, so that concurrent instances never read a partial entry
+    const fs::path path = entryPath(dir, key, source);
+    fs::path tmp = path;
+    tmp += "." + std::to_string(std::random_device{}()) + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(key.data(), std::streamsize(key.size()));
+        out.write(reinterpret_cast<const char*>(binary.data()), std::streamsize(binary.size()));
+        if (!out.flush()) { out.close(); fs::remove(tmp, ec); return; }
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) fs::remove(tmp, ec);
+}
+
+} // namespace prmers::ocl
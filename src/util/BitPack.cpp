@@ -0,0 +1,209 @@
+// src/util/BitPack.cpp
+/*
+ * Mersenne OpenCL Primality Test Host Code
+ *
+ * This code is inspired by:
+ *   - "mersenne.cpp" by Yves Gallot (Copyright 2020, Yves Gallot) based on
+ *     Nick Craig-Wood's IOCCC 2012 entry (https://github.com/ncw/ioccc2012).
+ *   - The Armprime project, explained at:
+ *         https://www.craig-wood.com/nick/armprime/
+ *     and available on GitHub at:
+ *         https://github.com/ncw/
+ *   - Yves Gallot (https://github.com/galloty), author of Genefer 
+ *     (https://github.com/galloty/genefer22), who helped clarify the NTT and IDBWT concepts.
+ *   - The GPUOwl project (https://github.com/preda/gpuowl), which performs Mersenne
+ *     searches using FFT and double-precision arithmetic.
+ * This code performs a Mersenne prime search using integer arithmetic and an IDBWT via an NTT,
+ * executed on the GPU through OpenCL.
+ *
+ * Author: Cherubrock
+ *
+ * This code is released as free software. 
+ */
+
+#include "util/BitPack.hpp"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+namespace {
+
+// Below this many digits per thread the start-up cost of a thread dominates
+constexpr size_t kMinChunkDigits = size_t(1) << 18;
+
+struct EngineDigits {
+    const uint64_t* d;
+    uint32_t width(size_t i) const { return uint8_t(d[i] >> 32); }
+    uint64_t value(size_t i) const { return uint32_t(d[i]) & ((uint64_t(1) << width(i)) - 1); }
+};
+
+struct SplitDigits {
+    const uint64_t* v;
+    const int* w;
+    uint32_t width(size_t i) const { return uint32_t(w[i]); }
+    uint64_t value(size_t i) const { return v[i]; }
+};
+
+struct Chunk {
+    size_t first = 0, last = 0;
+    uint64_t startBit = 0;
+};
+
+template <typename F>
+void runChunks(size_t count, const F& f) {
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+    for (size_t k = 1; k < count; ++k) threads.emplace_back(f, k);
+    f(size_t(0));
+    for (auto& t : threads) t.join();
+}
+
+// Split [0, n) into chunks and find the bit offset of each one
+template <typename Src>
+std::vector<Chunk> planChunks(const Src& src, size_t n) {
+    const size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    const size_t count = std::clamp<size_t>(n / kMinChunkDigits, 1, hw);
+    std::vector<Chunk> chunks(count);
+    for (size_t k = 0; k < count; ++k) {
+        chunks[k].first = n * k / count;
+        chunks[k].last = n * (k + 1) / count;
+    }
+    if (count == 1) return chunks;
+
+    std::vector<uint64_t> bits(count);
+    runChunks(count, [&](size_t k) {
+        uint64_t s = 0;
+        for (size_t i = chunks[k].first; i < chunks[k].last; ++i) s += src.width(i);
+        bits[k] = s;
+    });
+    for (size_t k = 1; k < count; ++k) chunks[k].startBit = chunks[k - 1].startBit + bits[k - 1];
+    return chunks;
+}
+
+// The first and last words of a chunk may be shared with its neighbours: they are
+// returned here and merged afterwards. Words in between are stored directly.
+struct PackedEnds {
+    uint64_t headIdx = 0;
+    uint32_t head = 0;
+    bool hasTail = false;   // false: the whole chunk fits in the head word
+    uint64_t tailIdx = 0;
+    uint32_t tail = 0;
+};
+
+template <typename Src>
+PackedEnds packChunk(const Src& src, const Chunk& c, uint32_t* out) {
+    PackedEnds e;
+    size_t i = c.first;
+    uint64_t o = c.startBit / 32;
+    uint32_t nbits = uint32_t(c.startBit % 32);
+    uint64_t acc = 0;
+    e.headIdx = o;
+
+    while (i < c.last && nbits < 32) {
+        acc |= src.value(i) << nbits;
+        nbits += src.width(i);
+        ++i;
+    }
+    e.head = uint32_t(acc);
+    if (nbits < 32) return e;
+    acc >>= 32; nbits -= 32; ++o;
+
+    // Branch-free: the current word is always stored and the index only moves
+    // once it is full. nbits < 32 and value < 2^32 keep acc within 64 bits.
+    for (; i < c.last; ++i) {
+        acc |= src.value(i) << nbits;
+        nbits += src.width(i);
+        out[o] = uint32_t(acc);
+        const uint32_t full = nbits >> 5;
+        o += full;
+        acc >>= (full << 5);
+        nbits &= 31;
+    }
+    e.hasTail = true;
+    e.tailIdx = o;
+    e.tail = uint32_t(acc);
+    return e;
+}
+
+template <typename Src>
+void packImpl(const Src& src, size_t n, uint32_t* out, size_t outWords) {
+    const std::vector<Chunk> chunks = planChunks(src, n);
+    std::vector<PackedEnds> ends(chunks.size());
+    runChunks(chunks.size(), [&](size_t k) { ends[k] = packChunk(src, chunks[k], out); });
+
+    // Merge the shared words in order
+    uint64_t idx = 0;
+    uint32_t word = 0;
+    for (const PackedEnds& e : ends) {
+        if (e.headIdx == idx) word |= e.head;
+        else { out[idx] = word; idx = e.headIdx; word = e.head; }
+        if (e.hasTail) { out[idx] = word; idx = e.tailIdx; word = e.tail; }
+    }
+    if (idx < outWords) out[idx++] = word;
+    std::fill(out + std::min<uint64_t>(idx, outWords), out + outWords, 0u);
+}
+
+template <typename Src, typename Store>
+void unpackImpl(const Src& src, const uint32_t* words, size_t nwords, size_t n, const Store& store) {
+    const std::vector<Chunk> chunks = planChunks(src, n);
+    runChunks(chunks.size(), [&](size_t k) {
+        uint64_t bit = chunks[k].startBit;
+        for (size_t i = chunks[k].first; i < chunks[k].last; ++i) {
+            const uint32_t w = src.width(i);
+            const uint64_t j = bit / 32;
+            const uint64_t lo = (j < nwords) ? words[j] : 0, hi = (j + 1 < nwords) ? words[j + 1] : 0;
+            store(i, ((lo | (hi << 32)) >> (bit % 32)) & ((uint64_t(1) << w) - 1));
+            bit += w;
+        }
+    });
+}
+
+// v += carry, reduced to w bits; returns the new carry (w <= 32, so 64 - w is a valid shift)
+inline uint64_t addCarry(uint64_t& v, uint64_t carry, uint32_t w) {
+    const uint64_t s = v + carry;
+    const uint64_t over = (s < carry) ? 1 : 0;
+    v = s & ((uint64_t(1) << w) - 1);
+    return (s >> w) | (over << (64 - w));
+}
+
+} // namespace
+
+void packDigits(const uint64_t* digits, size_t n, uint32_t* out, size_t outWords) {
+    packImpl(EngineDigits{digits}, n, out, outWords);
+}
+
+void unpackDigits(const uint32_t* words, size_t nwords, uint64_t* digits, size_t n) {
+    unpackImpl(EngineDigits{digits}, words, nwords, n, [digits](size_t i, uint64_t v) {
+        digits[i] = (digits[i] & 0xff00000000ull) | v;
+    });
+}
+
+void packBits(const uint64_t* values, const int* widths, size_t n, uint32_t* out, size_t outWords) {
+    packImpl(SplitDigits{values, widths}, n, out, outWords);
+}
+
+void unpackBits(const uint32_t* words, size_t nwords, const int* widths, size_t n, uint64_t* values) {
+    unpackImpl(SplitDigits{values, widths}, words, nwords, n, [values](size_t i, uint64_t v) { values[i] = v; });
+}
+
+uint64_t normalizeCarries(uint64_t* values, const int* widths, size_t n) {
+    const SplitDigits src{values, widths};
+    const std::vector<Chunk> chunks = planChunks(src, n);
+    std::vector<uint64_t> carryOut(chunks.size());
+    runChunks(chunks.size(), [&](size_t k) {
+        uint64_t c = 0;
+        for (size_t i = chunks[k].first; i < chunks[k].last; ++i) c = addCarry(values[i], c, src.width(i));
+        carryOut[k] = c;
+    });
+
+    uint64_t c = carryOut[0];
+    for (size_t k = 1; k < chunks.size(); ++k) {
+        for (size_t i = chunks[k].first; c != 0 && i < chunks[k].last; ++i) c = addCarry(values[i], c, src.width(i));
+        c += carryOut[k];
+    }
+    return c;
+}
+
+} // namespace util
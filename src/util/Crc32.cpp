@@ -20,97 +20,198 @@
  * This code is released as free software. 
  */
 #include "util/Crc32.hpp"
+#include <array>
 #include <cstdint>
 #include <iostream>
 #include <string>
 #include <algorithm>
 #include <cctype>
 
-static const uint32_t crctable[256] = {
-	0x00000000L, 0x77073096L, 0xee0e612cL, 0x990951baL,
-	0x076dc419L, 0x706af48fL, 0xe963a535L, 0x9e6495a3L,
-	0x0edb8832L, 0x79dcb8a4L, 0xe0d5e91eL, 0x97d2d988L,
-	0x09b64c2bL, 0x7eb17cbdL, 0xe7b82d07L, 0x90bf1d91L,
-	0x1db71064L, 0x6ab020f2L, 0xf3b97148L, 0x84be41deL,
-	0x1adad47dL, 0x6ddde4ebL, 0xf4d4b551L, 0x83d385c7L,
-	0x136c9856L, 0x646ba8c0L, 0xfd62f97aL, 0x8a65c9ecL,
-	0x14015c4fL, 0x63066cd9L, 0xfa0f3d63L, 0x8d080df5L,
-	0x3b6e20c8L, 0x4c69105eL, 0xd56041e4L, 0xa2677172L,
-	0x3c03e4d1L, 0x4b04d447L, 0xd20d85fdL, 0xa50ab56bL,
-	0x35b5a8faL, 0x42b2986cL, 0xdbbbc9d6L, 0xacbcf940L,
-	0x32d86ce3L, 0x45df5c75L, 0xdcd60dcfL, 0xabd13d59L,
-	0x26d930acL, 0x51de003aL, 0xc8d75180L, 0xbfd06116L,
-	0x21b4f4b5L, 0x56b3c423L, 0xcfba9599L, 0xb8bda50fL,
-	0x2802b89eL, 0x5f058808L, 0xc60cd9b2L, 0xb10be924L,
-	0x2f6f7c87L, 0x58684c11L, 0xc1611dabL, 0xb6662d3dL,
-	0x76dc4190L, 0x01db7106L, 0x98d220bcL, 0xefd5102aL,
-	0x71b18589L, 0x06b6b51fL, 0x9fbfe4a5L, 0xe8b8d433L,
-	0x7807c9a2L, 0x0f00f934L, 0x9609a88eL, 0xe10e9818L,
-	0x7f6a0dbbL, 0x086d3d2dL, 0x91646c97L, 0xe6635c01L,
-	0x6b6b51f4L, 0x1c6c6162L, 0x856530d8L, 0xf262004eL,
-	0x6c0695edL, 0x1b01a57bL, 0x8208f4c1L, 0xf50fc457L,
-	0x65b0d9c6L, 0x12b7e950L, 0x8bbeb8eaL, 0xfcb9887cL,
-	0x62dd1ddfL, 0x15da2d49L, 0x8cd37cf3L, 0xfbd44c65L,
-	0x4db26158L, 0x3ab551ceL, 0xa3bc0074L, 0xd4bb30e2L,
-	0x4adfa541L, 0x3dd895d7L, 0xa4d1c46dL, 0xd3d6f4fbL,
-	0x4369e96aL, 0x346ed9fcL, 0xad678846L, 0xda60b8d0L,
-	0x44042d73L, 0x33031de5L, 0xaa0a4c5fL, 0xdd0d7cc9L,
-	0x5005713cL, 0x270241aaL, 0xbe0b1010L, 0xc90c2086L,
-	0x5768b525L, 0x206f85b3L, 0xb966d409L, 0xce61e49fL,
-	0x5edef90eL, 0x29d9c998L, 0xb0d09822L, 0xc7d7a8b4L,
-	0x59b33d17L, 0x2eb40d81L, 0xb7bd5c3bL, 0xc0ba6cadL,
-	0xedb88320L, 0x9abfb3b6L, 0x03b6e20cL, 0x74b1d29aL,
-	0xead54739L, 0x9dd277afL, 0x04db2615L, 0x73dc1683L,
-	0xe3630b12L, 0x94643b84L, 0x0d6d6a3eL, 0x7a6a5aa8L,
-	0xe40ecf0bL, 0x9309ff9dL, 0x0a00ae27L, 0x7d079eb1L,
-	0xf00f9344L, 0x8708a3d2L, 0x1e01f268L, 0x6906c2feL,
-	0xf762575dL, 0x806567cbL, 0x196c3671L, 0x6e6b06e7L,
-	0xfed41b76L, 0x89d32be0L, 0x10da7a5aL, 0x67dd4accL,
-	0xf9b9df6fL, 0x8ebeeff9L, 0x17b7be43L, 0x60b08ed5L,
-	0xd6d6a3e8L, 0xa1d1937eL, 0x38d8c2c4L, 0x4fdff252L,
-	0xd1bb67f1L, 0xa6bc5767L, 0x3fb506ddL, 0x48b2364bL,
-	0xd80d2bdaL, 0xaf0a1b4cL, 0x36034af6L, 0x41047a60L,
-	0xdf60efc3L, 0xa867df55L, 0x316e8eefL, 0x4669be79L,
-	0xcb61b38cL, 0xbc66831aL, 0x256fd2a0L, 0x5268e236L,
-	0xcc0c7795L, 0xbb0b4703L, 0x220216b9L, 0x5505262fL,
-	0xc5ba3bbeL, 0xb2bd0b28L, 0x2bb45a92L, 0x5cb36a04L,
-	0xc2d7ffa7L, 0xb5d0cf31L, 0x2cd99e8bL, 0x5bdeae1dL,
-	0x9b64c2b0L, 0xec63f226L, 0x756aa39cL, 0x026d930aL,
-	0x9c0906a9L, 0xeb0e363fL, 0x72076785L, 0x05005713L,
-	0x95bf4a82L, 0xe2b87a14L, 0x7bb12baeL, 0x0cb61b38L,
-	0x92d28e9bL, 0xe5d5be0dL, 0x7cdcefb7L, 0x0bdbdf21L,
-	0x86d3d2d4L, 0xf1d4e242L, 0x68ddb3f8L, 0x1fda836eL,
-	0x81be16cdL, 0xf6b9265bL, 0x6fb077e1L, 0x18b74777L,
-	0x88085ae6L, 0xff0f6a70L, 0x66063bcaL, 0x11010b5cL,
-	0x8f659effL, 0xf862ae69L, 0x616bffd3L, 0x166ccf45L,
-	0xa00ae278L, 0xd70dd2eeL, 0x4e048354L, 0x3903b3c2L,
-	0xa7672661L, 0xd06016f7L, 0x4969474dL, 0x3e6e77dbL,
-	0xaed16a4aL, 0xd9d65adcL, 0x40df0b66L, 0x37d83bf0L,
-	0xa9bcae53L, 0xdebb9ec5L, 0x47b2cf7fL, 0x30b5ffe9L,
-	0xbdbdf21cL, 0xcabac28aL, 0x53b39330L, 0x24b4a3a6L,
-	0xbad03605L, 0xcdd70693L, 0x54de5729L, 0x23d967bfL,
-	0xb3667a2eL, 0xc4614ab8L, 0x5d681b02L, 0x2a6f2b94L,
-	0xb40bbe37L, 0xc30c8ea1L, 0x5a05df1bL, 0x2d02ef8dL
-    	
-};
-#define CRC32_INIT_VALUE 0xffffffffUL
-#define CRC32_XOR_VALUE  0xffffffffUL
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32_PCLMUL 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CRC32_TARGET_PCLMUL
+#else
+#include <cpuid.h>
+#define CRC32_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#endif
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ORDER_LITTLE_ENDIAN__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define CRC32_ARMV8 1
+#include <arm_acle.h>
+#include <cstring>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+// CRC-32 (IEEE 802.3, reflected polynomial 0xedb88320), as in zlib and File.
+// The functions below work on the inverted register: the caller applies ~ on
+// entry and exit.
+
+namespace {
+
+// T[0] is the usual byte table, T[k] advances a byte through k more zero bytes
+using CrcTables = std::array<std::array<uint32_t, 256>, 16>;
+
+constexpr CrcTables makeTables() {
+    CrcTables t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t r = i;
+        for (int j = 0; j < 8; ++j) r = (r & 1) ? (r >> 1) ^ 0xedb88320u : (r >> 1);
+        t[0][i] = r;
+    }
+    for (size_t k = 1; k < 16; ++k)
+        for (size_t i = 0; i < 256; ++i)
+            t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+    return t;
+}
+
+constexpr CrcTables crcTables = makeTables();
+
+inline uint32_t load32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+uint32_t crcBytes(uint32_t crc, const uint8_t* p, size_t size) {
+    const auto& t = crcTables[0];
+    for (size_t i = 0; i < size; ++i) crc = t[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+// Slicing-by-16: 16 independent table lookups per 16-byte block
+uint32_t crcSlicing16(uint32_t crc, const uint8_t* p, size_t size) {
+    const auto& t = crcTables;
+    for (; size >= 16; size -= 16, p += 16) {
+        const uint32_t a = load32(p) ^ crc, b = load32(p + 4), c = load32(p + 8), d = load32(p + 12);
+        crc = t[15][a & 0xff] ^ t[14][(a >> 8) & 0xff] ^ t[13][(a >> 16) & 0xff] ^ t[12][a >> 24]
+            ^ t[11][b & 0xff] ^ t[10][(b >> 8) & 0xff] ^ t[9][(b >> 16) & 0xff]  ^ t[8][b >> 24]
+            ^ t[7][c & 0xff]  ^ t[6][(c >> 8) & 0xff]  ^ t[5][(c >> 16) & 0xff]  ^ t[4][c >> 24]
+            ^ t[3][d & 0xff]  ^ t[2][(d >> 8) & 0xff]  ^ t[1][(d >> 16) & 0xff]  ^ t[0][d >> 24];
+    }
+    return crcBytes(crc, p, size);
+}
+
+#if defined(CRC32_PCLMUL)
+// Carry-less multiplication folding (Gopal et al., "Fast CRC Computation for
+// Generic Polynomials Using PCLMULQDQ Instruction", Intel 2009): four 128-bit
+// lanes are folded 64 bytes at a time, then reduced to 128 bits and finally
+// to 32 bits with a Barrett reduction. Constants are for the reflected 0xedb88320.
+CRC32_TARGET_PCLMUL inline __m128i load(const uint8_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// x * k folded 128 bits forward, added to the next block
+CRC32_TARGET_PCLMUL inline __m128i fold(__m128i x, __m128i k, __m128i next) {
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)), next);
+}
+
+CRC32_TARGET_PCLMUL
+uint32_t crcPclmul(uint32_t crc, const uint8_t* p, size_t size) {
+    if (size < 64) return crcSlicing16(crc, p, size);
+    const size_t tail = size & 15;
+    size -= tail;
+
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_xor_si128(load(p), _mm_cvtsi32_si128(int(crc)));
+    __m128i x2 = load(p + 16), x3 = load(p + 32), x4 = load(p + 48);
+    p += 64; size -= 64;
+    for (; size >= 64; p += 64, size -= 64) {
+        x1 = fold(x1, k1k2, load(p));
+        x2 = fold(x2, k1k2, load(p + 16));
+        x3 = fold(x3, k1k2, load(p + 32));
+        x4 = fold(x4, k1k2, load(p + 48));
+    }
+
+    x1 = fold(x1, k3k4, x2);
+    x1 = fold(x1, k3k4, x3);
+    x1 = fold(x1, k3k4, x4);
+    for (; size >= 16; p += 16, size -= 16) x1 = fold(x1, k3k4, load(p));
+
+    // 128 -> 64 bits
+    __m128i x0 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x0);
+    x0 = _mm_srli_si128(x1, 4);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5k0, 0x00), x0);
+
+    // Barrett reduction, 64 -> 32 bits
+    x0 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+    x0 = _mm_clmulepi64_si128(_mm_and_si128(x0, mask32), poly, 0x00);
+    x1 = _mm_xor_si128(x1, x0);
+    crc = uint32_t(_mm_extract_epi32(x1, 1));
+
+    return crcBytes(crc, p, tail);
+}
+
+bool hasPclmul() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 1)) && (info[2] & (1 << 19));
+#else
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) return false;
+    return (c & bit_PCLMUL) && (c & bit_SSE4_1);
+#endif
+}
+#endif
+
+#if defined(CRC32_ARMV8)
+// ARMv8 CRC32 extension: one 64-bit word per instruction
+__attribute__((target("+crc")))
+uint32_t crcArmv8(uint32_t crc, const uint8_t* p, size_t size) {
+    for (; size != 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0; --size) crc = __crc32b(crc, *p++);
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t w; std::memcpy(&w, p, sizeof(w));
+        crc = __crc32d(crc, w);
+    }
+    for (; size != 0; --size) crc = __crc32b(crc, *p++);
+    return crc;
+}
+
+bool hasArmCrc() {
+#if defined(__APPLE__)
+    return true;
+#elif defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+    return false;
+#endif
+}
+#endif
+
+using CrcFunction = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+CrcFunction selectCrc() {
+#if defined(CRC32_PCLMUL)
+    if (hasPclmul()) return crcPclmul;
+#elif defined(CRC32_ARMV8)
+    if (hasArmCrc()) return crcArmv8;
+#endif
+    return crcSlicing16;
+}
+
+} // namespace
+
+uint32_t updateCRC32(uint32_t crc, const void* data, size_t size) {
+    // chosen once, on first use; static initialization is thread-safe
+    static const CrcFunction impl = selectCrc();
+    return ~impl(~crc, static_cast<const uint8_t*>(data), size);
+}
 
 uint32_t computeCRC32(const std::string &data) {
-    uint32_t crc = CRC32_INIT_VALUE;
-	for (char ch : data) {
-    	crc = crctable[(crc ^ static_cast<uint8_t>(ch)) & 0xFF] ^ (crc >> 8);
-	}
-    return static_cast<unsigned int>(crc ^ CRC32_XOR_VALUE);
+    return updateCRC32(0, data.data(), data.size());
 }
 
 uint32_t computeCRC32(const void* data, size_t size) {
-    uint32_t crc = CRC32_INIT_VALUE;
-    const uint8_t* bytes = static_cast<const uint8_t*>(data);
-    for (size_t i = 0; i < size; ++i) {
-        crc = crctable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
-    }
-    return crc ^ CRC32_XOR_VALUE;
+    return updateCRC32(0, data, size);
 }
 
 std::string toLower(const std::string &s) {
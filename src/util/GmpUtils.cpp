@@ -1,16 +1,12 @@
 #include "util/GmpUtils.hpp"
-#include <thread>
-#include <atomic>
-#include <algorithm>
-#include <cstdio>
-#include <climits>
+#include "util/BitPack.hpp"
+#include <bit>
 
 namespace util {
 
 mpz_class convertToGMP(const std::vector<uint32_t>& words) {
   mpz_class result;
-  // Use GMP's optimized mpz_import function
-  mpz_import(result.get_mpz_t(), words.size(), -1 /*order: LSWord first*/, sizeof(uint32_t), 0 /*endian: native*/, 0 /*nails*/, words.data());
+  importWords(result.get_mpz_t(), words.data(), words.size());
   return result;
 }
 
@@ -94,14 +90,12 @@ std::vector<uint32_t> convertFromGMP(const mpz_class& gmp_val) {
   return data;
 }
 
-static inline void add_ui64(mpz_class& x, uint64_t w) {
-#if ULONG_MAX == 0xFFFFFFFFFFFFFFFFULL
-    mpz_add_ui(x.get_mpz_t(), x.get_mpz_t(), static_cast<unsigned long>(w));
-#else
-    mpz_class tmp;
-    mpz_import(tmp.get_mpz_t(), 1, -1, sizeof(uint64_t), 0, 0, &w);
-    x += tmp;
-#endif
+void importWords(mpz_t z, const uint32_t* words, size_t count) {
+  if constexpr (std::endian::native == std::endian::little) {
+    // pairs of little-endian 32-bit words are 64-bit words: GMP copies them straight into its limbs
+    if (count % 2 == 0) { mpz_import(z, count / 2, -1, sizeof(uint64_t), 0, 0, words); return; }
+  }
+  mpz_import(z, count, -1, sizeof(uint32_t), 0, 0, words);
 }
 
 mpz_class vectToMpz(const std::vector<uint64_t>& v,
@@ -109,51 +103,23 @@ mpz_class vectToMpz(const std::vector<uint64_t>& v,
                     const mpz_class& Mp)
 {
     const size_t n = v.size();
-    const unsigned T = std::max(1u, std::thread::hardware_concurrency());
-    std::vector<mpz_class> partial(T);
-
-    std::vector<unsigned> total_width(T, 0);
-    std::atomic<size_t> global_count{0};
-
-    std::vector<std::thread> threads(T);
-    size_t chunk = (n + T - 1) / T;
-
-    for (unsigned t = 0; t < T; ++t) {
-        size_t start = t * chunk;
-        size_t end = std::min(start + chunk, n);
-        threads[t] = std::thread([&, start, end, t]() {
-            mpz_class acc = 0;
-            for (ptrdiff_t i = ptrdiff_t(end) - 1; i >= ptrdiff_t(start); --i) {
-                acc <<= static_cast<mp_bitcnt_t>(widths[static_cast<size_t>(i)]);
-                add_ui64(acc, v[static_cast<size_t>(i)]);
-                if (acc >= Mp) acc -= Mp;
-
-                total_width[t] += static_cast<unsigned>(widths[static_cast<size_t>(i)]);
-
-                size_t count = ++global_count;
-                if (count % 10000 == 0 || count == n) {
-                    double progress = 100.0 * count / n;
-                    printf("\rProgress: %.2f%%", progress);
-                    fflush(stdout);
-                }
-            }
-            partial[t] = acc;
-        });
+    std::vector<uint64_t> digits(v);
+    const uint64_t carry = normalizeCarries(digits.data(), widths.data(), n);
+
+    uint64_t bits = 0;
+    for (size_t i = 0; i < n; ++i) bits += static_cast<uint64_t>(widths[i]);
+    std::vector<uint32_t> words(static_cast<size_t>((bits + 63) / 64 * 2));
+    packBits(digits.data(), widths.data(), n, words.data(), words.size());
+
+    mpz_class result;
+    importWords(result.get_mpz_t(), words.data(), words.size());
+    if (carry != 0) {
+        mpz_class c;
+        mpz_import(c.get_mpz_t(), 1, -1, sizeof(uint64_t), 0, 0, &carry);
+        result += c << static_cast<mp_bitcnt_t>(bits);
     }
-
-    for (auto& th : threads) th.join();
-    printf("\n");
-
-    mpz_class result = 0;
-    for (unsigned t = T; t-- > 0;) {
-        result <<= total_width[t];
-        result += partial[t];
-        if (result >= Mp) result -= Mp;
-    }
-
-
+    if (result >= Mp) result %= Mp;
     return result;
 }
 
-
 }